@@ -0,0 +1,488 @@
+//
+// Microbenchmarks for the (de)interleave kernels and the Rx/Tx reblocking paths.
+//
+// Kernels: each kernel variant supported by the CPU is run over a range of sample counts (from L1 resident to DRAM).
+// Reblocking: the real rxHandler and txHandler (planar pipe format, so the kernels are in the path) are run against the
+// mock UHD backend (unpaced, without filling or reading the sample buffers) for a matrix of UHD buffer sizes
+// (samps_per_buff / max_num_samps) and ring block sizes (samplesPerTransactRx/Tx).  The remainder carried across
+// recv/send boundaries depends on the ratio between the two.  The ring is drained (Rx) or filled (Tx) by this thread
+// without touching the blocks.
+//
+// Results are printed as a table and can also be written as CSV (one row per measurement, in a fixed order) so that runs
+// from different builds can be diffed.  GB/s is the rate of sample data converted (bytes in the interleaved format).
+//
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <uhd.h>
+#include "interleave.h"
+#include "rxHandler.h"
+#include "txHandler.h"
+#include "spscRing.h"
+#include "telemetry.h"
+
+#define BENCH_MAX_LIST (32)
+#define BENCH_RING_DEPTH (256)
+
+typedef enum{
+    BENCH_ISA_SCALAR,
+    BENCH_ISA_SSE2,
+    BENCH_ISA_AVX2,
+    BENCH_ISA_AVX512
+} benchIsa_e;
+
+//A set of kernels, one for each component size (indexed by benchFormat_t.kernelInd).  Mirrors interleaveKernelsInit
+typedef struct{
+    const char* name;
+    benchIsa_e isa;
+    deinterleave_t deinterleave[3];
+    interleave_t interleave[3];
+} benchVariant_t;
+
+static const benchVariant_t benchVariants[] = {
+        {"scalar", BENCH_ISA_SCALAR,
+         {deinterleave32Scalar, deinterleave16Scalar, deinterleave8Scalar},
+         {interleave32Scalar, interleave16Scalar, interleave8Scalar}},
+#if defined(__x86_64__) || defined(__i386__)
+        {"sse2", BENCH_ISA_SSE2,
+         {deinterleave32SSE2, deinterleave16SSE2, deinterleave8SSE2},
+         {interleave32SSE2, interleave16SSE2, interleave8SSE2}},
+        {"avx2", BENCH_ISA_AVX2,
+         {deinterleave32AVX2, deinterleave16AVX2, deinterleave8AVX2},
+         {interleave32AVX2, interleave16AVX2, interleave8AVX2}},
+        {"avx512", BENCH_ISA_AVX512,
+         {deinterleave32AVX512, deinterleave16AVX2, deinterleave8AVX2},
+         {interleave32AVX512, interleave16AVX2, interleave8AVX2}},
+#endif
+};
+#define BENCH_NUM_VARIANTS (sizeof(benchVariants)/sizeof(benchVariants[0]))
+
+typedef struct{
+    const char* name;
+    sampleFormat_e cpuFormat;
+    size_t componentSize;
+    int kernelInd;
+} benchFormat_t;
+
+static const benchFormat_t benchFormats[] = {
+        {"fc32", SAMPLE_FORMAT_FC32, 4, 0},
+        {"sc16", SAMPLE_FORMAT_SC16, 2, 1},
+        {"sc8", SAMPLE_FORMAT_SC8, 1, 2}
+};
+#define BENCH_NUM_FORMATS (sizeof(benchFormats)/sizeof(benchFormats[0]))
+
+static bool benchIsaSupported(benchIsa_e isa){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    switch(isa){
+        case BENCH_ISA_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case BENCH_ISA_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case BENCH_ISA_AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2");
+        default:
+            return true;
+    }
+#else
+    return isa == BENCH_ISA_SCALAR;
+#endif
+}
+
+void print_help(void){
+    fprintf(stderr, "uhdToPipes_kernelbench - Microbenchmarks for the (de)interleave kernels and the Rx/Tx reblocking paths\n\n"
+
+                    "Options:\n"
+                    "    --cpuformat (comma separated list of fc32, sc16, sc8 - defaults to all)\n"
+                    "    --variant (only run the given kernel variant: scalar, sse2, avx2, avx512 - defaults to all supported)\n"
+                    "    --sizes (comma separated list of sample counts for the kernels - defaults to 256,4096,65536,1048576)\n"
+                    "    --buffs (comma separated list of UHD buffer sizes (max_num_samps) - defaults to 364,1996,8192)\n"
+                    "    --blocks (comma separated list of ring block sizes (samples per transaction) - defaults to 256,1000,4096,65536)\n"
+                    "    --samples (samples per measurement - defaults to 16777216)\n"
+                    "    --nokernels (skip the kernel benchmarks)\n"
+                    "    --noreblock (skip the reblocking benchmarks)\n"
+                    "    --csv (path of a CSV file to write the results to)\n"
+                    "    -v (show the output of the handlers)\n"
+                    "    -h (print this help message)\n");
+}
+
+static double benchNow(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+static int benchParseList(char* str, int* list){
+    int numItems = 0;
+    char* savePtr = NULL;
+    for(char* item = strtok_r(str, ",", &savePtr); item != NULL && numItems<BENCH_MAX_LIST; item = strtok_r(NULL, ",", &savePtr)){
+        list[numItems++] = atoi(item);
+    }
+    return numItems;
+}
+
+static void benchReport(FILE* csv, const char* section, const char* direction, const char* format, const char* variant,
+                        int sampsPerBuff, int blockSamples, uint64_t samples, double elapsed, size_t sampleSize){
+    double nsPerSample = elapsed*1e9/samples;
+    double gbPerSec = samples*sampleSize/elapsed/1e9;
+    printf("%-9s %-13s %-5s %-7s %10d %10d %10.3f %9.2f\n", section, direction, format, variant, sampsPerBuff, blockSamples,
+           nsPerSample, gbPerSec);
+    if(csv != NULL){
+        fprintf(csv, "%s,%s,%s,%s,%d,%d,%.4f,%.3f\n", section, direction, format, variant, sampsPerBuff, blockSamples,
+                nsPerSample, gbPerSec);
+    }
+    fflush(stdout);
+}
+
+//Runs the kernel (in a loop) over at least totalSamples samples.  Returns the elapsed time
+static double benchKernel(const benchVariant_t* variant, const benchFormat_t* format, bool deinterleave, size_t numSamples,
+                          uint64_t totalSamples, char* interleaved, char* re, char* im, uint64_t* samplesRun){
+    deinterleave_t deinterleaveFn = variant->deinterleave[format->kernelInd];
+    interleave_t interleaveFn = variant->interleave[format->kernelInd];
+    uint64_t reps = (totalSamples + numSamples - 1)/numSamples;
+
+    //Warm the caches (and fault in the pages)
+    if(deinterleave){
+        deinterleaveFn(interleaved, re, im, numSamples);
+    }else{
+        interleaveFn(re, im, interleaved, numSamples);
+    }
+
+    double start = benchNow();
+    for(uint64_t rep = 0; rep<reps; rep++){
+        if(deinterleave){
+            deinterleaveFn(interleaved, re, im, numSamples);
+        }else{
+            interleaveFn(re, im, interleaved, numSamples);
+        }
+    }
+    double elapsed = benchNow() - start;
+    *samplesRun = reps*numSamples;
+    return elapsed;
+}
+
+//Creates a mock USRP with the given buffer size which produces/consumes samples as fast as possible
+static uhd_usrp_handle benchMakeUsrp(int sampsPerBuff){
+    char deviceArgs[128];
+    snprintf(deviceArgs, sizeof(deviceArgs), "paced=0,fill=0,max_num_samps=%d", sampsPerBuff);
+    uhd_usrp_handle usrp = NULL;
+    if(uhd_usrp_make(&usrp, deviceArgs)){
+        printf("Error Creating Mock USRP\n");
+        exit(1);
+    }
+    return usrp;
+}
+
+static int benchRingInit(spscRing_t* ring, size_t blockBytes){
+    int status = spscRingInit(ring, BENCH_RING_DEPTH, blockBytes);
+    if(status == 0){
+        memset(ring->blocks, 0, ring->numBlocks*ring->blockSize); //Fault in the pages before measuring
+    }
+    return status;
+}
+
+//Runs rxHandler until totalSamples have been passed through the ring.  Returns the elapsed time
+static double benchRxReblock(const benchFormat_t* format, int sampsPerBuff, int blockSamples, uint64_t totalSamples,
+                             uint64_t* samplesRun){
+    size_t sampleSize = 2*format->componentSize;
+    uhd_usrp_handle usrp = benchMakeUsrp(sampsPerBuff);
+    uhd_rx_streamer_handle rx_streamer;
+    uhd_rx_metadata_handle rx_md;
+    uhd_rx_streamer_make(&rx_streamer);
+    uhd_rx_metadata_make(&rx_md);
+    size_t channel = 0;
+    uhd_stream_args_t stream_args = {
+            .cpu_format = (char*) format->name,
+            .otw_format = "sc16",
+            .args = "",
+            .channel_list = &channel,
+            .n_channels = 1
+    };
+    uhd_usrp_get_rx_stream(usrp, &stream_args, rx_streamer);
+
+    spscRing_t ring;
+    if(benchRingInit(&ring, blockSamples*sampleSize) != 0){
+        printf("Error creating Rx ring\n");
+        exit(1);
+    }
+
+    bool terminateStatus = false;
+    bool wasRunning = false;
+    telemetryCounters_t telemetry;
+    memset(&telemetry, 0, sizeof(telemetry));
+    rxHandlerArgs_t args;
+    memset(&args, 0, sizeof(args));
+    args.terminateStatus = &terminateStatus;
+    args.rxRing = &ring;
+    args.rx_streamer = rx_streamer;
+    args.rx_md = rx_md;
+    args.sendStopCmd = true;
+    args.samplesPerTransactRx = blockSamples;
+    args.numChannels = 1;
+    args.pipeFormat = PIPE_FORMAT_PLANAR;
+    args.cpuFormat = format->cpuFormat;
+    args.framed = false;
+    args.rate = 1e6;
+    args.overflowPolicy = RX_OVERFLOW_POLICY_ABORT;
+    args.maxErrors = 0;
+    args.maxZeroFillSecs = 1;
+    args.blockStamps = NULL;
+    args.dataAge = NULL;
+    args.telemetry = &telemetry;
+    args.verbose = false;
+    args.wasRunning = &wasRunning;
+
+    uint64_t targetBlocks = (totalSamples + blockSamples - 1)/blockSamples;
+    double start = benchNow();
+    double elapsed = 0;
+    pthread_t rxThread;
+    pthread_create(&rxThread, NULL, rxHandler, &args);
+    uint64_t blocks = 0;
+    while(spscRingAcquireRead(&ring, NULL) != NULL){
+        spscRingReleaseRead(&ring);
+        blocks++;
+        if(blocks == targetBlocks){
+            elapsed = benchNow() - start;
+            terminateStatus = true; //Keep draining until the Rx handler stops
+        }
+    }
+    pthread_join(rxThread, NULL);
+
+    spscRingFree(&ring);
+    uhd_rx_metadata_free(&rx_md);
+    uhd_rx_streamer_free(&rx_streamer);
+    uhd_usrp_free(&usrp);
+    *samplesRun = targetBlocks*blockSamples;
+    return elapsed;
+}
+
+//Runs txHandler until totalSamples have been passed through the ring.  Returns the elapsed time
+static double benchTxReblock(const benchFormat_t* format, int sampsPerBuff, int blockSamples, uint64_t totalSamples,
+                             uint64_t* samplesRun){
+    size_t sampleSize = 2*format->componentSize;
+    uhd_usrp_handle usrp = benchMakeUsrp(sampsPerBuff);
+    uhd_tx_streamer_handle tx_streamer;
+    uhd_tx_metadata_handle tx_md;
+    uhd_tx_streamer_make(&tx_streamer);
+    uhd_tx_metadata_make(&tx_md, false, 0, 0.1, true, false);
+    size_t channel = 0;
+    uhd_stream_args_t stream_args = {
+            .cpu_format = (char*) format->name,
+            .otw_format = "sc16",
+            .args = "",
+            .channel_list = &channel,
+            .n_channels = 1
+    };
+    uhd_usrp_get_tx_stream(usrp, &stream_args, tx_streamer);
+
+    spscRing_t ring;
+    if(benchRingInit(&ring, blockSamples*sampleSize) != 0){
+        printf("Error creating Tx ring\n");
+        exit(1);
+    }
+
+    bool terminateStatus = false;
+    telemetryCounters_t telemetry;
+    memset(&telemetry, 0, sizeof(telemetry));
+    txHandlerArgs_t args;
+    memset(&args, 0, sizeof(args));
+    args.terminateStatus = &terminateStatus;
+    args.txRing = &ring;
+    args.tx_streamer = tx_streamer;
+    args.tx_md = tx_md;
+    args.samplesPerTransactTx = blockSamples;
+    args.numChannels = 1;
+    args.txPrefillBlocks = 1;
+    args.pipeFormat = PIPE_FORMAT_PLANAR;
+    args.cpuFormat = format->cpuFormat;
+    args.forceFullTxBuffer = true; //Carries the remainder to the next block
+    args.framed = false;
+    args.txRateLimit = false;
+    args.blockStamps = NULL;
+    args.latency = NULL;
+    args.telemetry = &telemetry;
+    args.verbose = false;
+
+    uint64_t targetBlocks = (totalSamples + blockSamples - 1)/blockSamples;
+    double start = benchNow();
+    pthread_t txThread;
+    pthread_create(&txThread, NULL, txHandler, &args);
+    for(uint64_t block = 0; block<targetBlocks; block++){
+        if(spscRingAcquireWrite(&ring, &terminateStatus) == NULL){
+            break;
+        }
+        spscRingCommitWrite(&ring);
+    }
+    spscRingProducerDone(&ring); //The Tx handler stops once it has sent every block
+    pthread_join(txThread, NULL);
+    double elapsed = benchNow() - start;
+
+    spscRingFree(&ring);
+    uhd_tx_metadata_free(&tx_md);
+    uhd_tx_streamer_free(&tx_streamer);
+    uhd_usrp_free(&usrp);
+    *samplesRun = targetBlocks*blockSamples;
+    return elapsed;
+}
+
+//Points the kernels used by the handlers at the given variant
+static void benchSelectVariant(const benchVariant_t* variant){
+    deinterleave32 = variant->deinterleave[0];
+    deinterleave16 = variant->deinterleave[1];
+    deinterleave8 = variant->deinterleave[2];
+    interleave32 = variant->interleave[0];
+    interleave16 = variant->interleave[1];
+    interleave8 = variant->interleave[2];
+}
+
+int main(int argc, char* argv[]){
+    bool runFormats[BENCH_NUM_FORMATS] = {true, true, true};
+    char* onlyVariant = NULL;
+    int sizes[BENCH_MAX_LIST] = {256, 4096, 65536, 1048576};
+    int numSizes = 4;
+    int buffs[BENCH_MAX_LIST] = {364, 1996, 8192};
+    int numBuffs = 3;
+    int blocks[BENCH_MAX_LIST] = {256, 1000, 4096, 65536};
+    int numBlocks = 4;
+    uint64_t totalSamples = 1 << 24;
+    bool runKernels = true;
+    bool runReblock = true;
+    char* csvPath = NULL;
+    bool verbose = false;
+
+    for(int i = 1; i<argc; i++){
+        if(strcmp(argv[i], "--cpuformat") == 0 && i+1<argc){
+            i++;
+            for(size_t formatInd = 0; formatInd<BENCH_NUM_FORMATS; formatInd++){
+                runFormats[formatInd] = false;
+            }
+            char* savePtr = NULL;
+            for(char* item = strtok_r(argv[i], ",", &savePtr); item != NULL; item = strtok_r(NULL, ",", &savePtr)){
+                bool found = false;
+                for(size_t formatInd = 0; formatInd<BENCH_NUM_FORMATS; formatInd++){
+                    if(strcmp(item, benchFormats[formatInd].name) == 0){
+                        runFormats[formatInd] = true;
+                        found = true;
+                    }
+                }
+                if(!found){
+                    print_help();
+                    exit(1);
+                }
+            }
+        }else if(strcmp(argv[i], "--variant") == 0 && i+1<argc){
+            onlyVariant = argv[++i];
+        }else if(strcmp(argv[i], "--sizes") == 0 && i+1<argc){
+            numSizes = benchParseList(argv[++i], sizes);
+        }else if(strcmp(argv[i], "--buffs") == 0 && i+1<argc){
+            numBuffs = benchParseList(argv[++i], buffs);
+        }else if(strcmp(argv[i], "--blocks") == 0 && i+1<argc){
+            numBlocks = benchParseList(argv[++i], blocks);
+        }else if(strcmp(argv[i], "--samples") == 0 && i+1<argc){
+            totalSamples = strtoull(argv[++i], NULL, 10);
+        }else if(strcmp(argv[i], "--nokernels") == 0){
+            runKernels = false;
+        }else if(strcmp(argv[i], "--noreblock") == 0){
+            runReblock = false;
+        }else if(strcmp(argv[i], "--csv") == 0 && i+1<argc){
+            csvPath = argv[++i];
+        }else if(strcmp(argv[i], "-v") == 0){
+            verbose = true;
+        }else{
+            print_help();
+            exit(1);
+        }
+    }
+    if(totalSamples == 0){
+        print_help();
+        exit(1);
+    }
+
+    FILE* csv = NULL;
+    if(csvPath != NULL){
+        csv = fopen(csvPath, "w");
+        if(csv == NULL){
+            printf("Unable to open CSV file: %s\n", csvPath);
+            perror(NULL);
+            exit(1);
+        }
+        fprintf(csv, "section,direction,format,variant,samps_per_buff,block_samples,ns_per_sample,gb_per_s\n");
+    }
+
+    //The handlers print their setup and summary to stderr
+    int savedStderr = dup(STDERR_FILENO);
+    if(!verbose){
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDERR_FILENO);
+        close(devNull);
+    }
+
+    printf("%-9s %-13s %-5s %-7s %10s %10s %10s %9s\n", "Section", "Direction", "Fmt", "Variant", "Buff/Size", "Block",
+           "ns/sample", "GB/s");
+    for(size_t variantInd = 0; variantInd<BENCH_NUM_VARIANTS; variantInd++){
+        const benchVariant_t* variant = &benchVariants[variantInd];
+        if(!benchIsaSupported(variant->isa) || (onlyVariant != NULL && strcmp(onlyVariant, variant->name) != 0)){
+            continue;
+        }
+
+        for(size_t formatInd = 0; formatInd<BENCH_NUM_FORMATS && runKernels; formatInd++){
+            const benchFormat_t* format = &benchFormats[formatInd];
+            if(!runFormats[formatInd]){
+                continue;
+            }
+            size_t sampleSize = 2*format->componentSize;
+            for(int sizeInd = 0; sizeInd<numSizes; sizeInd++){
+                size_t numSamples = sizes[sizeInd];
+                char* interleaved = calloc(numSamples, sampleSize);
+                char* re = calloc(numSamples, format->componentSize);
+                char* im = calloc(numSamples, format->componentSize);
+                for(int dirInd = 0; dirInd<2; dirInd++){
+                    bool deinterleave = dirInd == 0;
+                    uint64_t samplesRun;
+                    double elapsed = benchKernel(variant, format, deinterleave, numSamples, totalSamples, interleaved, re, im, &samplesRun);
+                    benchReport(csv, "kernel", deinterleave ? "deinterleave" : "interleave", format->name, variant->name,
+                                (int) numSamples, 0, samplesRun, elapsed, sampleSize);
+                }
+                free(interleaved);
+                free(re);
+                free(im);
+            }
+        }
+
+        benchSelectVariant(variant);
+        for(size_t formatInd = 0; formatInd<BENCH_NUM_FORMATS && runReblock; formatInd++){
+            const benchFormat_t* format = &benchFormats[formatInd];
+            if(!runFormats[formatInd]){
+                continue;
+            }
+            size_t sampleSize = 2*format->componentSize;
+            for(int dirInd = 0; dirInd<2; dirInd++){
+                bool rx = dirInd == 0;
+                for(int buffInd = 0; buffInd<numBuffs; buffInd++){
+                    for(int blockInd = 0; blockInd<numBlocks; blockInd++){
+                        uint64_t samplesRun;
+                        double elapsed = rx ? benchRxReblock(format, buffs[buffInd], blocks[blockInd], totalSamples, &samplesRun) :
+                                              benchTxReblock(format, buffs[buffInd], blocks[blockInd], totalSamples, &samplesRun);
+                        benchReport(csv, "reblock", rx ? "rx" : "tx", format->name, variant->name, buffs[buffInd],
+                                    blocks[blockInd], samplesRun, elapsed, sampleSize);
+                    }
+                }
+            }
+        }
+    }
+
+    dup2(savedStderr, STDERR_FILENO);
+    close(savedStderr);
+    if(csv != NULL){
+        fclose(csv);
+    }
+    return 0;
+}
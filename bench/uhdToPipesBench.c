@@ -0,0 +1,412 @@
+//
+// Measures the maximum sustained sample rate through uhdToPipes for a sweep of block sizes (samples per transaction).
+// Runs uhdToPipes_mock (uhdToPipes linked against the mock UHD backend, producing/consuming samples as fast as possible)
+// against a FIFO which this driver drains (Rx) or fills (Tx), counting the bytes moved after a warm up period.  With
+// --shm, the shm transport is used instead and this driver releases (Rx) or commits (Tx) blocks of the shared memory ring
+// without touching the samples.
+//
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "../src/shmRing.h"
+
+#define BENCH_MAX_BLOCK_SIZES (32)
+#define BENCH_MAX_CHILD_ARGS (64)
+#define BENCH_IO_BLOCKS (16) //Blocks moved by each read/write of the FIFO
+
+void print_help(void){
+    fprintf(stderr, "uhdToPipes_bench - Measures the maximum sustained sample rate through uhdToPipes (using the mock UHD backend)\n\n"
+
+                    "Options:\n"
+                    "    --exe (path to uhdToPipes_mock - defaults to the one next to this executable)\n"
+                    "    --blocksizes (comma separated list of samples per transaction to sweep - defaults to 256,1024,4096,16384,65536)\n"
+                    "    --seconds (measurement time for each block size - defaults to 2)\n"
+                    "    --warmup (time before measuring for each block size - defaults to 0.5)\n"
+                    "    --rx (only measure Rx)\n"
+                    "    --tx (only measure Tx)\n"
+                    "    -a (mock device args - defaults to paced=0, see mock/uhdMock.c)\n"
+                    "    --cpuformat (fc32 (default), sc16, or sc8)\n"
+                    "    --shm (use the shm transport instead of a FIFO)\n"
+                    "    -v (show the output of uhdToPipes_mock)\n"
+                    "    -h (print this help message)\n"
+                    "    -- (the remaining arguments are passed to uhdToPipes_mock, ex. -- --pipeformat interleaved --rxcpu 2)\n");
+}
+
+static double benchNow(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+static size_t benchComponentSize(const char* cpuFormat){
+    if(strcmp(cpuFormat, "sc8") == 0){
+        return 1;
+    }else if(strcmp(cpuFormat, "sc16") == 0){
+        return 2;
+    }
+    return 4;
+}
+
+//Returns true if the child has exited
+static bool benchChildExited(pid_t child){
+    int status;
+    return waitpid(child, &status, WNOHANG) == child;
+}
+
+static pid_t benchSpawn(char** childArgs, bool verbose){
+    pid_t child = fork();
+    if(child == 0){
+        if(!verbose){
+            int devNull = open("/dev/null", O_WRONLY);
+            dup2(devNull, STDOUT_FILENO);
+            dup2(devNull, STDERR_FILENO);
+        }
+        execv(childArgs[0], childArgs);
+        perror("Unable to start uhdToPipes_mock");
+        _exit(1);
+    }
+    return child;
+}
+
+//Drains the Rx FIFO.  Returns the bytes per second after the warm up (or a negative number on error)
+static double benchRx(char* fifoPath, pid_t child, size_t blockBytes, double warmup, double seconds){
+    //Opened non-blocking so that a child which fails before opening its end does not hang the driver.  Until the writer
+    //connects, reads return 0
+    int fifo = open(fifoPath, O_RDONLY | O_NONBLOCK);
+    if(fifo < 0){
+        perror("Unable to open Rx FIFO");
+        return -1;
+    }
+    size_t bufBytes = blockBytes*BENCH_IO_BLOCKS;
+    char* buf = malloc(bufBytes);
+    while(true){
+        ssize_t bytesRead = read(fifo, buf, bufBytes);
+        if(bytesRead > 0 || (bytesRead < 0 && errno == EAGAIN)){
+            break; //The writer is connected
+        }
+        if(benchChildExited(child)){
+            fprintf(stderr, "uhdToPipes_mock exited before opening the Rx pipe\n");
+            close(fifo);
+            free(buf);
+            return -1;
+        }
+        usleep(1000);
+    }
+    fcntl(fifo, F_SETFL, fcntl(fifo, F_GETFL) & ~O_NONBLOCK);
+
+    double start = benchNow();
+    double measureStart = start + warmup;
+    double end = measureStart + seconds;
+    double now = start;
+    uint64_t bytes = 0;
+    while(now < end){
+        ssize_t bytesRead = read(fifo, buf, bufBytes);
+        if(bytesRead <= 0){
+            fprintf(stderr, "Rx pipe closed early\n");
+            break;
+        }
+        now = benchNow();
+        if(now >= measureStart){
+            bytes += bytesRead;
+        }
+    }
+    double elapsed = now - measureStart;
+
+    //Stop the child and drain the pipe so that it can exit
+    kill(child, SIGINT);
+    while(read(fifo, buf, bufBytes) > 0);
+    close(fifo);
+    free(buf);
+    return elapsed > 0 ? bytes/elapsed : -1;
+}
+
+//Fills the Tx FIFO.  Returns the bytes per second after the warm up (or a negative number on error)
+static double benchTx(char* fifoPath, pid_t child, size_t blockBytes, double warmup, double seconds){
+    //Opening the write end non-blocking fails until the reader has opened the FIFO
+    int fifo;
+    while((fifo = open(fifoPath, O_WRONLY | O_NONBLOCK)) < 0){
+        if(errno != ENXIO || benchChildExited(child)){
+            fprintf(stderr, "uhdToPipes_mock exited before opening the Tx pipe\n");
+            return -1;
+        }
+        usleep(1000);
+    }
+    fcntl(fifo, F_SETFL, fcntl(fifo, F_GETFL) & ~O_NONBLOCK);
+
+    size_t bufBytes = blockBytes*BENCH_IO_BLOCKS;
+    char* buf = calloc(bufBytes, 1);
+    double start = benchNow();
+    double measureStart = start + warmup;
+    double end = measureStart + seconds;
+    double now = start;
+    uint64_t bytes = 0;
+    while(now < end){
+        ssize_t bytesWritten = write(fifo, buf, bufBytes);
+        if(bytesWritten <= 0){
+            fprintf(stderr, "Tx pipe closed early\n");
+            break;
+        }
+        now = benchNow();
+        if(now >= measureStart){
+            bytes += bytesWritten;
+        }
+    }
+    double elapsed = now - measureStart;
+
+    //EOF on the Tx pipe stops the child
+    close(fifo);
+    free(buf);
+    return elapsed > 0 ? bytes/elapsed : -1;
+}
+
+//Opens the shared memory ring once the child has created it.  Returns false if the child exits first
+static bool benchShmOpen(shmRing_t* ring, char* shmName, pid_t child){
+    while(shmRingOpen(ring, shmName) != 0){
+        if((errno != ENOENT && errno != EAGAIN) || benchChildExited(child)){
+            fprintf(stderr, "uhdToPipes_mock exited before creating the shared memory ring\n");
+            return false;
+        }
+        usleep(1000);
+    }
+    return true;
+}
+
+//Releases the blocks of the Rx shared memory ring as they are committed.  Returns the bytes per second after the warm up
+//(or a negative number on error).  The ring is polled rather than waited on so that a child which exits without marking
+//the ring done does not hang the driver
+static double benchRxShm(char* shmName, pid_t child, double warmup, double seconds){
+    shmRing_t ring;
+    if(!benchShmOpen(&ring, shmName, child)){
+        return -1;
+    }
+
+    double start = benchNow();
+    double measureStart = start + warmup;
+    double end = measureStart + seconds;
+    double now = start;
+    uint64_t bytes = 0;
+    while(now < end){
+        size_t available = shmRingReadAvailable(&ring);
+        if(available == 0){
+            if(atomic_load(&ring.header->producerDone) || benchChildExited(child)){
+                fprintf(stderr, "Rx shared memory ring closed early\n");
+                break;
+            }
+            sched_yield();
+        }else{
+            shmRingReleaseReadN(&ring, available);
+        }
+        now = benchNow();
+        if(now >= measureStart){
+            bytes += available*ring.blockSize;
+        }
+    }
+    double elapsed = now - measureStart;
+
+    //Stop the child and drain the ring so that it can exit
+    kill(child, SIGINT);
+    while(!atomic_load(&ring.header->producerDone) && !benchChildExited(child)){
+        shmRingReleaseReadN(&ring, shmRingReadAvailable(&ring));
+        sched_yield();
+    }
+    shmRingClose(&ring);
+    return elapsed > 0 ? bytes/elapsed : -1;
+}
+
+//Commits blocks to the Tx shared memory ring as they are freed.  Returns the bytes per second after the warm up (or a
+//negative number on error)
+static double benchTxShm(char* shmName, pid_t child, double warmup, double seconds){
+    shmRing_t ring;
+    if(!benchShmOpen(&ring, shmName, child)){
+        return -1;
+    }
+
+    double start = benchNow();
+    double measureStart = start + warmup;
+    double end = measureStart + seconds;
+    double now = start;
+    uint64_t bytes = 0;
+    while(now < end){
+        size_t available = shmRingWriteAvailable(&ring);
+        if(available == 0){
+            if(benchChildExited(child)){
+                fprintf(stderr, "Tx shared memory ring closed early\n");
+                break;
+            }
+            sched_yield();
+        }else{
+            shmRingCommitWriteN(&ring, available);
+        }
+        now = benchNow();
+        if(now >= measureStart){
+            bytes += available*ring.blockSize;
+        }
+    }
+    double elapsed = now - measureStart;
+
+    //The equivalent of EOF on the Tx pipe stops the child
+    shmRingProducerDone(&ring);
+    shmRingClose(&ring);
+    return elapsed > 0 ? bytes/elapsed : -1;
+}
+
+int main(int argc, char* argv[]){
+    char* exe = NULL;
+    int blockSizes[BENCH_MAX_BLOCK_SIZES] = {256, 1024, 4096, 16384, 65536};
+    int numBlockSizes = 5;
+    double seconds = 2;
+    double warmup = 0.5;
+    bool runRx = true;
+    bool runTx = true;
+    char* deviceArgs = "paced=0";
+    char* cpuFormat = "fc32";
+    bool shm = false;
+    bool verbose = false;
+    char** extraArgs = NULL;
+    int numExtraArgs = 0;
+
+    for(int i = 1; i<argc; i++){
+        if(strcmp(argv[i], "--") == 0){
+            extraArgs = argv+i+1;
+            numExtraArgs = argc-i-1;
+            break;
+        }else if(strcmp(argv[i], "--exe") == 0 && i+1<argc){
+            exe = argv[++i];
+        }else if(strcmp(argv[i], "--blocksizes") == 0 && i+1<argc){
+            numBlockSizes = 0;
+            char* savePtr = NULL;
+            for(char* item = strtok_r(argv[++i], ",", &savePtr); item != NULL && numBlockSizes<BENCH_MAX_BLOCK_SIZES; item = strtok_r(NULL, ",", &savePtr)){
+                blockSizes[numBlockSizes++] = atoi(item);
+            }
+        }else if(strcmp(argv[i], "--seconds") == 0 && i+1<argc){
+            seconds = atof(argv[++i]);
+        }else if(strcmp(argv[i], "--warmup") == 0 && i+1<argc){
+            warmup = atof(argv[++i]);
+        }else if(strcmp(argv[i], "--rx") == 0){
+            runTx = false;
+        }else if(strcmp(argv[i], "--tx") == 0){
+            runRx = false;
+        }else if(strcmp(argv[i], "-a") == 0 && i+1<argc){
+            deviceArgs = argv[++i];
+        }else if(strcmp(argv[i], "--cpuformat") == 0 && i+1<argc){
+            cpuFormat = argv[++i];
+        }else if(strcmp(argv[i], "--shm") == 0){
+            shm = true;
+        }else if(strcmp(argv[i], "-v") == 0){
+            verbose = true;
+        }else{
+            print_help();
+            exit(1);
+        }
+    }
+    if(numExtraArgs > BENCH_MAX_CHILD_ARGS-16){
+        printf("Too many arguments for uhdToPipes_mock\n");
+        exit(1);
+    }
+
+    //Default to the mock build next to this executable
+    char exePath[PATH_MAX];
+    if(exe == NULL){
+        ssize_t len = readlink("/proc/self/exe", exePath, sizeof(exePath)-1);
+        if(len < 0){
+            printf("Unable to find uhdToPipes_mock, use --exe\n");
+            exit(1);
+        }
+        exePath[len] = '\0';
+        char* dir = dirname(exePath);
+        memmove(exePath, dir, strlen(dir)+1);
+        strncat(exePath, "/uhdToPipes_mock", sizeof(exePath)-strlen(exePath)-1);
+        exe = exePath;
+    }
+
+    char fifoDir[] = "/tmp/uhdToPipesBenchXXXXXX";
+    if(mkdtemp(fifoDir) == NULL){
+        perror("Unable to create FIFO directory");
+        exit(1);
+    }
+    char fifoPath[PATH_MAX];
+    snprintf(fifoPath, sizeof(fifoPath), "%s/pipe", fifoDir);
+    char shmName[64];
+    snprintf(shmName, sizeof(shmName), "/uhdToPipesBench%d", (int) getpid());
+
+    signal(SIGPIPE, SIG_IGN); //A child which exits early is reported by the write
+    size_t sampleSize = 2*benchComponentSize(cpuFormat);
+
+    printf("%-4s %12s %14s %12s\n", "Dir", "Block (samp)", "Rate (MS/s)", "Rate (MB/s)");
+    int returnCode = 0;
+    for(int dirInd = 0; dirInd<2; dirInd++){
+        bool rx = dirInd == 0;
+        if((rx && !runRx) || (!rx && !runTx)){
+            continue;
+        }
+        for(int sizeInd = 0; sizeInd<numBlockSizes; sizeInd++){
+            char blockSizeStr[32];
+            snprintf(blockSizeStr, sizeof(blockSizeStr), "%d", blockSizes[sizeInd]);
+
+            char* childArgs[BENCH_MAX_CHILD_ARGS];
+            int numChildArgs = 0;
+            childArgs[numChildArgs++] = exe;
+            childArgs[numChildArgs++] = "-a";
+            childArgs[numChildArgs++] = deviceArgs;
+            childArgs[numChildArgs++] = "--cpuformat";
+            childArgs[numChildArgs++] = cpuFormat;
+            if(shm){
+                childArgs[numChildArgs++] = "--transport";
+                childArgs[numChildArgs++] = "shm";
+            }
+            childArgs[numChildArgs++] = rx ? "--rxpipe" : "--txpipe";
+            childArgs[numChildArgs++] = shm ? shmName : fifoPath;
+            childArgs[numChildArgs++] = rx ? "--samppertransactrx" : "--samppertransacttx";
+            childArgs[numChildArgs++] = blockSizeStr;
+            for(int argInd = 0; argInd<numExtraArgs; argInd++){
+                childArgs[numChildArgs++] = extraArgs[argInd];
+            }
+            childArgs[numChildArgs] = NULL;
+
+            unlink(fifoPath);
+            if(!shm && mkfifo(fifoPath, 0600) != 0){
+                perror("Unable to create FIFO");
+                returnCode = 1;
+                break;
+            }
+
+            pid_t child = benchSpawn(childArgs, verbose);
+            size_t blockBytes = blockSizes[sizeInd]*sampleSize;
+            double bytesPerSec;
+            if(shm){
+                bytesPerSec = rx ? benchRxShm(shmName, child, warmup, seconds) : benchTxShm(shmName, child, warmup, seconds);
+            }else{
+                bytesPerSec = rx ? benchRx(fifoPath, child, blockBytes, warmup, seconds) :
+                                   benchTx(fifoPath, child, blockBytes, warmup, seconds);
+            }
+            int status;
+            waitpid(child, &status, 0);
+
+            if(bytesPerSec < 0){
+                printf("%-4s %12d %14s %12s\n", rx ? "Rx" : "Tx", blockSizes[sizeInd], "failed", "-");
+                returnCode = 1;
+            }else{
+                printf("%-4s %12d %14.2f %12.1f\n", rx ? "Rx" : "Tx", blockSizes[sizeInd], bytesPerSec/sampleSize/1e6, bytesPerSec/1e6);
+            }
+            fflush(stdout);
+        }
+    }
+
+    unlink(fifoPath);
+    rmdir(fifoDir);
+    shmRingUnlink(shmName); //Normally removed by the child
+    return returnCode;
+}
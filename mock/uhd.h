@@ -0,0 +1,168 @@
+//
+// Hardware-free stand-in for the UHD C API header.  Declares the subset of the UHD C API used by uhdToPipes with the
+// same types and signatures as UHD so that the streaming code compiles unchanged against either.  The implementation
+// (uhdMock.c) produces and consumes synthetic samples, see uhdMock.c for the device args it accepts.
+//
+
+#ifndef UHDTOPIPES_MOCK_UHD_H
+#define UHDTOPIPES_MOCK_UHD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef enum{
+    UHD_ERROR_NONE = 0,
+    UHD_ERROR_INVALID_DEVICE = 1,
+    UHD_ERROR_INDEX = 10,
+    UHD_ERROR_KEY = 11,
+    UHD_ERROR_NOT_IMPLEMENTED = 20,
+    UHD_ERROR_USB = 21,
+    UHD_ERROR_IO = 30,
+    UHD_ERROR_OS = 31,
+    UHD_ERROR_ASSERTION = 40,
+    UHD_ERROR_LOOKUP = 41,
+    UHD_ERROR_TYPE = 42,
+    UHD_ERROR_VALUE = 43,
+    UHD_ERROR_RUNTIME = 44,
+    UHD_ERROR_ENVIRONMENT = 45,
+    UHD_ERROR_SYSTEM = 46,
+    UHD_ERROR_EXCEPT = 47,
+    UHD_ERROR_BOOSTEXCEPT = 60,
+    UHD_ERROR_STDEXCEPT = 70,
+    UHD_ERROR_UNKNOWN = 100
+} uhd_error;
+
+typedef struct uhd_usrp* uhd_usrp_handle;
+typedef struct uhd_rx_streamer* uhd_rx_streamer_handle;
+typedef struct uhd_tx_streamer* uhd_tx_streamer_handle;
+typedef struct uhd_rx_metadata_t* uhd_rx_metadata_handle;
+typedef struct uhd_tx_metadata_t* uhd_tx_metadata_handle;
+typedef struct uhd_async_metadata_t* uhd_async_metadata_handle;
+
+typedef enum{
+    UHD_RX_METADATA_ERROR_CODE_NONE = 0x0,
+    UHD_RX_METADATA_ERROR_CODE_TIMEOUT = 0x1,
+    UHD_RX_METADATA_ERROR_CODE_LATE_COMMAND = 0x2,
+    UHD_RX_METADATA_ERROR_CODE_BROKEN_CHAIN = 0x4,
+    UHD_RX_METADATA_ERROR_CODE_OVERFLOW = 0x8,
+    UHD_RX_METADATA_ERROR_CODE_ALIGNMENT = 0xC,
+    UHD_RX_METADATA_ERROR_CODE_BAD_PACKET = 0xF
+} uhd_rx_metadata_error_code_t;
+
+typedef enum{
+    UHD_ASYNC_METADATA_EVENT_CODE_BURST_ACK = 0x1,
+    UHD_ASYNC_METADATA_EVENT_CODE_UNDERFLOW = 0x2,
+    UHD_ASYNC_METADATA_EVENT_CODE_SEQ_ERROR = 0x4,
+    UHD_ASYNC_METADATA_EVENT_CODE_TIME_ERROR = 0x8,
+    UHD_ASYNC_METADATA_EVENT_CODE_UNDERFLOW_IN_PACKET = 0x10,
+    UHD_ASYNC_METADATA_EVENT_CODE_SEQ_ERROR_IN_BURST = 0x20,
+    UHD_ASYNC_METADATA_EVENT_CODE_USER_PAYLOAD = 0x40
+} uhd_async_metadata_event_code_t;
+
+typedef enum{
+    UHD_STREAM_MODE_START_CONTINUOUS = 97,
+    UHD_STREAM_MODE_STOP_CONTINUOUS = 111,
+    UHD_STREAM_MODE_NUM_SAMPS_AND_DONE = 100,
+    UHD_STREAM_MODE_NUM_SAMPS_AND_MORE = 109
+} uhd_stream_mode_t;
+
+typedef struct{
+    uhd_stream_mode_t stream_mode;
+    size_t num_samps;
+    bool stream_now;
+    int64_t time_spec_full_secs;
+    double time_spec_frac_secs;
+} uhd_stream_cmd_t;
+
+typedef struct{
+    char* cpu_format;
+    char* otw_format;
+    char* args;
+    size_t* channel_list;
+    int n_channels;
+} uhd_stream_args_t;
+
+typedef enum{
+    UHD_TUNE_REQUEST_POLICY_NONE = 78,
+    UHD_TUNE_REQUEST_POLICY_AUTO = 65,
+    UHD_TUNE_REQUEST_POLICY_MANUAL = 77
+} uhd_tune_request_policy_t;
+
+typedef struct{
+    double target_freq;
+    uhd_tune_request_policy_t rf_freq_policy;
+    double rf_freq;
+    uhd_tune_request_policy_t dsp_freq_policy;
+    double dsp_freq;
+    char* args;
+} uhd_tune_request_t;
+
+typedef struct{
+    double clipped_rf_freq;
+    double target_rf_freq;
+    double actual_rf_freq;
+    double target_dsp_freq;
+    double actual_dsp_freq;
+} uhd_tune_result_t;
+
+static const float uhd_default_thread_priority = 0.5f;
+uhd_error uhd_set_thread_priority(float priority, bool realtime);
+
+//USRP
+uhd_error uhd_usrp_make(uhd_usrp_handle* h, const char* args);
+uhd_error uhd_usrp_free(uhd_usrp_handle* h);
+uhd_error uhd_usrp_last_error(uhd_usrp_handle h, char* error_out, size_t strbuffer_len);
+uhd_error uhd_usrp_get_rx_stream(uhd_usrp_handle h, uhd_stream_args_t* stream_args, uhd_rx_streamer_handle h_out);
+uhd_error uhd_usrp_get_tx_stream(uhd_usrp_handle h, uhd_stream_args_t* stream_args, uhd_tx_streamer_handle h_out);
+uhd_error uhd_usrp_set_rx_rate(uhd_usrp_handle h, double rate, size_t chan);
+uhd_error uhd_usrp_get_rx_rate(uhd_usrp_handle h, size_t chan, double* rate_out);
+uhd_error uhd_usrp_set_rx_gain(uhd_usrp_handle h, double gain, size_t chan, const char* gain_name);
+uhd_error uhd_usrp_get_rx_gain(uhd_usrp_handle h, size_t chan, const char* gain_name, double* gain_out);
+uhd_error uhd_usrp_set_rx_freq(uhd_usrp_handle h, uhd_tune_request_t* tune_request, size_t chan, uhd_tune_result_t* tune_result);
+uhd_error uhd_usrp_get_rx_freq(uhd_usrp_handle h, size_t chan, double* freq_out);
+uhd_error uhd_usrp_set_tx_rate(uhd_usrp_handle h, double rate, size_t chan);
+uhd_error uhd_usrp_get_tx_rate(uhd_usrp_handle h, size_t chan, double* rate_out);
+uhd_error uhd_usrp_set_tx_gain(uhd_usrp_handle h, double gain, size_t chan, const char* gain_name);
+uhd_error uhd_usrp_get_tx_gain(uhd_usrp_handle h, size_t chan, const char* gain_name, double* gain_out);
+uhd_error uhd_usrp_set_tx_freq(uhd_usrp_handle h, uhd_tune_request_t* tune_request, size_t chan, uhd_tune_result_t* tune_result);
+uhd_error uhd_usrp_get_tx_freq(uhd_usrp_handle h, size_t chan, double* freq_out);
+
+//Rx streamer
+uhd_error uhd_rx_streamer_make(uhd_rx_streamer_handle* h);
+uhd_error uhd_rx_streamer_free(uhd_rx_streamer_handle* h);
+uhd_error uhd_rx_streamer_max_num_samps(uhd_rx_streamer_handle h, size_t* max_num_samps_out);
+uhd_error uhd_rx_streamer_recv(uhd_rx_streamer_handle h, void** buffs, size_t samps_per_buff, uhd_rx_metadata_handle* md,
+                               double timeout, bool one_packet, size_t* items_recvd);
+uhd_error uhd_rx_streamer_issue_stream_cmd(uhd_rx_streamer_handle h, const uhd_stream_cmd_t* stream_cmd);
+
+//Rx metadata
+uhd_error uhd_rx_metadata_make(uhd_rx_metadata_handle* handle);
+uhd_error uhd_rx_metadata_free(uhd_rx_metadata_handle* handle);
+uhd_error uhd_rx_metadata_has_time_spec(uhd_rx_metadata_handle h, bool* result_out);
+uhd_error uhd_rx_metadata_time_spec(uhd_rx_metadata_handle h, int64_t* full_secs_out, double* frac_secs_out);
+uhd_error uhd_rx_metadata_error_code(uhd_rx_metadata_handle h, uhd_rx_metadata_error_code_t* error_code_out);
+
+//Tx streamer
+uhd_error uhd_tx_streamer_make(uhd_tx_streamer_handle* h);
+uhd_error uhd_tx_streamer_free(uhd_tx_streamer_handle* h);
+uhd_error uhd_tx_streamer_max_num_samps(uhd_tx_streamer_handle h, size_t* max_num_samps_out);
+uhd_error uhd_tx_streamer_send(uhd_tx_streamer_handle h, const void** buffs, size_t samps_per_buff, uhd_tx_metadata_handle* md,
+                               double timeout, size_t* items_sent);
+uhd_error uhd_tx_streamer_recv_async_msg(uhd_tx_streamer_handle h, uhd_async_metadata_handle* md, double timeout, bool* valid);
+
+//Tx metadata
+uhd_error uhd_tx_metadata_make(uhd_tx_metadata_handle* handle, bool has_time_spec, int64_t full_secs, double frac_secs,
+                               bool start_of_burst, bool end_of_burst);
+uhd_error uhd_tx_metadata_free(uhd_tx_metadata_handle* handle);
+
+//Async metadata
+uhd_error uhd_async_metadata_make(uhd_async_metadata_handle* handle);
+uhd_error uhd_async_metadata_free(uhd_async_metadata_handle* handle);
+uhd_error uhd_async_metadata_channel(uhd_async_metadata_handle h, size_t* channel_out);
+uhd_error uhd_async_metadata_has_time_spec(uhd_async_metadata_handle h, bool* result_out);
+uhd_error uhd_async_metadata_time_spec(uhd_async_metadata_handle h, int64_t* full_secs_out, double* frac_secs_out);
+uhd_error uhd_async_metadata_event_code(uhd_async_metadata_handle h, uhd_async_metadata_event_code_t* event_code_out);
+
+#endif //UHDTOPIPES_MOCK_UHD_H
@@ -0,0 +1,658 @@
+//
+// Hardware-free implementation of the subset of the UHD C API used by uhdToPipes.  Rx streamers produce synthetic
+// samples (a ramp) and Tx streamers consume (read) the samples passed to them, either paced at the configured sample
+// rate or as fast as possible.  The device time is the time since uhd_usrp_make.
+//
+// Configured with the device args (-a) as a comma separated list of key=value pairs:
+//     max_num_samps=N    (max samples per packet returned by uhd_rx/tx_streamer_max_num_samps - defaults to 2000)
+//     paced=0|1          (produce/consume samples at the sample rate (1, default) or as fast as possible (0))
+//     fill=0|1           (write the Rx ramp and read the Tx samples (1, default) or leave the buffers untouched (0) so that
+//                         benchmarks only measure the streaming code)
+//     overflow_every=N   (report an overflow every N Rx recv calls - defaults to 0 (never))
+//     overflow_samps=N   (samples dropped at each injected overflow - defaults to max_num_samps)
+//     timeout_every=N    (report a timeout (with no samples) every N Rx recv calls - defaults to 0 (never))
+//     underflow_every=N  (report an underflow every N Tx send calls - defaults to 0 (never))
+// When paced, a Tx send which is late is also reported as an underflow
+//
+
+#define _GNU_SOURCE
+#include "uhd.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UHD_MOCK_DEFAULT_MAX_NUM_SAMPS (2000)
+#define UHD_MOCK_DEFAULT_RATE (1e6)
+#define UHD_MOCK_ASYNC_QUEUE_LEN (64)
+#define UHD_MOCK_UNDERFLOW_SLACK_SECS (0.001) //A send this late (relative to when its first sample is due) underflows
+
+typedef struct{
+    size_t maxNumSamps;
+    bool paced;
+    bool fill;
+    size_t overflowEvery;
+    size_t overflowSamps;
+    size_t timeoutEvery;
+    size_t underflowEvery;
+} uhdMockConfig_t;
+
+struct uhd_usrp{
+    uhdMockConfig_t config;
+    struct timespec epoch; //Device time 0
+    double rxRate;
+    double txRate;
+    double rxGain;
+    double txGain;
+    double rxFreq;
+    double txFreq;
+    char lastError[256];
+};
+
+struct uhd_rx_metadata_t{
+    bool hasTimeSpec;
+    int64_t fullSecs;
+    double fracSecs;
+    uhd_rx_metadata_error_code_t errorCode;
+};
+
+struct uhd_tx_metadata_t{
+    bool hasTimeSpec;
+    int64_t fullSecs;
+    double fracSecs;
+    bool startOfBurst;
+    bool endOfBurst;
+};
+
+struct uhd_async_metadata_t{
+    size_t channel;
+    bool hasTimeSpec;
+    int64_t fullSecs;
+    double fracSecs;
+    uhd_async_metadata_event_code_t eventCode;
+};
+
+struct uhd_rx_streamer{
+    struct uhd_usrp* usrp;
+    size_t numChannels;
+    size_t componentSize;
+    bool streaming;
+    uint64_t nextSample; //Device sample index of the next sample returned
+    uint64_t recvCalls;
+};
+
+struct uhd_tx_streamer{
+    struct uhd_usrp* usrp;
+    size_t numChannels;
+    size_t componentSize;
+    bool started; //Set by the first send (or start of burst)
+    uint64_t nextSample; //Device sample index at which the next sample sent is due
+    uint64_t sendCalls;
+    volatile uint64_t consumed; //Sum of the samples read, keeps the reads from being optimized out
+
+    //Async messages are queued by the sending thread and received by the async monitor thread
+    pthread_mutex_t asyncLock;
+    pthread_cond_t asyncCond;
+    struct uhd_async_metadata_t asyncQueue[UHD_MOCK_ASYNC_QUEUE_LEN];
+    size_t asyncHead;
+    size_t asyncCount;
+};
+
+static double uhdMockElapsed(struct uhd_usrp* usrp){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - usrp->epoch.tv_sec) + (now.tv_nsec - usrp->epoch.tv_nsec)*1e-9;
+}
+
+//Sleeps until the given device time
+static void uhdMockSleepUntil(struct uhd_usrp* usrp, double deviceSecs){
+    double wholeSecs = floor(deviceSecs);
+    struct timespec wake = usrp->epoch;
+    wake.tv_sec += (time_t) wholeSecs;
+    wake.tv_nsec += (long) ((deviceSecs - wholeSecs)*1e9);
+    wake.tv_sec += wake.tv_nsec/1000000000;
+    wake.tv_nsec %= 1000000000;
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR);
+}
+
+static void uhdMockTimeSpec(uint64_t sample, double rate, int64_t* fullSecs, double* fracSecs){
+    double secs = sample/rate;
+    double wholeSecs = floor(secs);
+    *fullSecs = (int64_t) wholeSecs;
+    *fracSecs = secs - wholeSecs;
+}
+
+static double uhdMockToSamples(int64_t fullSecs, double fracSecs, double rate){
+    return fullSecs*rate + fracSecs*rate;
+}
+
+static size_t uhdMockComponentSize(const char* cpuFormat){
+    if(strcmp(cpuFormat, "sc8") == 0){
+        return 1;
+    }else if(strcmp(cpuFormat, "sc16") == 0){
+        return 2;
+    }
+    return 4; //fc32
+}
+
+//Parses the key=value pairs in the device args.  Unknown keys (ex. addr=) are ignored
+static uhd_error uhdMockParseArgs(uhdMockConfig_t* config, const char* args){
+    config->maxNumSamps = UHD_MOCK_DEFAULT_MAX_NUM_SAMPS;
+    config->paced = true;
+    config->fill = true;
+    config->overflowEvery = 0;
+    config->overflowSamps = 0;
+    config->timeoutEvery = 0;
+    config->underflowEvery = 0;
+
+    char* argsCopy = strdup(args == NULL ? "" : args);
+    char* savePtr = NULL;
+    for(char* pair = strtok_r(argsCopy, ",", &savePtr); pair != NULL; pair = strtok_r(NULL, ",", &savePtr)){
+        char* value = strchr(pair, '=');
+        if(value == NULL){
+            continue;
+        }
+        *value = '\0';
+        value++;
+        while(*pair == ' '){
+            pair++;
+        }
+
+        size_t number = strtoull(value, NULL, 10);
+        if(strcmp(pair, "max_num_samps") == 0){
+            config->maxNumSamps = number;
+        }else if(strcmp(pair, "paced") == 0){
+            config->paced = number != 0;
+        }else if(strcmp(pair, "fill") == 0){
+            config->fill = number != 0;
+        }else if(strcmp(pair, "overflow_every") == 0){
+            config->overflowEvery = number;
+        }else if(strcmp(pair, "overflow_samps") == 0){
+            config->overflowSamps = number;
+        }else if(strcmp(pair, "timeout_every") == 0){
+            config->timeoutEvery = number;
+        }else if(strcmp(pair, "underflow_every") == 0){
+            config->underflowEvery = number;
+        }
+    }
+    free(argsCopy);
+
+    if(config->maxNumSamps == 0){
+        return UHD_ERROR_VALUE;
+    }
+    if(config->overflowSamps == 0){
+        config->overflowSamps = config->maxNumSamps;
+    }
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_set_thread_priority(float priority, bool realtime){
+    (void) priority;
+    (void) realtime;
+    return UHD_ERROR_NONE;
+}
+
+// ==== USRP ====
+
+uhd_error uhd_usrp_make(uhd_usrp_handle* h, const char* args){
+    struct uhd_usrp* usrp = calloc(1, sizeof(struct uhd_usrp));
+    if(usrp == NULL){
+        return UHD_ERROR_OS;
+    }
+    usrp->rxRate = UHD_MOCK_DEFAULT_RATE;
+    usrp->txRate = UHD_MOCK_DEFAULT_RATE;
+    clock_gettime(CLOCK_MONOTONIC, &usrp->epoch);
+    *h = usrp;
+
+    uhd_error status = uhdMockParseArgs(&usrp->config, args);
+    if(status){
+        snprintf(usrp->lastError, sizeof(usrp->lastError), "Invalid mock device args: %s", args);
+        return status;
+    }
+    fprintf(stderr, "Mock USRP: max_num_samps=%zu, paced=%d, fill=%d, overflow_every=%zu (%zu samples), timeout_every=%zu, underflow_every=%zu\n",
+            usrp->config.maxNumSamps, usrp->config.paced, usrp->config.fill, usrp->config.overflowEvery, usrp->config.overflowSamps,
+            usrp->config.timeoutEvery, usrp->config.underflowEvery);
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_free(uhd_usrp_handle* h){
+    free(*h);
+    *h = NULL;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_last_error(uhd_usrp_handle h, char* error_out, size_t strbuffer_len){
+    if(strbuffer_len > 0){
+        snprintf(error_out, strbuffer_len, "%s", h->lastError);
+    }
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_get_rx_stream(uhd_usrp_handle h, uhd_stream_args_t* stream_args, uhd_rx_streamer_handle h_out){
+    h_out->usrp = h;
+    h_out->numChannels = stream_args->n_channels;
+    h_out->componentSize = uhdMockComponentSize(stream_args->cpu_format);
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_get_tx_stream(uhd_usrp_handle h, uhd_stream_args_t* stream_args, uhd_tx_streamer_handle h_out){
+    h_out->usrp = h;
+    h_out->numChannels = stream_args->n_channels;
+    h_out->componentSize = uhdMockComponentSize(stream_args->cpu_format);
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_set_rx_rate(uhd_usrp_handle h, double rate, size_t chan){
+    (void) chan;
+    if(rate <= 0){
+        return UHD_ERROR_VALUE;
+    }
+    h->rxRate = rate;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_get_rx_rate(uhd_usrp_handle h, size_t chan, double* rate_out){
+    (void) chan;
+    *rate_out = h->rxRate;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_set_rx_gain(uhd_usrp_handle h, double gain, size_t chan, const char* gain_name){
+    (void) chan;
+    (void) gain_name;
+    h->rxGain = gain;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_get_rx_gain(uhd_usrp_handle h, size_t chan, const char* gain_name, double* gain_out){
+    (void) chan;
+    (void) gain_name;
+    *gain_out = h->rxGain;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_set_rx_freq(uhd_usrp_handle h, uhd_tune_request_t* tune_request, size_t chan, uhd_tune_result_t* tune_result){
+    (void) chan;
+    h->rxFreq = tune_request->target_freq;
+    memset(tune_result, 0, sizeof(uhd_tune_result_t));
+    tune_result->target_rf_freq = tune_request->target_freq;
+    tune_result->actual_rf_freq = tune_request->target_freq;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_get_rx_freq(uhd_usrp_handle h, size_t chan, double* freq_out){
+    (void) chan;
+    *freq_out = h->rxFreq;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_set_tx_rate(uhd_usrp_handle h, double rate, size_t chan){
+    (void) chan;
+    if(rate <= 0){
+        return UHD_ERROR_VALUE;
+    }
+    h->txRate = rate;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_get_tx_rate(uhd_usrp_handle h, size_t chan, double* rate_out){
+    (void) chan;
+    *rate_out = h->txRate;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_set_tx_gain(uhd_usrp_handle h, double gain, size_t chan, const char* gain_name){
+    (void) chan;
+    (void) gain_name;
+    h->txGain = gain;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_get_tx_gain(uhd_usrp_handle h, size_t chan, const char* gain_name, double* gain_out){
+    (void) chan;
+    (void) gain_name;
+    *gain_out = h->txGain;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_set_tx_freq(uhd_usrp_handle h, uhd_tune_request_t* tune_request, size_t chan, uhd_tune_result_t* tune_result){
+    (void) chan;
+    h->txFreq = tune_request->target_freq;
+    memset(tune_result, 0, sizeof(uhd_tune_result_t));
+    tune_result->target_rf_freq = tune_request->target_freq;
+    tune_result->actual_rf_freq = tune_request->target_freq;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_usrp_get_tx_freq(uhd_usrp_handle h, size_t chan, double* freq_out){
+    (void) chan;
+    *freq_out = h->txFreq;
+    return UHD_ERROR_NONE;
+}
+
+// ==== Rx Streamer ====
+
+uhd_error uhd_rx_streamer_make(uhd_rx_streamer_handle* h){
+    *h = calloc(1, sizeof(struct uhd_rx_streamer));
+    return *h == NULL ? UHD_ERROR_OS : UHD_ERROR_NONE;
+}
+
+uhd_error uhd_rx_streamer_free(uhd_rx_streamer_handle* h){
+    free(*h);
+    *h = NULL;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_rx_streamer_max_num_samps(uhd_rx_streamer_handle h, size_t* max_num_samps_out){
+    *max_num_samps_out = h->usrp->config.maxNumSamps;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_rx_streamer_issue_stream_cmd(uhd_rx_streamer_handle h, const uhd_stream_cmd_t* stream_cmd){
+    struct uhd_usrp* usrp = h->usrp;
+    if(stream_cmd->stream_mode == UHD_STREAM_MODE_START_CONTINUOUS){
+        double startSecs = stream_cmd->stream_now ? uhdMockElapsed(usrp) :
+                           stream_cmd->time_spec_full_secs + stream_cmd->time_spec_frac_secs;
+        h->nextSample = usrp->config.paced ? (uint64_t) (startSecs*usrp->rxRate) : 0;
+        h->streaming = true;
+    }else if(stream_cmd->stream_mode == UHD_STREAM_MODE_STOP_CONTINUOUS){
+        h->streaming = false;
+    }else{
+        snprintf(usrp->lastError, sizeof(usrp->lastError), "Mock USRP only supports continuous streaming");
+        return UHD_ERROR_NOT_IMPLEMENTED;
+    }
+    return UHD_ERROR_NONE;
+}
+
+//Fills a channel's buffer with a ramp of the device sample index (real) and its negation (imaginary)
+static void uhdMockFillRamp(void* buff, size_t componentSize, uint64_t firstSample, size_t numSamples){
+    if(componentSize == 4){
+        float* samples = (float*) buff;
+        for(size_t sample = 0; sample<numSamples; sample++){
+            float value = (float) (int16_t) (firstSample + sample)*(1.0f/32768.0f);
+            samples[2*sample] = value;
+            samples[2*sample+1] = -value;
+        }
+    }else if(componentSize == 2){
+        int16_t* samples = (int16_t*) buff;
+        for(size_t sample = 0; sample<numSamples; sample++){
+            int16_t value = (int16_t) (firstSample + sample);
+            samples[2*sample] = value;
+            samples[2*sample+1] = (int16_t) -value;
+        }
+    }else{
+        int8_t* samples = (int8_t*) buff;
+        for(size_t sample = 0; sample<numSamples; sample++){
+            int8_t value = (int8_t) (firstSample + sample);
+            samples[2*sample] = value;
+            samples[2*sample+1] = (int8_t) -value;
+        }
+    }
+}
+
+uhd_error uhd_rx_streamer_recv(uhd_rx_streamer_handle h, void** buffs, size_t samps_per_buff, uhd_rx_metadata_handle* md,
+                               double timeout, bool one_packet, size_t* items_recvd){
+    struct uhd_usrp* usrp = h->usrp;
+    struct uhd_rx_metadata_t* rxMd = *md;
+    uhdMockConfig_t* config = &usrp->config;
+    double rate = usrp->rxRate;
+
+    *items_recvd = 0;
+    rxMd->hasTimeSpec = false;
+    rxMd->errorCode = UHD_RX_METADATA_ERROR_CODE_NONE;
+
+    if(!h->streaming){
+        uhdMockSleepUntil(usrp, uhdMockElapsed(usrp) + timeout);
+        rxMd->errorCode = UHD_RX_METADATA_ERROR_CODE_TIMEOUT;
+        return UHD_ERROR_NONE;
+    }
+
+    h->recvCalls++;
+    if(config->timeoutEvery > 0 && h->recvCalls % config->timeoutEvery == 0){
+        rxMd->errorCode = UHD_RX_METADATA_ERROR_CODE_TIMEOUT;
+        return UHD_ERROR_NONE;
+    }
+    if(config->overflowEvery > 0 && h->recvCalls % config->overflowEvery == 0){
+        //The dropped samples show up as a jump in the device time of the next packet
+        uhdMockTimeSpec(h->nextSample, rate, &rxMd->fullSecs, &rxMd->fracSecs);
+        rxMd->hasTimeSpec = true;
+        rxMd->errorCode = UHD_RX_METADATA_ERROR_CODE_OVERFLOW;
+        h->nextSample += config->overflowSamps;
+        return UHD_ERROR_NONE;
+    }
+
+    size_t numSamples = samps_per_buff;
+    if(one_packet && numSamples > config->maxNumSamps){
+        numSamples = config->maxNumSamps;
+    }
+    if(config->paced){
+        //Wait for the last sample to be "received"
+        uhdMockSleepUntil(usrp, (h->nextSample + numSamples)/rate);
+    }
+
+    for(size_t chan = 0; chan<h->numChannels && config->fill; chan++){
+        uhdMockFillRamp(buffs[chan], h->componentSize, h->nextSample, numSamples);
+    }
+    uhdMockTimeSpec(h->nextSample, rate, &rxMd->fullSecs, &rxMd->fracSecs);
+    rxMd->hasTimeSpec = true;
+    h->nextSample += numSamples;
+    *items_recvd = numSamples;
+    return UHD_ERROR_NONE;
+}
+
+// ==== Rx Metadata ====
+
+uhd_error uhd_rx_metadata_make(uhd_rx_metadata_handle* handle){
+    *handle = calloc(1, sizeof(struct uhd_rx_metadata_t));
+    return *handle == NULL ? UHD_ERROR_OS : UHD_ERROR_NONE;
+}
+
+uhd_error uhd_rx_metadata_free(uhd_rx_metadata_handle* handle){
+    free(*handle);
+    *handle = NULL;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_rx_metadata_has_time_spec(uhd_rx_metadata_handle h, bool* result_out){
+    *result_out = h->hasTimeSpec;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_rx_metadata_time_spec(uhd_rx_metadata_handle h, int64_t* full_secs_out, double* frac_secs_out){
+    *full_secs_out = h->fullSecs;
+    *frac_secs_out = h->fracSecs;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_rx_metadata_error_code(uhd_rx_metadata_handle h, uhd_rx_metadata_error_code_t* error_code_out){
+    *error_code_out = h->errorCode;
+    return UHD_ERROR_NONE;
+}
+
+// ==== Tx Streamer ====
+
+uhd_error uhd_tx_streamer_make(uhd_tx_streamer_handle* h){
+    struct uhd_tx_streamer* streamer = calloc(1, sizeof(struct uhd_tx_streamer));
+    if(streamer == NULL){
+        return UHD_ERROR_OS;
+    }
+    pthread_mutex_init(&streamer->asyncLock, NULL);
+    pthread_cond_init(&streamer->asyncCond, NULL);
+    *h = streamer;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_tx_streamer_free(uhd_tx_streamer_handle* h){
+    pthread_mutex_destroy(&(*h)->asyncLock);
+    pthread_cond_destroy(&(*h)->asyncCond);
+    free(*h);
+    *h = NULL;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_tx_streamer_max_num_samps(uhd_tx_streamer_handle h, size_t* max_num_samps_out){
+    *max_num_samps_out = h->usrp->config.maxNumSamps;
+    return UHD_ERROR_NONE;
+}
+
+//Queues an async message for the async monitor.  Messages are dropped if the queue is full (like the USRP)
+static void uhdMockQueueAsync(struct uhd_tx_streamer* h, uhd_async_metadata_event_code_t eventCode, uint64_t sample){
+    pthread_mutex_lock(&h->asyncLock);
+    if(h->asyncCount < UHD_MOCK_ASYNC_QUEUE_LEN){
+        struct uhd_async_metadata_t* msg = &h->asyncQueue[(h->asyncHead + h->asyncCount) % UHD_MOCK_ASYNC_QUEUE_LEN];
+        msg->channel = 0;
+        msg->hasTimeSpec = true;
+        uhdMockTimeSpec(sample, h->usrp->txRate, &msg->fullSecs, &msg->fracSecs);
+        msg->eventCode = eventCode;
+        h->asyncCount++;
+        pthread_cond_signal(&h->asyncCond);
+    }
+    pthread_mutex_unlock(&h->asyncLock);
+}
+
+//Reads each sample (as the conversion to the over the wire format would)
+static uint64_t uhdMockConsume(const void* buff, size_t bytes){
+    const uint64_t* words = (const uint64_t*) buff;
+    uint64_t sum = 0;
+    for(size_t word = 0; word<bytes/sizeof(uint64_t); word++){
+        sum += words[word];
+    }
+    return sum;
+}
+
+uhd_error uhd_tx_streamer_send(uhd_tx_streamer_handle h, const void** buffs, size_t samps_per_buff, uhd_tx_metadata_handle* md,
+                               double timeout, size_t* items_sent){
+    (void) timeout;
+    struct uhd_usrp* usrp = h->usrp;
+    struct uhd_tx_metadata_t* txMd = *md;
+    uhdMockConfig_t* config = &usrp->config;
+    double rate = usrp->txRate;
+
+    *items_sent = 0;
+    h->sendCalls++;
+
+    //A timed start of burst sets when the burst begins.  Otherwise the burst begins when it is sent
+    bool startOfBurst = !h->started || txMd->startOfBurst;
+    if(startOfBurst){
+        if(txMd->hasTimeSpec){
+            h->nextSample = (uint64_t) uhdMockToSamples(txMd->fullSecs, txMd->fracSecs, rate);
+        }else if(config->paced){
+            h->nextSample = (uint64_t) (uhdMockElapsed(usrp)*rate);
+        }
+        h->started = true;
+    }
+
+    if(config->paced){
+        double dueSecs = h->nextSample/rate;
+        double now = uhdMockElapsed(usrp);
+        if(!startOfBurst && now > dueSecs + UHD_MOCK_UNDERFLOW_SLACK_SECS){
+            //The samples were sent after they were due
+            uhdMockQueueAsync(h, UHD_ASYNC_METADATA_EVENT_CODE_UNDERFLOW, h->nextSample);
+            h->nextSample = (uint64_t) (now*rate);
+        }
+        //Wait for the last sample to be "sent"
+        uhdMockSleepUntil(usrp, (h->nextSample + samps_per_buff)/rate);
+    }
+    if(config->underflowEvery > 0 && h->sendCalls % config->underflowEvery == 0){
+        uhdMockQueueAsync(h, UHD_ASYNC_METADATA_EVENT_CODE_UNDERFLOW, h->nextSample);
+    }
+
+    uint64_t consumed = 0;
+    for(size_t chan = 0; chan<h->numChannels && config->fill; chan++){
+        consumed += uhdMockConsume(buffs[chan], samps_per_buff*2*h->componentSize);
+    }
+    h->consumed += consumed;
+    h->nextSample += samps_per_buff;
+
+    if(txMd->endOfBurst){
+        uhdMockQueueAsync(h, UHD_ASYNC_METADATA_EVENT_CODE_BURST_ACK, h->nextSample);
+        h->started = false;
+    }
+
+    *items_sent = samps_per_buff;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_tx_streamer_recv_async_msg(uhd_tx_streamer_handle h, uhd_async_metadata_handle* md, double timeout, bool* valid){
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    double wholeSecs = floor(timeout);
+    deadline.tv_sec += (time_t) wholeSecs;
+    deadline.tv_nsec += (long) ((timeout - wholeSecs)*1e9);
+    deadline.tv_sec += deadline.tv_nsec/1000000000;
+    deadline.tv_nsec %= 1000000000;
+
+    pthread_mutex_lock(&h->asyncLock);
+    while(h->asyncCount == 0){
+        if(pthread_cond_timedwait(&h->asyncCond, &h->asyncLock, &deadline) == ETIMEDOUT){
+            break;
+        }
+    }
+    *valid = h->asyncCount > 0;
+    if(*valid){
+        **md = h->asyncQueue[h->asyncHead];
+        h->asyncHead = (h->asyncHead + 1) % UHD_MOCK_ASYNC_QUEUE_LEN;
+        h->asyncCount--;
+    }
+    pthread_mutex_unlock(&h->asyncLock);
+    return UHD_ERROR_NONE;
+}
+
+// ==== Tx Metadata ====
+
+uhd_error uhd_tx_metadata_make(uhd_tx_metadata_handle* handle, bool has_time_spec, int64_t full_secs, double frac_secs,
+                               bool start_of_burst, bool end_of_burst){
+    struct uhd_tx_metadata_t* md = malloc(sizeof(struct uhd_tx_metadata_t));
+    if(md == NULL){
+        return UHD_ERROR_OS;
+    }
+    md->hasTimeSpec = has_time_spec;
+    md->fullSecs = full_secs;
+    md->fracSecs = frac_secs;
+    md->startOfBurst = start_of_burst;
+    md->endOfBurst = end_of_burst;
+    *handle = md;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_tx_metadata_free(uhd_tx_metadata_handle* handle){
+    free(*handle);
+    *handle = NULL;
+    return UHD_ERROR_NONE;
+}
+
+// ==== Async Metadata ====
+
+uhd_error uhd_async_metadata_make(uhd_async_metadata_handle* handle){
+    *handle = calloc(1, sizeof(struct uhd_async_metadata_t));
+    return *handle == NULL ? UHD_ERROR_OS : UHD_ERROR_NONE;
+}
+
+uhd_error uhd_async_metadata_free(uhd_async_metadata_handle* handle){
+    free(*handle);
+    *handle = NULL;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_async_metadata_channel(uhd_async_metadata_handle h, size_t* channel_out){
+    *channel_out = h->channel;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_async_metadata_has_time_spec(uhd_async_metadata_handle h, bool* result_out){
+    *result_out = h->hasTimeSpec;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_async_metadata_time_spec(uhd_async_metadata_handle h, int64_t* full_secs_out, double* frac_secs_out){
+    *full_secs_out = h->fullSecs;
+    *frac_secs_out = h->fracSecs;
+    return UHD_ERROR_NONE;
+}
+
+uhd_error uhd_async_metadata_event_code(uhd_async_metadata_handle h, uhd_async_metadata_event_code_t* event_code_out){
+    *event_code_out = h->eventCode;
+    return UHD_ERROR_NONE;
+}
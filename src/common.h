@@ -5,7 +5,60 @@
 #ifndef UHDTOPIPES_COMMON_H
 #define UHDTOPIPES_COMMON_H
 
+#include <stddef.h>
+
 #define TERMINATE_CHECK_ITTERATIONS (1000)
 #define FEEDBACK_DATATYPE int32_t
 
+//Maximum number of channels in a multi-channel (MIMO) streamer
+#define MAX_CHANNELS (16)
+
+//Used to keep variables shared between threads on separate cache lines (avoids false sharing)
+#define CACHE_LINE_SIZE (64)
+
+//Layout of the samples in each block on the Rx and Tx pipes
+typedef enum{
+    PIPE_FORMAT_PLANAR, //A block of real samples concatinated with a block of imagionary samples
+    PIPE_FORMAT_INTERLEAVED //Complex samples with the real and imagionary components interleaved (the UHD CPU format)
+} pipeFormat_e;
+
+//How blocks are passed to and from the other applications
+typedef enum{
+    TRANSPORT_PIPE, //POSIX pipes (FIFOs) given by the Rx and Tx pipe paths
+    TRANSPORT_SHM //Shared memory rings (see shmRing.h) named by the Rx and Tx pipe paths
+} transport_e;
+
+//The CPU side sample formats supported by UHD.  This is the type of each component on the pipes
+typedef enum{
+    SAMPLE_FORMAT_FC32, //Single precision float
+    SAMPLE_FORMAT_SC16, //16 bit signed integer
+    SAMPLE_FORMAT_SC8 //8 bit signed integer
+} sampleFormat_e;
+
+//Size of each component (real or imagionary part) in bytes
+static inline size_t sampleFormatComponentSize(sampleFormat_e format){
+    switch(format){
+        case SAMPLE_FORMAT_SC16:
+            return 2;
+        case SAMPLE_FORMAT_SC8:
+            return 1;
+        case SAMPLE_FORMAT_FC32:
+        default:
+            return 4;
+    }
+}
+
+//The name UHD uses for the format (for cpu_format and otw_format in uhd_stream_args_t)
+static inline char* sampleFormatName(sampleFormat_e format){
+    switch(format){
+        case SAMPLE_FORMAT_SC16:
+            return "sc16";
+        case SAMPLE_FORMAT_SC8:
+            return "sc8";
+        case SAMPLE_FORMAT_FC32:
+        default:
+            return "fc32";
+    }
+}
+
 #endif //UHDTOPIPES_COMMON_H
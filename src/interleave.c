@@ -0,0 +1,414 @@
+//
+// Conversion between the interleaved complex format used by UHD and the planar (all real then all imagionary) format
+// used on the pipes.
+//
+// The SIMD variants are compiled with per-function target attributes so that the binary still runs on CPUs without
+// them.  The variant is selected at runtime with interleaveKernelsInit.  All variants use unaligned loads and stores
+// (the blocks are frequently offset by the reblocking remainder) and finish any tail which does not fill a full vector
+// with the next narrower variant.
+//
+// The 16 and 8 bit kernels treat each complex sample as a single 32 or 16 bit word (real part in the low half since
+// x86 is little endian).  The real part is sign extended with a shift pair, the imagionary part with an arithmetic
+// shift, and the two are narrowed back with a saturating pack (which is exact since the values came from the narrower
+// type).
+//
+
+#include "interleave.h"
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+deinterleave_t deinterleave32 = deinterleave32Scalar;
+deinterleave_t deinterleave16 = deinterleave16Scalar;
+deinterleave_t deinterleave8 = deinterleave8Scalar;
+interleave_t interleave32 = interleave32Scalar;
+interleave_t interleave16 = interleave16Scalar;
+interleave_t interleave8 = interleave8Scalar;
+
+//==== Scalar ====
+
+void deinterleave32Scalar(const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    const uint32_t* srcCast = (const uint32_t*) src;
+    uint32_t* dstReCast = (uint32_t*) dstRe;
+    uint32_t* dstImCast = (uint32_t*) dstIm;
+    for(size_t i = 0; i<numSamples; i++){
+        dstReCast[i] = srcCast[2*i];
+        dstImCast[i] = srcCast[2*i+1];
+    }
+}
+
+void deinterleave16Scalar(const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    const int16_t* srcCast = (const int16_t*) src;
+    int16_t* dstReCast = (int16_t*) dstRe;
+    int16_t* dstImCast = (int16_t*) dstIm;
+    for(size_t i = 0; i<numSamples; i++){
+        dstReCast[i] = srcCast[2*i];
+        dstImCast[i] = srcCast[2*i+1];
+    }
+}
+
+void deinterleave8Scalar(const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    const int8_t* srcCast = (const int8_t*) src;
+    int8_t* dstReCast = (int8_t*) dstRe;
+    int8_t* dstImCast = (int8_t*) dstIm;
+    for(size_t i = 0; i<numSamples; i++){
+        dstReCast[i] = srcCast[2*i];
+        dstImCast[i] = srcCast[2*i+1];
+    }
+}
+
+void interleave32Scalar(const void* srcRe, const void* srcIm, void* dst, size_t numSamples){
+    const uint32_t* srcReCast = (const uint32_t*) srcRe;
+    const uint32_t* srcImCast = (const uint32_t*) srcIm;
+    uint32_t* dstCast = (uint32_t*) dst;
+    for(size_t i = 0; i<numSamples; i++){
+        dstCast[2*i] = srcReCast[i];
+        dstCast[2*i+1] = srcImCast[i];
+    }
+}
+
+void interleave16Scalar(const void* srcRe, const void* srcIm, void* dst, size_t numSamples){
+    const int16_t* srcReCast = (const int16_t*) srcRe;
+    const int16_t* srcImCast = (const int16_t*) srcIm;
+    int16_t* dstCast = (int16_t*) dst;
+    for(size_t i = 0; i<numSamples; i++){
+        dstCast[2*i] = srcReCast[i];
+        dstCast[2*i+1] = srcImCast[i];
+    }
+}
+
+void interleave8Scalar(const void* srcRe, const void* srcIm, void* dst, size_t numSamples){
+    const int8_t* srcReCast = (const int8_t*) srcRe;
+    const int8_t* srcImCast = (const int8_t*) srcIm;
+    int8_t* dstCast = (int8_t*) dst;
+    for(size_t i = 0; i<numSamples; i++){
+        dstCast[2*i] = srcReCast[i];
+        dstCast[2*i+1] = srcImCast[i];
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+//==== 32 Bit Components ====
+
+__attribute__((target("sse2")))
+void deinterleave32SSE2(const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    const float* srcCast = (const float*) src;
+    float* dstReCast = (float*) dstRe;
+    float* dstImCast = (float*) dstIm;
+    size_t i = 0;
+    for(; i+4<=numSamples; i+=4){
+        __m128 a = _mm_loadu_ps(srcCast+2*i);   //r0 i0 r1 i1
+        __m128 b = _mm_loadu_ps(srcCast+2*i+4); //r2 i2 r3 i3
+        _mm_storeu_ps(dstReCast+i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(dstImCast+i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    deinterleave32Scalar(srcCast+2*i, dstReCast+i, dstImCast+i, numSamples-i);
+}
+
+__attribute__((target("avx2")))
+void deinterleave32AVX2(const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    const float* srcCast = (const float*) src;
+    float* dstReCast = (float*) dstRe;
+    float* dstImCast = (float*) dstIm;
+    size_t i = 0;
+    for(; i+8<=numSamples; i+=8){
+        __m256 a = _mm256_loadu_ps(srcCast+2*i);   //r0 i0 r1 i1 | r2 i2 r3 i3
+        __m256 b = _mm256_loadu_ps(srcCast+2*i+8); //r4 i4 r5 i5 | r6 i6 r7 i7
+        //The shuffle works within 128 bit lanes: r0 r1 r4 r5 | r2 r3 r6 r7
+        __m256 re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        //Fix the order of the 64 bit pairs across the lanes
+        re = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(re), _MM_SHUFFLE(3, 1, 2, 0)));
+        im = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(im), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(dstReCast+i, re);
+        _mm256_storeu_ps(dstImCast+i, im);
+    }
+    deinterleave32SSE2(srcCast+2*i, dstReCast+i, dstImCast+i, numSamples-i);
+}
+
+__attribute__((target("avx512f")))
+void deinterleave32AVX512(const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    const float* srcCast = (const float*) src;
+    float* dstReCast = (float*) dstRe;
+    float* dstImCast = (float*) dstIm;
+    const __m512i reInd = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i imInd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    size_t i = 0;
+    for(; i+16<=numSamples; i+=16){
+        __m512 a = _mm512_loadu_ps(srcCast+2*i);
+        __m512 b = _mm512_loadu_ps(srcCast+2*i+16);
+        _mm512_storeu_ps(dstReCast+i, _mm512_permutex2var_ps(a, reInd, b));
+        _mm512_storeu_ps(dstImCast+i, _mm512_permutex2var_ps(a, imInd, b));
+    }
+    deinterleave32AVX2(srcCast+2*i, dstReCast+i, dstImCast+i, numSamples-i);
+}
+
+__attribute__((target("sse2")))
+void interleave32SSE2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples){
+    const float* srcReCast = (const float*) srcRe;
+    const float* srcImCast = (const float*) srcIm;
+    float* dstCast = (float*) dst;
+    size_t i = 0;
+    for(; i+4<=numSamples; i+=4){
+        __m128 re = _mm_loadu_ps(srcReCast+i);
+        __m128 im = _mm_loadu_ps(srcImCast+i);
+        _mm_storeu_ps(dstCast+2*i, _mm_unpacklo_ps(re, im));   //r0 i0 r1 i1
+        _mm_storeu_ps(dstCast+2*i+4, _mm_unpackhi_ps(re, im)); //r2 i2 r3 i3
+    }
+    interleave32Scalar(srcReCast+i, srcImCast+i, dstCast+2*i, numSamples-i);
+}
+
+__attribute__((target("avx2")))
+void interleave32AVX2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples){
+    const float* srcReCast = (const float*) srcRe;
+    const float* srcImCast = (const float*) srcIm;
+    float* dstCast = (float*) dst;
+    size_t i = 0;
+    for(; i+8<=numSamples; i+=8){
+        __m256 re = _mm256_loadu_ps(srcReCast+i);
+        __m256 im = _mm256_loadu_ps(srcImCast+i);
+        //The unpacks work within 128 bit lanes: r0 i0 r1 i1 | r4 i4 r5 i5 and r2 i2 r3 i3 | r6 i6 r7 i7
+        __m256 lo = _mm256_unpacklo_ps(re, im);
+        __m256 hi = _mm256_unpackhi_ps(re, im);
+        _mm256_storeu_ps(dstCast+2*i, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(dstCast+2*i+8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    interleave32SSE2(srcReCast+i, srcImCast+i, dstCast+2*i, numSamples-i);
+}
+
+__attribute__((target("avx512f")))
+void interleave32AVX512(const void* srcRe, const void* srcIm, void* dst, size_t numSamples){
+    const float* srcReCast = (const float*) srcRe;
+    const float* srcImCast = (const float*) srcIm;
+    float* dstCast = (float*) dst;
+    const __m512i loInd = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    const __m512i hiInd = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    size_t i = 0;
+    for(; i+16<=numSamples; i+=16){
+        __m512 re = _mm512_loadu_ps(srcReCast+i);
+        __m512 im = _mm512_loadu_ps(srcImCast+i);
+        _mm512_storeu_ps(dstCast+2*i, _mm512_permutex2var_ps(re, loInd, im));
+        _mm512_storeu_ps(dstCast+2*i+16, _mm512_permutex2var_ps(re, hiInd, im));
+    }
+    interleave32AVX2(srcReCast+i, srcImCast+i, dstCast+2*i, numSamples-i);
+}
+
+//==== 16 Bit Components ====
+
+__attribute__((target("sse2")))
+void deinterleave16SSE2(const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    const int16_t* srcCast = (const int16_t*) src;
+    int16_t* dstReCast = (int16_t*) dstRe;
+    int16_t* dstImCast = (int16_t*) dstIm;
+    size_t i = 0;
+    for(; i+8<=numSamples; i+=8){
+        __m128i a = _mm_loadu_si128((const __m128i*) (srcCast+2*i));   //Samples 0-3
+        __m128i b = _mm_loadu_si128((const __m128i*) (srcCast+2*i+8)); //Samples 4-7
+        __m128i reA = _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+        __m128i reB = _mm_srai_epi32(_mm_slli_epi32(b, 16), 16);
+        __m128i imA = _mm_srai_epi32(a, 16);
+        __m128i imB = _mm_srai_epi32(b, 16);
+        _mm_storeu_si128((__m128i*) (dstReCast+i), _mm_packs_epi32(reA, reB));
+        _mm_storeu_si128((__m128i*) (dstImCast+i), _mm_packs_epi32(imA, imB));
+    }
+    deinterleave16Scalar(srcCast+2*i, dstReCast+i, dstImCast+i, numSamples-i);
+}
+
+__attribute__((target("avx2")))
+void deinterleave16AVX2(const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    const int16_t* srcCast = (const int16_t*) src;
+    int16_t* dstReCast = (int16_t*) dstRe;
+    int16_t* dstImCast = (int16_t*) dstIm;
+    size_t i = 0;
+    for(; i+16<=numSamples; i+=16){
+        __m256i a = _mm256_loadu_si256((const __m256i*) (srcCast+2*i));    //Samples 0-7
+        __m256i b = _mm256_loadu_si256((const __m256i*) (srcCast+2*i+16)); //Samples 8-15
+        __m256i reA = _mm256_srai_epi32(_mm256_slli_epi32(a, 16), 16);
+        __m256i reB = _mm256_srai_epi32(_mm256_slli_epi32(b, 16), 16);
+        __m256i imA = _mm256_srai_epi32(a, 16);
+        __m256i imB = _mm256_srai_epi32(b, 16);
+        //The pack works within 128 bit lanes: 0-3 8-11 | 4-7 12-15
+        __m256i re = _mm256_permute4x64_epi64(_mm256_packs_epi32(reA, reB), _MM_SHUFFLE(3, 1, 2, 0));
+        __m256i im = _mm256_permute4x64_epi64(_mm256_packs_epi32(imA, imB), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i*) (dstReCast+i), re);
+        _mm256_storeu_si256((__m256i*) (dstImCast+i), im);
+    }
+    deinterleave16SSE2(srcCast+2*i, dstReCast+i, dstImCast+i, numSamples-i);
+}
+
+__attribute__((target("sse2")))
+void interleave16SSE2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples){
+    const int16_t* srcReCast = (const int16_t*) srcRe;
+    const int16_t* srcImCast = (const int16_t*) srcIm;
+    int16_t* dstCast = (int16_t*) dst;
+    size_t i = 0;
+    for(; i+8<=numSamples; i+=8){
+        __m128i re = _mm_loadu_si128((const __m128i*) (srcReCast+i));
+        __m128i im = _mm_loadu_si128((const __m128i*) (srcImCast+i));
+        _mm_storeu_si128((__m128i*) (dstCast+2*i), _mm_unpacklo_epi16(re, im));   //Samples 0-3
+        _mm_storeu_si128((__m128i*) (dstCast+2*i+8), _mm_unpackhi_epi16(re, im)); //Samples 4-7
+    }
+    interleave16Scalar(srcReCast+i, srcImCast+i, dstCast+2*i, numSamples-i);
+}
+
+__attribute__((target("avx2")))
+void interleave16AVX2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples){
+    const int16_t* srcReCast = (const int16_t*) srcRe;
+    const int16_t* srcImCast = (const int16_t*) srcIm;
+    int16_t* dstCast = (int16_t*) dst;
+    size_t i = 0;
+    for(; i+16<=numSamples; i+=16){
+        __m256i re = _mm256_loadu_si256((const __m256i*) (srcReCast+i));
+        __m256i im = _mm256_loadu_si256((const __m256i*) (srcImCast+i));
+        //The unpacks work within 128 bit lanes: 0-3 | 8-11 and 4-7 | 12-15
+        __m256i lo = _mm256_unpacklo_epi16(re, im);
+        __m256i hi = _mm256_unpackhi_epi16(re, im);
+        _mm256_storeu_si256((__m256i*) (dstCast+2*i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*) (dstCast+2*i+16), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    interleave16SSE2(srcReCast+i, srcImCast+i, dstCast+2*i, numSamples-i);
+}
+
+//==== 8 Bit Components ====
+
+__attribute__((target("sse2")))
+void deinterleave8SSE2(const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    const int8_t* srcCast = (const int8_t*) src;
+    int8_t* dstReCast = (int8_t*) dstRe;
+    int8_t* dstImCast = (int8_t*) dstIm;
+    size_t i = 0;
+    for(; i+16<=numSamples; i+=16){
+        __m128i a = _mm_loadu_si128((const __m128i*) (srcCast+2*i));    //Samples 0-7
+        __m128i b = _mm_loadu_si128((const __m128i*) (srcCast+2*i+16)); //Samples 8-15
+        __m128i reA = _mm_srai_epi16(_mm_slli_epi16(a, 8), 8);
+        __m128i reB = _mm_srai_epi16(_mm_slli_epi16(b, 8), 8);
+        __m128i imA = _mm_srai_epi16(a, 8);
+        __m128i imB = _mm_srai_epi16(b, 8);
+        _mm_storeu_si128((__m128i*) (dstReCast+i), _mm_packs_epi16(reA, reB));
+        _mm_storeu_si128((__m128i*) (dstImCast+i), _mm_packs_epi16(imA, imB));
+    }
+    deinterleave8Scalar(srcCast+2*i, dstReCast+i, dstImCast+i, numSamples-i);
+}
+
+__attribute__((target("avx2")))
+void deinterleave8AVX2(const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    const int8_t* srcCast = (const int8_t*) src;
+    int8_t* dstReCast = (int8_t*) dstRe;
+    int8_t* dstImCast = (int8_t*) dstIm;
+    size_t i = 0;
+    for(; i+32<=numSamples; i+=32){
+        __m256i a = _mm256_loadu_si256((const __m256i*) (srcCast+2*i));    //Samples 0-15
+        __m256i b = _mm256_loadu_si256((const __m256i*) (srcCast+2*i+32)); //Samples 16-31
+        __m256i reA = _mm256_srai_epi16(_mm256_slli_epi16(a, 8), 8);
+        __m256i reB = _mm256_srai_epi16(_mm256_slli_epi16(b, 8), 8);
+        __m256i imA = _mm256_srai_epi16(a, 8);
+        __m256i imB = _mm256_srai_epi16(b, 8);
+        //The pack works within 128 bit lanes: 0-7 16-23 | 8-15 24-31
+        __m256i re = _mm256_permute4x64_epi64(_mm256_packs_epi16(reA, reB), _MM_SHUFFLE(3, 1, 2, 0));
+        __m256i im = _mm256_permute4x64_epi64(_mm256_packs_epi16(imA, imB), _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i*) (dstReCast+i), re);
+        _mm256_storeu_si256((__m256i*) (dstImCast+i), im);
+    }
+    deinterleave8SSE2(srcCast+2*i, dstReCast+i, dstImCast+i, numSamples-i);
+}
+
+__attribute__((target("sse2")))
+void interleave8SSE2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples){
+    const int8_t* srcReCast = (const int8_t*) srcRe;
+    const int8_t* srcImCast = (const int8_t*) srcIm;
+    int8_t* dstCast = (int8_t*) dst;
+    size_t i = 0;
+    for(; i+16<=numSamples; i+=16){
+        __m128i re = _mm_loadu_si128((const __m128i*) (srcReCast+i));
+        __m128i im = _mm_loadu_si128((const __m128i*) (srcImCast+i));
+        _mm_storeu_si128((__m128i*) (dstCast+2*i), _mm_unpacklo_epi8(re, im));    //Samples 0-7
+        _mm_storeu_si128((__m128i*) (dstCast+2*i+16), _mm_unpackhi_epi8(re, im)); //Samples 8-15
+    }
+    interleave8Scalar(srcReCast+i, srcImCast+i, dstCast+2*i, numSamples-i);
+}
+
+__attribute__((target("avx2")))
+void interleave8AVX2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples){
+    const int8_t* srcReCast = (const int8_t*) srcRe;
+    const int8_t* srcImCast = (const int8_t*) srcIm;
+    int8_t* dstCast = (int8_t*) dst;
+    size_t i = 0;
+    for(; i+32<=numSamples; i+=32){
+        __m256i re = _mm256_loadu_si256((const __m256i*) (srcReCast+i));
+        __m256i im = _mm256_loadu_si256((const __m256i*) (srcImCast+i));
+        //The unpacks work within 128 bit lanes: 0-7 | 16-23 and 8-15 | 24-31
+        __m256i lo = _mm256_unpacklo_epi8(re, im);
+        __m256i hi = _mm256_unpackhi_epi8(re, im);
+        _mm256_storeu_si256((__m256i*) (dstCast+2*i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*) (dstCast+2*i+32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    interleave8SSE2(srcReCast+i, srcImCast+i, dstCast+2*i, numSamples-i);
+}
+#endif
+
+const char* interleaveKernelsInit(void){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    //The 16 and 8 bit kernels do not have AVX-512 variants (the AVX-512 byte/word packs require AVX512BW)
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2")){
+        deinterleave32 = deinterleave32AVX512;
+        deinterleave16 = deinterleave16AVX2;
+        deinterleave8 = deinterleave8AVX2;
+        interleave32 = interleave32AVX512;
+        interleave16 = interleave16AVX2;
+        interleave8 = interleave8AVX2;
+        return "AVX-512";
+    }else if(__builtin_cpu_supports("avx2")){
+        deinterleave32 = deinterleave32AVX2;
+        deinterleave16 = deinterleave16AVX2;
+        deinterleave8 = deinterleave8AVX2;
+        interleave32 = interleave32AVX2;
+        interleave16 = interleave16AVX2;
+        interleave8 = interleave8AVX2;
+        return "AVX2";
+    }else if(__builtin_cpu_supports("sse2")){
+        deinterleave32 = deinterleave32SSE2;
+        deinterleave16 = deinterleave16SSE2;
+        deinterleave8 = deinterleave8SSE2;
+        interleave32 = interleave32SSE2;
+        interleave16 = interleave16SSE2;
+        interleave8 = interleave8SSE2;
+        return "SSE2";
+    }
+#endif
+    deinterleave32 = deinterleave32Scalar;
+    deinterleave16 = deinterleave16Scalar;
+    deinterleave8 = deinterleave8Scalar;
+    interleave32 = interleave32Scalar;
+    interleave16 = interleave16Scalar;
+    interleave8 = interleave8Scalar;
+    return "Scalar";
+}
+
+deinterleave_t deinterleaveKernel(size_t componentSize){
+    switch(componentSize){
+        case 4:
+            return deinterleave32;
+        case 2:
+            return deinterleave16;
+        case 1:
+            return deinterleave8;
+        default:
+            return NULL;
+    }
+}
+
+interleave_t interleaveKernel(size_t componentSize){
+    switch(componentSize){
+        case 4:
+            return interleave32;
+        case 2:
+            return interleave16;
+        case 1:
+            return interleave8;
+        default:
+            return NULL;
+    }
+}
@@ -0,0 +1,62 @@
+//
+// Conversion between the interleaved complex format used by UHD and the planar (all real then all imagionary) format
+// used on the pipes.
+//
+
+#ifndef UHDTOPIPES_INTERLEAVE_H
+#define UHDTOPIPES_INTERLEAVE_H
+
+#include <stddef.h>
+
+//The kernels only move data and are therefore selected by the size of each component (real or imagionary part) rather
+//than the type: 4 bytes for fc32, 2 bytes for sc16, and 1 byte for sc8.
+
+//Splits numSamples interleaved complex samples (re, im, re, im, ...) into separate real and imagionary arrays.
+//None of the pointers need to be aligned.
+typedef void (*deinterleave_t)(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+
+//Combines numSamples samples from separate real and imagionary arrays into interleaved complex samples (re, im, ...).
+//None of the pointers need to be aligned.
+typedef void (*interleave_t)(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+
+//Selected by interleaveKernelsInit based on the instruction sets supported by the CPU
+extern deinterleave_t deinterleave32;
+extern deinterleave_t deinterleave16;
+extern deinterleave_t deinterleave8;
+extern interleave_t interleave32;
+extern interleave_t interleave16;
+extern interleave_t interleave8;
+
+//Selects the fastest kernels supported by the CPU.  Must be called before any streaming thread is started.
+//Returns the name of the selected instruction set
+const char* interleaveKernelsInit(void);
+
+//Returns the selected kernel for the given component size (in bytes) or NULL if the size is not supported
+deinterleave_t deinterleaveKernel(size_t componentSize);
+interleave_t interleaveKernel(size_t componentSize);
+
+//Individual kernel variants (exposed so that they can be compared against each other)
+void deinterleave32Scalar(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+void deinterleave16Scalar(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+void deinterleave8Scalar(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+void interleave32Scalar(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+void interleave16Scalar(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+void interleave8Scalar(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+#if defined(__x86_64__) || defined(__i386__)
+void deinterleave32SSE2(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+void deinterleave32AVX2(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+void deinterleave32AVX512(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+void deinterleave16SSE2(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+void deinterleave16AVX2(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+void deinterleave8SSE2(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+void deinterleave8AVX2(const void* src, void* dstRe, void* dstIm, size_t numSamples);
+void interleave32SSE2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+void interleave32AVX2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+void interleave32AVX512(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+void interleave16SSE2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+void interleave16AVX2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+void interleave8SSE2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+void interleave8AVX2(const void* srcRe, const void* srcIm, void* dst, size_t numSamples);
+#endif
+
+#endif //UHDTOPIPES_INTERLEAVE_H
@@ -0,0 +1,89 @@
+//
+// Log-linear (HDR style) latency histograms.
+//
+
+#define _GNU_SOURCE
+#include "latencyHist.h"
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <time.h>
+
+#define LATENCY_REPORTER_POLL_NS (100000000) //Bounds how long it takes to notice that streaming has stopped
+
+void latencyHistInit(latencyHist_t* hist, const char* name){
+    for(int bucket = 0; bucket<LATENCY_HIST_BUCKETS; bucket++){
+        atomic_init(&hist->counts[bucket], 0);
+    }
+    atomic_init(&hist->max, 0);
+    hist->name = name;
+}
+
+//Largest value which is recorded in the bucket
+static uint64_t latencyHistBucketUpper(int bucket){
+    if(bucket < LATENCY_HIST_SUB_BUCKETS){
+        return bucket;
+    }
+    int exponent = bucket/LATENCY_HIST_SUB_BUCKETS + LATENCY_HIST_SUB_BITS - 1;
+    int sub = bucket%LATENCY_HIST_SUB_BUCKETS;
+    int shift = exponent - LATENCY_HIST_SUB_BITS;
+    uint64_t lower = ((uint64_t) (LATENCY_HIST_SUB_BUCKETS + sub)) << shift;
+    return lower + ((((uint64_t) 1) << shift) - 1);
+}
+
+//The counts are read while they may be updated, so the total is taken from the same copy used to find the percentiles
+static double latencyHistPercentileUs(const uint64_t* counts, uint64_t total, uint64_t max, double percentile){
+    uint64_t target = (uint64_t) (percentile/100.0*total);
+    if(target >= total){
+        target = total-1;
+    }
+    uint64_t seen = 0;
+    for(int bucket = 0; bucket<LATENCY_HIST_BUCKETS; bucket++){
+        seen += counts[bucket];
+        if(seen > target){
+            uint64_t upper = latencyHistBucketUpper(bucket);
+            return (upper < max ? upper : max)/1000.0;
+        }
+    }
+    return max/1000.0;
+}
+
+void latencyHistReport(latencyHist_t* hist){
+    uint64_t counts[LATENCY_HIST_BUCKETS];
+    uint64_t total = 0;
+    for(int bucket = 0; bucket<LATENCY_HIST_BUCKETS; bucket++){
+        counts[bucket] = atomic_load_explicit(&hist->counts[bucket], memory_order_relaxed);
+        total += counts[bucket];
+    }
+    if(total == 0){
+        return;
+    }
+    uint64_t max = atomic_load_explicit(&hist->max, memory_order_relaxed);
+
+    fprintf(stderr, "%s: %" PRIu64 " samples, p50 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us\n", hist->name, total,
+            latencyHistPercentileUs(counts, total, max, 50),
+            latencyHistPercentileUs(counts, total, max, 99),
+            latencyHistPercentileUs(counts, total, max, 99.9),
+            max/1000.0);
+}
+
+void* latencyReporter(void* argsUncast){
+    latencyReporterArgs_t* args = (latencyReporterArgs_t*) argsUncast;
+    bool* terminateStatus = args->terminateStatus;
+    bool* done = args->done;
+
+    sigset_t reportSignals;
+    sigemptyset(&reportSignals);
+    sigaddset(&reportSignals, SIGUSR1);
+
+    while(!*terminateStatus && !*done){
+        struct timespec timeout = {.tv_sec = 0, .tv_nsec = LATENCY_REPORTER_POLL_NS};
+        if(sigtimedwait(&reportSignals, NULL, &timeout) == SIGUSR1){
+            for(int histInd = 0; histInd<args->numHists; histInd++){
+                latencyHistReport(args->hists[histInd]);
+            }
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,60 @@
+//
+// Log-linear (HDR style) latency histograms.  Each histogram is only recorded to by one thread (no locks) and can be
+// reported from any thread.
+//
+
+#ifndef UHDTOPIPES_LATENCYHIST_H
+#define UHDTOPIPES_LATENCYHIST_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "common.h"
+
+//Each power of 2 is split into 2^LATENCY_HIST_SUB_BITS linear buckets so a recorded value is within 1/16 (6.25%) of the
+//reported value.  Values below 2^LATENCY_HIST_SUB_BITS ns are recorded exactly
+#define LATENCY_HIST_SUB_BITS (4)
+#define LATENCY_HIST_SUB_BUCKETS (1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_BUCKETS ((64 - LATENCY_HIST_SUB_BITS + 1)*LATENCY_HIST_SUB_BUCKETS)
+
+typedef struct{
+    _Alignas(CACHE_LINE_SIZE) atomic_uint_fast64_t counts[LATENCY_HIST_BUCKETS]; //Latencies in ns
+    atomic_uint_fast64_t max;
+    const char* name;
+} latencyHist_t;
+
+typedef struct{
+    bool* terminateStatus; //Used to periodically check if thread should terminate
+    bool* done; //Set by mainThread once the streaming threads have exited
+    latencyHist_t** hists;
+    int numHists;
+} latencyReporterArgs_t;
+
+static inline int latencyHistBucket(uint64_t ns){
+    if(ns < LATENCY_HIST_SUB_BUCKETS){
+        return (int) ns;
+    }
+    int exponent = 63 - __builtin_clzll(ns);
+    int sub = (int) (ns >> (exponent - LATENCY_HIST_SUB_BITS)) & (LATENCY_HIST_SUB_BUCKETS-1);
+    return (exponent - LATENCY_HIST_SUB_BITS + 1)*LATENCY_HIST_SUB_BUCKETS + sub;
+}
+
+//Only the owning thread may call this
+static inline void latencyHistRecord(latencyHist_t* hist, uint64_t ns){
+    atomic_uint_fast64_t* count = &hist->counts[latencyHistBucket(ns)];
+    atomic_store_explicit(count, atomic_load_explicit(count, memory_order_relaxed) + 1, memory_order_relaxed);
+    if(ns > atomic_load_explicit(&hist->max, memory_order_relaxed)){
+        atomic_store_explicit(&hist->max, ns, memory_order_relaxed);
+    }
+}
+
+void latencyHistInit(latencyHist_t* hist, const char* name);
+
+//Prints the count, p50, p99, p99.9, and max to stderr.  Nothing is printed if no latencies were recorded
+void latencyHistReport(latencyHist_t* hist);
+
+//Reports the histograms each time SIGUSR1 is received.  SIGUSR1 must be blocked in every thread (so that it is only
+//accepted by this thread's sigtimedwait)
+void* latencyReporter(void* argsUncast);
+
+#endif //UHDTOPIPES_LATENCYHIST_H
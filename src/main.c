@@ -14,6 +14,14 @@
 #include <signal.h>
 #include "txHandler.h"
 #include "rxHandler.h"
+#include "interleave.h"
+#include "pipeFrame.h"
+#include "telemetry.h"
+#include "latencyHist.h"
+#include "streamBuffer.h"
+#include "threadConfig.h"
+#include "polyphaseFir.h"
+#include "rxCondition.h"
 
 //Global (for sig handler)
 bool terminateStatus = false;
@@ -28,22 +36,111 @@ void print_help(void){
                     "    -g (Tx & Rx gain)\n"
                     "    --txgain (Tx gain)\n"
                     "    --rxgain (Rx gain)\n"
-                    "    -c (CPU for UHD, Tx, and Rx streaming - defaults to don't care)\n"
-                    "    --txcpu (CPU for Rx streaming handler - defaults to don't care)\n"
-                    "    --rxcpu (CPU for Rx streaming handler - defaults to don't care)\n"
-                    "    --uhdcpu (CPU for UHD - defaults to don't care)\n"
-                    "    --rxpipe (path to the Rx pipe)\n"
-                    "    --txpipe (path to the Tx pipe)\n"
+                    "    -c (CPUs for UHD, Tx, and Rx streaming - defaults to don't care)\n"
+                    "    --txcpu (CPUs for Tx streaming handler - defaults to don't care)\n"
+                    "    --rxcpu (CPUs for Rx streaming handler - defaults to don't care)\n"
+                    "    --rxwritercpu (CPUs for Rx pipe writer - defaults to don't care)\n"
+                    "    --txreadercpu (CPUs for Tx pipe reader - defaults to don't care)\n"
+                    "    --txasynccpu (CPUs for the Tx async message monitor - defaults to don't care)\n"
+                    "    --uhdcpu (CPUs for UHD - defaults to don't care)\n"
+                    "    --helpercpu (CPUs for the telemetry server and latency reporter - defaults to the UHD CPUs)\n"
+                    "    Each CPU option takes a CPU list (ex. 2 or 2,3 or 4-7,12).  A warning is printed at startup for pinned CPUs\n"
+                    "    which are not isolated (isolcpus or nohz_full) or which share a core (SMT sibling) with another thread's CPU\n"
+                    "    --sched (scheduling of the UHD, Tx, and Rx streaming threads: other, fifo[:priority], or rr[:priority] - the\n"
+                    "             priority defaults to 50.  Defaults to the UHD thread being made real time if permitted and the others\n"
+                    "             inheriting from it.  Real time policies require CAP_SYS_NICE or an RLIMIT_RTPRIO allowance, otherwise a\n"
+                    "             warning is printed and the thread inherits)\n"
+                    "    --txsched, --rxsched, --rxwritersched, --txreadersched, --txasyncsched, --uhdsched, --helpersched\n"
+                    "             (scheduling of the individual threads, as for --sched)\n"
+                    "    --rxpipe (path to the Rx pipe - a comma separated list gives 1 pipe per Rx channel, otherwise the blocks of each\n"
+                    "              channel are written to the single pipe in turn)\n"
+                    "    --txpipe (path to the Tx pipe - a comma separated list gives 1 pipe per Tx channel, otherwise the blocks of each\n"
+                    "              channel are read from the single pipe in turn)\n"
                     "    --txfeedbackpipe (path to the Tx feedback pipe - only applies when txpipe is supplied)\n"
+                    "    --txcreditwindow (credit based flow control on the Tx feedback pipe - the producer is granted this many blocks\n"
+                    "                      when the feedback pipe is opened and credits are returned in batches as blocks are sent.\n"
+                    "                      Each value written is then a block count which may be more than 1.\n"
+                    "                      defaults to 0 (a 1 is written for each block read from the Tx pipe))\n"
+                    "    --txcreditbatch (credits returned with each feedback pipe write - defaults to 1/8 of the credit window.  Held\n"
+                    "                     credits are returned early whenever the Tx ring runs empty)\n"
+                    "    --txcreditreturn (when credits are returned: send (default, once the block has been passed to the USRP) or\n"
+                    "                      ack (once the USRP ACKs the end of the burst containing the block - requires txframed)\n"
+                    "    --transport (how blocks are passed to the other applications: pipe (default) or shm)\n"
+                    "                 shm creates POSIX shared memory rings (see shmRing.h) named by rxpipe and txpipe (ex. /uhdRx)\n"
+                    "                 the depth of each shared memory ring is the rx/tx ring depth.  The Tx feedback pipe is not\n"
+                    "                 used with shm, the free blocks in the Tx shared memory ring are the producer's credits\n"
                     "    --samppertransactrx (samples per rx transaction)\n"
+                    "    --rxringdepth (number of rx transaction blocks buffered between the Rx handler and the Rx pipe writer - defaults to 256)\n"
+                    "    --rxdecim (decimate the Rx samples by this factor with a polyphase FIR before they are written to the Rx pipe -\n"
+                    "               defaults to 1 (no decimation).  The Rx pipe carries rate/rxdecim samples per second, samppertransactrx\n"
+                    "               is the number of decimated samples per block, and frame times are those of the newest input sample\n"
+                    "               of the first output)\n"
+                    "    --rxdecimtaps (file of decimation filter taps separated by whitespace or commas - defaults to a generated\n"
+                    "                   lowpass with unity gain and a cutoff at 0.4 of the decimated rate)\n"
+                    "    --rxdecimtaplen (number of taps in the generated decimation filter - defaults to %d per unit of rxdecim)\n"
+                    "    --rxscale (multiply the Rx samples by this factor as they are deinterleaved - defaults to 1)\n"
+                    "    --rxdctau (remove the DC offset of the Rx samples, tracked by a running mean with this time constant in\n"
+                    "               seconds, as they are deinterleaved - defaults to 0 (off))\n"
+                    "    --rxfreqshift (shift the Rx samples by this frequency in Hz (positive moves the spectrum up) with an NCO as\n"
+                    "                   they are deinterleaved - defaults to 0 (off).  The phase is continuous across blocks and gaps)\n"
+                    "    rxscale, rxdctau and rxfreqshift are applied in a single pass (after any decimation) and require the\n"
+                    "    planar pipe format\n"
                     "    --samppertransacttx (samples per tx transaction)\n"
+                    "    --txinterp (interpolate the Tx samples by this factor with a polyphase FIR before they are sent to the USRP -\n"
+                    "                defaults to 1 (no interpolation).  The Tx pipe carries rate/txinterp samples per second,\n"
+                    "                samppertransacttx, txrateburst, and the feedback are in pipe samples (before interpolation), and\n"
+                    "                frame times are those of the first interpolated sample)\n"
+                    "    --txinterptaps (file of interpolation filter taps separated by whitespace or commas, designed at the interpolated\n"
+                    "                    rate with unity DC gain - defaults to a generated lowpass with a cutoff at 0.4 of the pipe rate)\n"
+                    "    --txinterptaplen (number of taps in the generated interpolation filter - defaults to %d per unit of txinterp)\n"
+                    "    --txringdepth (number of tx transaction blocks buffered between the Tx pipe reader and the Tx handler - defaults to 256)\n"
+                    "    --txprefill (number of tx transaction blocks read ahead before Tx streaming starts - defaults to 1)\n"
+                    "    --pipebatch (maximum number of transaction blocks written to the Rx pipe or read from the Tx pipe with a single syscall - defaults to 16)\n"
+                    "    --pipebatchlatency (maximum time in us to wait for a full batch before writing a partial batch to the Rx pipe - defaults to 0)\n"
+                    "    --rxzerocopy (gift Rx blocks to the Rx pipe with vmsplice rather than copying them - falls back to normal writes if the Rx pipe is not a pipe)\n"
+                    "                 blocks are page aligned and are best sized to a multiple of the page size\n"
+                    "    --rxframed (each Rx block starts with a header (see pipeFrame.h) giving the device time of the first sample,\n"
+                    "                a sequence number, and overflow/discontinuity flags - requires a single Rx pipe, the Rx overflow\n"
+                    "                policy defaults to mark)\n"
+                    "    --rxoverflowpolicy (what to do when the USRP reports an Rx overflow or a recv times out: abort (default), mark,\n"
+                    "                        or zerofill - mark keeps streaming and flags the gap in the frame header (requires\n"
+                    "                        rxframed), zerofill keeps streaming and replaces the lost samples (up to rxmaxzerofill)\n"
+                    "                        with zeros)\n"
+                    "    --rxmaxerrors (stop after this many Rx overflows/timeouts when the Rx overflow policy is not abort - defaults to 0 (no limit))\n"
+                    "    --rxmaxzerofill (longest gap in seconds which the zerofill Rx overflow policy fills with zeros, longer gaps are\n"
+                    "                     flagged in the frame header when rxframed and stop Rx otherwise - defaults to 1)\n"
+                    "    --txframed (each Tx block starts with a header (see pipeFrame.h) giving the start/end of burst flags and\n"
+                    "                the device time at which to send the block - requires a single Tx pipe, forcefulltxbuffer is ignored)\n"
+                    "    --telemetrysocket (path of a Unix socket on which the per-thread counters are served as JSON lines)\n"
+                    "    --telemetryinterval (period in ms of the JSON lines sent to each telemetry client - defaults to 1000, 0 sends\n"
+                    "                         a single line per connection)\n"
+                    "    --rxdataage (also histogram the age of each Rx packet from its device time - relative to the\n"
+                    "                 youngest packet seen as the host and device clocks are not synchronized)\n"
+                    "    Latency histograms (Rx recv to pipe, Tx pipe to send) are printed at exit and when SIGUSR1 is received\n"
+                    "    --txburstacks (print each Tx burst ACK reported by the USRP - underflows, sequence errors and time errors are\n"
+                    "                   always counted, and are printed with verbose)\n"
                     "    --forcefulltxbuffer (forces a full tx buffer for each transmission to the tx)\n"
-                    "    --txchan (tx channel: 0 or 1 for USRP x310)\n"
-                    "    --rxchan (tx channel: 0 or 1 for USRP x310)\n"
-                    "    --txratelimit (limit tx rate to 1.01x that expected by the tx)"
+                    "    --txchan (tx channel: 0 or 1 for USRP x310 - a comma separated list (ex. 0,1) streams multiple channels coherently)\n"
+                    "    --rxchan (rx channel: 0 or 1 for USRP x310 - a comma separated list (ex. 0,1) streams multiple channels coherently)\n"
+                    "    --txratelimit (limit tx rate to 1.01x that expected by the tx - the Tx handler sleeps until each block is due)\n"
+                    "    --txrateburst (number of samples which can be sent back to back after a stall when txratelimit is set - defaults to 1 Tx buffer)\n"
+                    "                 should be larger than the number of samples sent during the wake up latency of a sleep\n"
+                    "    --cpuformat (type of each sample component on the Rx and Tx pipes: fc32 (default), sc16, or sc8)\n"
+                    "    --rxcpuformat (type of each sample component on the Rx pipe: fc32 (default), sc16, or sc8)\n"
+                    "    --txcpuformat (type of each sample component on the Tx pipe: fc32 (default), sc16, or sc8)\n"
+                    "    --rxotwformat (Rx over the wire format: sc16 (default) or sc8)\n"
+                    "    --txotwformat (Tx over the wire format: sc16 (default) or sc8)\n"
+                    "    --pipeformat (layout of samples in each pipe block: planar (default) or interleaved)\n"
+                    "                 planar: a block of real samples followed by a block of imagionary samples\n"
+                    "                 interleaved: complex samples with interleaved real and imagionary components (Rx samples are\n"
+                    "                 received directly into the pipe block and Tx blocks are sent directly to the USRP)\n"
+                    "    --hugepages (back the rings and streaming buffers with 2MB hugepages - falls back to transparent hugepages\n"
+                    "                 if none are reserved in /proc/sys/vm/nr_hugepages)\n"
+                    "    --mlock (lock the rings and streaming buffers in memory - may require raising ulimit -l)\n"
+                    "    The rings are placed on the NUMA node of the Rx/Tx CPU when pinned.  Where each buffer landed is printed at startup\n"
                     "    -v (enable verbose prints)\n"
                     "    -h (print this help message)\n"
-                    "    --help (print this help message)\n");
+                    "    --help (print this help message)\n", FIR_DEFAULT_TAPS_PER_PHASE, FIR_DEFAULT_TAPS_PER_PHASE);
 };
 
 void cleanup(char* device_args, uhd_usrp_handle usrp, uhd_rx_streamer_handle rx_streamer, uhd_rx_metadata_handle rx_md,
@@ -101,6 +198,44 @@ void cleanup(char* device_args, uhd_usrp_handle usrp, uhd_rx_streamer_handle rx_
     exit(return_code);
 }
 
+//Returns false if the format name is not recognized
+bool parseSampleFormat(const char* name, sampleFormat_e* format){
+    if(strcmp(name, "fc32") == 0){
+        *format = SAMPLE_FORMAT_FC32;
+    }else if(strcmp(name, "sc16") == 0){
+        *format = SAMPLE_FORMAT_SC16;
+    }else if(strcmp(name, "sc8") == 0){
+        *format = SAMPLE_FORMAT_SC8;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+//Splits a comma separated list in place.  Returns the number of items or -1 if there are more than maxItems
+int parseList(char* list, char** items, int maxItems){
+    int numItems = 0;
+    char* savePtr = NULL;
+    for(char* item = strtok_r(list, ",", &savePtr); item != NULL; item = strtok_r(NULL, ",", &savePtr)){
+        if(numItems >= maxItems){
+            return -1;
+        }
+        items[numItems] = item;
+        numItems++;
+    }
+    return numItems;
+}
+
+//Parses a comma separated list of channels.  Returns the number of channels or -1 if the list is invalid
+int parseChannelList(char* list, size_t* channels){
+    char* items[MAX_CHANNELS];
+    int numItems = parseList(list, items, MAX_CHANNELS);
+    for(int i = 0; i<numItems; i++){
+        channels[i] = atoi(items[i]);
+    }
+    return numItems < 1 ? -1 : numItems;
+}
+
 void sigint_handler(int code){
     (void)code;
     terminateStatus = true;
@@ -111,23 +246,64 @@ typedef struct{
     int option;
     double freq;
     double rate;
-    int rxCPU;
-    int txCPU;
-    int uhdCPU;
+    threadConfig_t rxThread;
+    threadConfig_t rxWriterThread;
+    threadConfig_t txThread;
+    threadConfig_t txReaderThread;
+    threadConfig_t txAsyncThread;
+    threadConfig_t uhdThread;
+    threadConfig_t helperThread;
     double txGain;
     double rxGain;
     char* device_args;
-    size_t rxChannel;
-    size_t txChannel;
+    size_t rxChannels[MAX_CHANNELS];
+    size_t numRxChannels;
+    size_t txChannels[MAX_CHANNELS];
+    size_t numTxChannels;
     char* rxPipeName;
     char* txPipeName;
+    char* rxPipeNames[MAX_CHANNELS];
+    int numRxPipes;
+    char* txPipeNames[MAX_CHANNELS];
+    int numTxPipes;
     char* txFeedbackPipeName;
+    int txCreditWindow;
+    int txCreditBatch;
+    txCreditReturn_e txCreditReturn;
     bool verbose;
     int return_code;
     int samplesPerTransactionRx;
     int samplesPerTransactionTx;
+    int rxRingDepth;
+    int txRingDepth;
+    int txPrefillBlocks;
+    int pipeBatchBlocks;
+    int pipeBatchLatencyUs;
+    bool rxZeroCopy;
+    transport_e transport;
     bool forceFullTxBuffer;
+    bool rxFramed;
+    rxOverflowPolicy_e rxOverflowPolicy;
+    int rxMaxErrors;
+    double rxMaxZeroFill;
+    bool rxDataAge;
+    int rxDecimation;
+    firTaps_t rxDecimTaps;
+    bool rxConditioning;
+    rxConditionConfig_t rxCondition;
+    int txInterpolation;
+    firTaps_t txInterpTaps;
+    bool txFramed;
+    bool txBurstAcks;
+    char* telemetrySocket;
+    int telemetryIntervalMs;
     bool txRateLimit;
+    int txRateBurst;
+    pipeFormat_e pipeFormat;
+    sampleFormat_e rxCpuFormat;
+    sampleFormat_e txCpuFormat;
+    sampleFormat_e rxOtwFormat;
+    sampleFormat_e txOtwFormat;
 } mainOptions_t;
 
 void* mainThread(void* args_uncast){
@@ -135,23 +311,64 @@ void* mainThread(void* args_uncast){
     int option = args->option;
     double freq = args->freq;
     double rate = args->rate;
-    int rxCPU = args->rxCPU;
-    int txCPU = args->txCPU;
-    int uhdCPU = args->uhdCPU;
+    threadConfig_t* rxThread = &args->rxThread;
+    threadConfig_t* rxWriterThread = &args->rxWriterThread;
+    threadConfig_t* txThread = &args->txThread;
+    threadConfig_t* txReaderThread = &args->txReaderThread;
+    threadConfig_t* txAsyncThread = &args->txAsyncThread;
+    threadConfig_t* uhdThread = &args->uhdThread;
+    threadConfig_t* helperThread = &args->helperThread;
     double txGain = args->txGain;
     double rxGain = args->rxGain;
     char* device_args = args->device_args;
-    size_t rxChannel = args->rxChannel;
-    size_t txChannel = args->txChannel;
+    size_t* rxChannels = args->rxChannels;
+    size_t numRxChannels = args->numRxChannels;
+    size_t* txChannels = args->txChannels;
+    size_t numTxChannels = args->numTxChannels;
     char* rxPipeName = args->rxPipeName;
     char* txPipeName = args->txPipeName;
+    char** rxPipeNames = args->rxPipeNames;
+    int numRxPipes = args->numRxPipes;
+    char** txPipeNames = args->txPipeNames;
+    int numTxPipes = args->numTxPipes;
     char* txFeedbackPipeName = args->txFeedbackPipeName;
+    int txCreditWindow = args->txCreditWindow;
+    int txCreditBatch = args->txCreditBatch;
+    txCreditReturn_e txCreditReturn = args->txCreditReturn;
     bool verbose = args->verbose;
     int return_code = args->return_code;
     int samplesPerTransactionRx = args->samplesPerTransactionRx;
     int samplesPerTransactionTx = args->samplesPerTransactionTx;
+    int rxRingDepth = args->rxRingDepth;
+    int txRingDepth = args->txRingDepth;
+    int txPrefillBlocks = args->txPrefillBlocks;
+    int pipeBatchBlocks = args->pipeBatchBlocks;
+    int pipeBatchLatencyUs = args->pipeBatchLatencyUs;
+    bool rxZeroCopy = args->rxZeroCopy;
+    transport_e transport = args->transport;
     bool forceFullTxBuffer = args->forceFullTxBuffer;
+    bool rxFramed = args->rxFramed;
+    rxOverflowPolicy_e rxOverflowPolicy = args->rxOverflowPolicy;
+    int rxMaxErrors = args->rxMaxErrors;
+    double rxMaxZeroFill = args->rxMaxZeroFill;
+    bool rxDataAge = args->rxDataAge;
+    int rxDecimation = args->rxDecimation;
+    firTaps_t* rxDecimTaps = &args->rxDecimTaps;
+    bool rxConditioning = args->rxConditioning;
+    rxConditionConfig_t* rxCondition = &args->rxCondition;
+    int txInterpolation = args->txInterpolation;
+    firTaps_t* txInterpTaps = &args->txInterpTaps;
+    bool txFramed = args->txFramed;
+    bool txBurstAcks = args->txBurstAcks;
+    char* telemetrySocket = args->telemetrySocket;
+    int telemetryIntervalMs = args->telemetryIntervalMs;
     bool txRateLimit = args->txRateLimit;
+    int txRateBurst = args->txRateBurst;
+    pipeFormat_e pipeFormat = args->pipeFormat;
+    sampleFormat_e rxCpuFormat = args->rxCpuFormat;
+    sampleFormat_e txCpuFormat = args->txCpuFormat;
+    sampleFormat_e rxOtwFormat = args->rxOtwFormat;
+    sampleFormat_e txOtwFormat = args->txOtwFormat;
 
     uhd_usrp_handle usrp = NULL;
     uhd_rx_streamer_handle rx_streamer = NULL;
@@ -159,8 +376,8 @@ void* mainThread(void* args_uncast){
     uhd_tx_streamer_handle tx_streamer = NULL;
     uhd_tx_metadata_handle tx_md = NULL;
 
-    //Set thread priority (real time) if possible
-    if(uhd_set_thread_priority(uhd_default_thread_priority, true)){
+    //Set thread priority (real time) if possible.  An explicit --uhdsched was already applied when this thread was created
+    if(!uhdThread->schedGiven && uhd_set_thread_priority(uhd_default_thread_priority, true)){
         fprintf(stderr, "Unable to set thread priority. Continuing anyway.\n");
     }
 
@@ -204,69 +421,76 @@ void* mainThread(void* args_uncast){
         uhd_tune_result_t tune_result;
 
         uhd_stream_args_t stream_args = {
-                .cpu_format = "fc32", //Want the received data to be converted to single precision complex floating point
-                .otw_format = "sc16", //The actual "On the wire" format is a 16 bit complex integer -> this matches what the ADC supplies
+                .cpu_format = sampleFormatName(rxCpuFormat), //The format of the received data passed to the Rx pipe.  fc32 causes UHD to convert to single precision complex floating point
+                .otw_format = sampleFormatName(rxOtwFormat), //The actual "On the wire" format.  sc16 is a 16 bit complex integer -> this matches what the ADC supplies
                 .args = "", //Can supply SPP arguments like spp=128
-                .channel_list = &rxChannel,
-                .n_channels = 1
+                .channel_list = rxChannels,
+                .n_channels = numRxChannels
         };
 
-        // Set rate
-        fprintf(stderr, "Setting RX Rate: %f...\n", rate);
-        uhdStatus = uhd_usrp_set_rx_rate(usrp, rate, rxChannel);
-        if(uhdStatus){
-            printf("Error Setting Rx Rate\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
+        //Configure each channel
+        for(size_t chanInd = 0; chanInd<numRxChannels; chanInd++) {
+            size_t rxChannel = rxChannels[chanInd];
 
-        // See what rate actually is
-        uhdStatus = uhd_usrp_get_rx_rate(usrp, rxChannel, &rate);
-        if(uhdStatus){
-            printf("Error Getting Rx Rate\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
-        fprintf(stderr, "Actual RX Rate: %f...\n", rate);
+            // Set rate
+            fprintf(stderr, "Setting RX Rate (Channel %zu): %f...\n", rxChannel, rate);
+            uhdStatus = uhd_usrp_set_rx_rate(usrp, rate, rxChannel);
+            if(uhdStatus){
+                printf("Error Setting Rx Rate\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
 
-        // Set gain
-        fprintf(stderr, "Setting RX Gain: %f dB...\n", rxGain);
-        uhdStatus =  uhd_usrp_set_rx_gain(usrp, rxGain, rxChannel, "");
-        if(uhdStatus){
-            printf("Error Setting Rx Gain\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
+            // See what rate actually is
+            uhdStatus = uhd_usrp_get_rx_rate(usrp, rxChannel, &rate);
+            if(uhdStatus){
+                printf("Error Getting Rx Rate\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+            fprintf(stderr, "Actual RX Rate: %f...\n", rate);
 
-        // See what gain actually is
-        uhdStatus =  uhd_usrp_get_rx_gain(usrp, rxChannel, "", &rxGain);
-        if(uhdStatus){
-            printf("Error Getting Rx Gain\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
-        fprintf(stderr, "Actual RX Gain: %f...\n", rxGain);
+            // Set gain
+            fprintf(stderr, "Setting RX Gain: %f dB...\n", rxGain);
+            uhdStatus =  uhd_usrp_set_rx_gain(usrp, rxGain, rxChannel, "");
+            if(uhdStatus){
+                printf("Error Setting Rx Gain\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
 
-        // Set frequency
-        fprintf(stderr, "Setting RX frequency: %f MHz...\n", freq / 1e6);
-        uhdStatus = uhd_usrp_set_rx_freq(usrp, &tune_request, rxChannel, &tune_result);
-        if(uhdStatus){
-            printf("Error Setting Rx Frequency\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
+            // See what gain actually is
+            uhdStatus =  uhd_usrp_get_rx_gain(usrp, rxChannel, "", &rxGain);
+            if(uhdStatus){
+                printf("Error Getting Rx Gain\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+            fprintf(stderr, "Actual RX Gain: %f...\n", rxGain);
 
-        // See what frequency actually is
-        uhdStatus = uhd_usrp_get_rx_freq(usrp, rxChannel, &freq);
-        if(uhdStatus){
-            printf("Error Getting Rx Frequency\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            // Set frequency
+            fprintf(stderr, "Setting RX frequency: %f MHz...\n", freq / 1e6);
+            uhdStatus = uhd_usrp_set_rx_freq(usrp, &tune_request, rxChannel, &tune_result);
+            if(uhdStatus){
+                printf("Error Setting Rx Frequency\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+
+            // See what frequency actually is
+            uhdStatus = uhd_usrp_get_rx_freq(usrp, rxChannel, &freq);
+            if(uhdStatus){
+                printf("Error Getting Rx Frequency\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+            fprintf(stderr, "Actual RX frequency: %f MHz...\n", freq / 1e6);
+        }
+        if(rxDecimation > 1){
+            fprintf(stderr, "Rx pipe rate (decimated by %d with %zu taps): %f...\n", rxDecimation, rxDecimTaps->numTaps, rate/rxDecimation);
         }
-        fprintf(stderr, "Actual RX frequency: %f MHz...\n", freq / 1e6);
 
         // Set up streamer
-        stream_args.channel_list = &rxChannel;
         uhdStatus = uhd_usrp_get_rx_stream(usrp, &stream_args, rx_streamer);
         if(uhdStatus){
             printf("Error Getting Rx Stream\n");
@@ -303,70 +527,77 @@ void* mainThread(void* args_uncast){
         uhd_tune_result_t tune_result;
 
         uhd_stream_args_t stream_args = {
-                .cpu_format = "fc32", //Want the received data to be converted to single precision complex floating point
-                .otw_format = "sc16", //The actual "On the wire" format is a 16 bit complex integer -> this matches what the DAC IP expects
+                .cpu_format = sampleFormatName(txCpuFormat), //The format of the data read from the Tx pipe.  fc32 causes UHD to convert from single precision complex floating point
+                .otw_format = sampleFormatName(txOtwFormat), //The actual "On the wire" format.  sc16 is a 16 bit complex integer -> this matches what the DAC IP expects
                 .args = "",
-                .channel_list = &txChannel,
-                .n_channels = 1
+                .channel_list = txChannels,
+                .n_channels = numTxChannels
         };
 
-        // Set rate
-        fprintf(stderr, "Setting TX Rate: %f...\n", rate);
-        uhdStatus = uhd_usrp_set_tx_rate(usrp, rate, txChannel);
-        if(uhdStatus){
-            printf("Error Setting Tx Rate\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
+        //Configure each channel
+        for(size_t chanInd = 0; chanInd<numTxChannels; chanInd++) {
+            size_t txChannel = txChannels[chanInd];
 
-        // See what rate actually is
-        uhdStatus = uhd_usrp_get_tx_rate(usrp, txChannel, &rate);
-        if(uhdStatus){
-            printf("Error Getting Tx Rate\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
-        fprintf(stderr, "Actual TX Rate: %f...\n\n", rate);
+            // Set rate
+            fprintf(stderr, "Setting TX Rate (Channel %zu): %f...\n", txChannel, rate);
+            uhdStatus = uhd_usrp_set_tx_rate(usrp, rate, txChannel);
+            if(uhdStatus){
+                printf("Error Setting Tx Rate\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
 
-        // Set gain
-        fprintf(stderr, "Setting TX Gain: %f db...\n", txGain);
-        uhdStatus = uhd_usrp_set_tx_gain(usrp, txGain, 0, "");
-        if(uhdStatus){
-            printf("Error Setting Tx Gain\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
+            // See what rate actually is
+            uhdStatus = uhd_usrp_get_tx_rate(usrp, txChannel, &rate);
+            if(uhdStatus){
+                printf("Error Getting Tx Rate\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+            fprintf(stderr, "Actual TX Rate: %f...\n\n", rate);
 
-        // See what gain actually is
-        uhdStatus = uhd_usrp_get_tx_gain(usrp, txChannel, "", &txGain);
-        if(uhdStatus){
-            printf("Error Getting Tx Gain\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
-        fprintf(stderr, "Actual TX Gain: %f...\n", txGain);
+            // Set gain
+            fprintf(stderr, "Setting TX Gain: %f db...\n", txGain);
+            uhdStatus = uhd_usrp_set_tx_gain(usrp, txGain, txChannel, "");
+            if(uhdStatus){
+                printf("Error Setting Tx Gain\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
 
-        // Set frequency
-        fprintf(stderr, "Setting TX frequency: %f MHz...\n", freq / 1e6);
-        uhdStatus = uhd_usrp_set_tx_freq(usrp, &tune_request, txChannel, &tune_result);
-        if(uhdStatus){
-            printf("Error Setting Tx Frequency\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
+            // See what gain actually is
+            uhdStatus = uhd_usrp_get_tx_gain(usrp, txChannel, "", &txGain);
+            if(uhdStatus){
+                printf("Error Getting Tx Gain\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+            fprintf(stderr, "Actual TX Gain: %f...\n", txGain);
 
-        // See what frequency actually is
-        uhdStatus = uhd_usrp_get_tx_freq(usrp, txChannel, &freq);
-        if(uhdStatus){
-            printf("Error Getting Tx Frequency\n");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
-        }
+            // Set frequency
+            fprintf(stderr, "Setting TX frequency: %f MHz...\n", freq / 1e6);
+            uhdStatus = uhd_usrp_set_tx_freq(usrp, &tune_request, txChannel, &tune_result);
+            if(uhdStatus){
+                printf("Error Setting Tx Frequency\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+
+            // See what frequency actually is
+            uhdStatus = uhd_usrp_get_tx_freq(usrp, txChannel, &freq);
+            if(uhdStatus){
+                printf("Error Getting Tx Frequency\n");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
 
-        fprintf(stderr, "Actual TX frequency: %f MHz...\n", freq / 1e6);
+            fprintf(stderr, "Actual TX frequency: %f MHz...\n", freq / 1e6);
+        }
+        if(txInterpolation > 1){
+            fprintf(stderr, "Tx pipe rate (interpolated by %d with %zu taps): %f...\n", txInterpolation, txInterpTaps->numTaps, rate/txInterpolation);
+        }
 
         // Set up streamer
-        stream_args.channel_list = &txChannel;
         uhdStatus = uhd_usrp_get_tx_stream(usrp, &stream_args, tx_streamer);
         if(uhdStatus){
             printf("Error Getting Tx Stream\n");
@@ -376,47 +607,140 @@ void* mainThread(void* args_uncast){
     }
 
     //TODO: Create Signal Handler
+    //The streaming threads update their counters whether or not the telemetry server is running
+    telemetry_t telemetry;
+    telemetryInit(&telemetry);
+
+    //Each histogram is only recorded to by one streaming thread.  The block stamps (1 per ring slot) carry the time
+    //each block entered the pipeline from the producer to the consumer of the ring
+    latencyHist_t rxLatency;
+    latencyHist_t rxDataAgeHist;
+    latencyHist_t txLatency;
+    latencyHistInit(&rxLatency, "Rx latency (recv to pipe)");
+    latencyHistInit(&rxDataAgeHist, "Rx data age (relative)");
+    latencyHistInit(&txLatency, "Tx latency (pipe to send)");
+    uint64_t* rxBlockStamps = NULL;
+    uint64_t* txBlockStamps = NULL;
+
     pthread_t txPThread;
     txHandlerArgs_t txArgs;
-    pthread_attr_t txThreadAttributes;
-    cpu_set_t txCPUSet;
+    spscRing_t txRing;
+
+    pthread_t txReaderPThread;
+    txPipeReaderArgs_t txReaderArgs;
+
+    pthread_t txAsyncPThread;
+    txAsyncMonitorArgs_t txAsyncArgs;
+    txAsyncCounters_t txAsyncCounters;
+    bool txDone = false;
+
+    txCredits_t txCredits;
+    txCredits_t* txCreditsPtr = NULL; //NULL for the per-read feedback
 
     if(txPipeName != NULL){
-        //Create and launch Tx Thread
-        //Create Thread Parameters
-        int attrStatus = pthread_attr_init(&txThreadAttributes);
-        if(attrStatus != 0)
-        {
-            printf("Error creating Tx pthread attribute");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+        //Create the ring between the Tx pipe reader and the Tx handler
+        //Each block is samplesPerTransactionTx real samples followed by samplesPerTransactionTx imagionary samples for each
+        //channel in turn (preceded by the frame header if framing is enabled)
+        size_t txBlockSize = numTxChannels*samplesPerTransactionTx*2*sampleFormatComponentSize(txCpuFormat);
+        if(txFramed){
+            txBlockSize += sizeof(txFrameHeader_t);
+        }
+        if(transport == TRANSPORT_SHM){
+            //The Tx ring is the shared memory ring.  The producer writes the blocks in place and the Tx handler sends
+            //them directly, so there is no Tx pipe reader.  Like opening a FIFO, the Tx handler waits for the producer
+            //to open the ring.  The blocks are not stamped as they are committed by the producer
+            if(spscRingInitShm(&txRing, txPipeNames[0], txRingDepth, txBlockSize, samplesPerTransactionTx, numTxChannels, txCpuFormat, pipeFormat) != 0){
+                printf("Unable to Create Tx Shared Memory Ring: %s\n", txPipeNames[0]);
+                perror(NULL);
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+            printf("Created Tx Shared Memory Ring: %s\n", txPipeNames[0]);
+            telemetry.txRing = &txRing;
+        }else{
+            //The ring is placed on the node of the Tx CPU (if pinned) as that is where the blocks are sent from
+            int ringStatus = spscRingInitPlaced(&txRing, txRingDepth, txBlockSize, CACHE_LINE_SIZE, streamBufferCpuNode(threadConfigFirstCpu(txThread)), "Tx ring");
+            telemetry.txRing = &txRing;
+            txBlockStamps = calloc(txRingDepth, sizeof(uint64_t));
+            if(ringStatus != 0 || txBlockStamps == NULL)
+            {
+                printf("Error creating Tx ring");
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
         }
 
-        if(txCPU>=0){
-            CPU_ZERO(&txCPUSet);
-            CPU_SET(txCPU, &txCPUSet);
-            int setAfinityStatus = pthread_attr_setaffinity_np(&txThreadAttributes, sizeof(cpu_set_t), &txCPUSet);
-            if(setAfinityStatus != 0)
+        if(txFeedbackPipeName != NULL && txCreditWindow > 0){
+            if(txCreditsInit(&txCredits, txCreditWindow, txCreditBatch, txCreditReturn) != 0)
             {
-                printf("Error creating Tx pthread core affinity");
+                printf("Error creating Tx credits");
                 return_code = EXIT_FAILURE;
                 cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
             }
+            txCreditsPtr = &txCredits;
+            if(txCreditReturn == TX_CREDIT_RETURN_ACK){
+                fprintf(stderr, "Tx credit window %d blocks, returned on each burst ACK\n", txCredits.window);
+            }else{
+                fprintf(stderr, "Tx credit window %d blocks, returned in batches of %d blocks once sent\n", txCredits.window, txCredits.batch);
+            }
+        }
+    }
+
+    if(txPipeName != NULL && transport != TRANSPORT_SHM){
+        //Create and launch Tx Pipe Reader Thread
+        //Create Tx Pipe Reader Thread Args
+        txReaderArgs.terminateStatus = &terminateStatus;
+        txReaderArgs.txPipeNames = txPipeNames;
+        txReaderArgs.numTxPipes = numTxPipes;
+        txReaderArgs.txFeedbackPipeName = txFeedbackPipeName;
+        txReaderArgs.txRing = &txRing;
+        txReaderArgs.samplesPerTransactTx = samplesPerTransactionTx;
+        txReaderArgs.numChannels = numTxChannels;
+        txReaderArgs.cpuFormat = txCpuFormat;
+        txReaderArgs.pipeBatchBlocks = pipeBatchBlocks;
+        txReaderArgs.framed = txFramed;
+        txReaderArgs.pipeFormat = pipeFormat;
+        txReaderArgs.blockStamps = txBlockStamps;
+        txReaderArgs.credits = txCreditsPtr;
+        txReaderArgs.telemetry = &telemetry.threads[TELEMETRY_TX_READER];
+        txReaderArgs.verbose = verbose;
+
+        int threadStartStatus = threadConfigCreate(&txReaderPThread, txReaderThread, txPipeReader, &txReaderArgs);
+        if(threadStartStatus != 0)
+        {
+            printf("Error creating Tx pipe reader thread");
+            perror(NULL);
+            return_code = EXIT_FAILURE;
+            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
         }
+    }
 
+    if(txPipeName != NULL){
+        //Create and launch Tx Thread
         //Create Tx Thread Args
         txArgs.terminateStatus = &terminateStatus; //Used to periodically check if thread should terminate
-        txArgs.txPipeName = txPipeName;
-        txArgs.txFeedbackPipeName = txFeedbackPipeName;
+        txArgs.txRing = &txRing;
         txArgs.tx_streamer = tx_streamer;
         txArgs.tx_md = tx_md;
         txArgs.samplesPerTransactTx = samplesPerTransactionTx;
+        txArgs.numChannels = numTxChannels;
+        txArgs.interpolation = txInterpolation;
+        txArgs.interpTaps = txInterpTaps;
+        txArgs.txPrefillBlocks = txPrefillBlocks < txRingDepth ? txPrefillBlocks : txRingDepth;
         txArgs.forceFullTxBuffer = forceFullTxBuffer;
+        txArgs.framed = txFramed;
+        txArgs.pipeFormat = pipeFormat;
+        txArgs.cpuFormat = txCpuFormat;
+        txArgs.telemetry = &telemetry.threads[TELEMETRY_TX_HANDLER];
         txArgs.verbose = verbose;
         txArgs.txRateLimit = txRateLimit;
         txArgs.txRate = rate;
+        txArgs.txRateBurst = txRateBurst;
+        txArgs.blockStamps = txBlockStamps;
+        txArgs.latency = txBlockStamps != NULL ? &txLatency : NULL;
+        txArgs.credits = txCreditsPtr;
 
-        int threadStartStatus = pthread_create(&txPThread, &txThreadAttributes, txHandler, &txArgs);
+        int threadStartStatus = threadConfigCreate(&txPThread, txThread, txHandler, &txArgs);
         if(threadStartStatus != 0)
         {
             printf("Error creating Tx thread");
@@ -424,48 +748,139 @@ void* mainThread(void* args_uncast){
             return_code = EXIT_FAILURE;
             cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
         }
+
+        //Create and launch Tx Async Monitor Thread
+        //Create Tx Async Monitor Thread Args
+        atomic_init(&txAsyncCounters.underflows, 0);
+        atomic_init(&txAsyncCounters.seqErrors, 0);
+        atomic_init(&txAsyncCounters.timeErrors, 0);
+        atomic_init(&txAsyncCounters.burstAcks, 0);
+        txAsyncArgs.terminateStatus = &terminateStatus;
+        txAsyncArgs.txDone = &txDone;
+        txAsyncArgs.tx_streamer = tx_streamer;
+        txAsyncArgs.counters = &txAsyncCounters;
+        txAsyncArgs.reportBurstAcks = txBurstAcks;
+        txAsyncArgs.credits = txCreditsPtr;
+        txAsyncArgs.telemetry = &telemetry.threads[TELEMETRY_TX_ASYNC];
+        txAsyncArgs.verbose = verbose;
+
+        threadStartStatus = threadConfigCreate(&txAsyncPThread, txAsyncThread, txAsyncMonitor, &txAsyncArgs);
+        if(threadStartStatus != 0)
+        {
+            printf("Error creating Tx async monitor thread");
+            perror(NULL);
+            return_code = EXIT_FAILURE;
+            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+        }
     }
 
     pthread_t rxPThread;
-    pthread_attr_t rxThreadAttributes;
-    cpu_set_t rxCPUSet;
     rxHandlerArgs_t rxArgs;
     bool rxWasRunning = false;
+    spscRing_t rxRing;
+
+    pthread_t rxWriterPThread;
+    rxPipeWriterArgs_t rxWriterArgs;
 
     if(rxPipeName != NULL){
-        //Create and launch Rx Thread
-        //Create Thread Parameters
-        int attrStatus = pthread_attr_init(&rxThreadAttributes);
-        if(attrStatus != 0)
-        {
-            printf("Error creating Rx pthread attribute");
-            return_code = EXIT_FAILURE;
-            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+        //Create the ring between the Rx handler and the Rx pipe writer
+        //Each block is samplesPerTransactionRx real samples followed by samplesPerTransactionRx imagionary samples for each
+        //channel in turn.  When framed, the samples follow a rxFrameHeader_t
+        //For zero copy output, the blocks are page aligned so that they can be gifted to the pipe
+        size_t rxBlockSize = numRxChannels*samplesPerTransactionRx*2*sampleFormatComponentSize(rxCpuFormat);
+        if(rxFramed){
+            rxBlockSize += sizeof(rxFrameHeader_t);
         }
-
-        if(rxCPU >= 0){
-            CPU_ZERO(&rxCPUSet);
-            CPU_SET(rxCPU, &rxCPUSet);
-            int setAfinityStatus = pthread_attr_setaffinity_np(&rxThreadAttributes, sizeof(cpu_set_t), &rxCPUSet);
-            if(setAfinityStatus != 0)
+        size_t rxBlockAlignment = CACHE_LINE_SIZE;
+        if(rxZeroCopy){
+            rxBlockAlignment = sysconf(_SC_PAGESIZE);
+            if(rxBlockSize % rxBlockAlignment != 0){
+                fprintf(stderr, "Rx block size (%zu bytes) is not a multiple of the page size (%zu bytes), partial pages will be passed to the Rx pipe\n", rxBlockSize, rxBlockAlignment);
+            }
+        }
+        if(transport == TRANSPORT_SHM){
+            //The Rx ring is the shared memory ring.  The Rx handler receives into the blocks in place and the consumer
+            //reads them directly, so there is no Rx pipe writer.  Like opening a FIFO, the Rx handler waits for the
+            //consumer to open the ring before issuing the stream command
+            if(spscRingInitShm(&rxRing, rxPipeNames[0], rxRingDepth, rxBlockSize, samplesPerTransactionRx, numRxChannels, rxCpuFormat, pipeFormat) != 0){
+                printf("Unable to Create Rx Shared Memory Ring: %s\n", rxPipeNames[0]);
+                perror(NULL);
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+            printf("Created Rx Shared Memory Ring: %s\n", rxPipeNames[0]);
+            telemetry.rxRing = &rxRing;
+        }else{
+            //The ring is placed on the node of the Rx CPU (if pinned) as that is where the blocks are received into
+            int ringStatus = spscRingInitPlaced(&rxRing, rxRingDepth, rxBlockSize, rxBlockAlignment, streamBufferCpuNode(threadConfigFirstCpu(rxThread)), "Rx ring");
+            telemetry.rxRing = &rxRing;
+            rxBlockStamps = calloc(rxRingDepth, sizeof(uint64_t));
+            if(ringStatus != 0 || rxBlockStamps == NULL)
             {
-                printf("Error creating Rx pthread core affinity");
+                printf("Error creating Rx ring");
                 return_code = EXIT_FAILURE;
                 cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
             }
         }
+    }
+
+    if(rxPipeName != NULL && transport != TRANSPORT_SHM){
+        //Create and launch Rx Pipe Writer Thread
+        //Create Rx Pipe Writer Thread Args
+        rxWriterArgs.terminateStatus=&terminateStatus;
+        rxWriterArgs.rxPipeNames=rxPipeNames;
+        rxWriterArgs.numRxPipes=numRxPipes;
+        rxWriterArgs.rxRing=&rxRing;
+        rxWriterArgs.samplesPerTransactRx=samplesPerTransactionRx;
+        rxWriterArgs.numChannels=numRxChannels;
+        rxWriterArgs.cpuFormat=rxCpuFormat;
+        rxWriterArgs.framed=rxFramed;
+        rxWriterArgs.pipeBatchBlocks=pipeBatchBlocks;
+        rxWriterArgs.pipeBatchLatencyUs=pipeBatchLatencyUs;
+        rxWriterArgs.pipeFormat=pipeFormat;
+        rxWriterArgs.zeroCopy=rxZeroCopy;
+        rxWriterArgs.blockStamps=rxBlockStamps;
+        rxWriterArgs.latency=&rxLatency;
+        rxWriterArgs.telemetry=&telemetry.threads[TELEMETRY_RX_WRITER];
+        rxWriterArgs.verbose=verbose;
+
+        int threadStartStatus = threadConfigCreate(&rxWriterPThread, rxWriterThread, rxPipeWriter, &rxWriterArgs);
+        if(threadStartStatus != 0)
+        {
+            printf("Error creating Rx pipe writer thread");
+            perror(NULL);
+            return_code = EXIT_FAILURE;
+            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+        }
+    }
 
+    if(rxPipeName != NULL){
+        //Create and launch Rx Thread
         //Create Rx Thread Args
         rxArgs.terminateStatus=&terminateStatus;
-        rxArgs.rxPipeName=rxPipeName;
+        rxArgs.rxRing=&rxRing;
         rxArgs.rx_streamer=rx_streamer;
         rxArgs.rx_md=rx_md;
         rxArgs.sendStopCmd=true;
         rxArgs.samplesPerTransactRx=samplesPerTransactionRx;
+        rxArgs.numChannels=numRxChannels;
+        rxArgs.pipeFormat=pipeFormat;
+        rxArgs.cpuFormat=rxCpuFormat;
+        rxArgs.framed=rxFramed;
+        rxArgs.rate=rate;
+        rxArgs.overflowPolicy=rxOverflowPolicy;
+        rxArgs.maxErrors=rxMaxErrors;
+        rxArgs.maxZeroFillSecs=rxMaxZeroFill;
+        rxArgs.blockStamps=rxBlockStamps;
+        rxArgs.dataAge=rxDataAge ? &rxDataAgeHist : NULL;
+        rxArgs.decimation=rxDecimation;
+        rxArgs.decimTaps=rxDecimTaps;
+        rxArgs.condition=rxConditioning ? rxCondition : NULL;
+        rxArgs.telemetry=&telemetry.threads[TELEMETRY_RX_HANDLER];
         rxArgs.verbose=verbose;
         rxArgs.wasRunning=&rxWasRunning;
 
-        int threadStartStatus = pthread_create(&rxPThread, &rxThreadAttributes, rxHandler, &rxArgs);
+        int threadStartStatus = threadConfigCreate(&rxPThread, rxThread, rxHandler, &rxArgs);
         if(threadStartStatus != 0)
         {
             printf("Error creating Rx thread");
@@ -475,6 +890,61 @@ void* mainThread(void* args_uncast){
         }
     }
 
+    //Create and launch the Telemetry Server Thread (runs on the helper CPUs, or the same CPU as this thread if not given)
+    pthread_t telemetryPThread;
+    telemetryServerArgs_t telemetryArgs;
+    bool streamingDone = false;
+    if(telemetrySocket != NULL){
+        telemetryArgs.terminateStatus = &terminateStatus;
+        telemetryArgs.done = &streamingDone;
+        telemetryArgs.telemetry = &telemetry;
+        telemetryArgs.socketPath = telemetrySocket;
+        telemetryArgs.intervalMs = telemetryIntervalMs;
+
+        threadConfig_t telemetryThread = *helperThread;
+        telemetryThread.name = "telemetry";
+        int threadStartStatus = threadConfigCreate(&telemetryPThread, &telemetryThread, telemetryServer, &telemetryArgs);
+        if(threadStartStatus != 0)
+        {
+            printf("Error creating telemetry server thread");
+            perror(NULL);
+            return_code = EXIT_FAILURE;
+            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+        }
+    }
+
+    //Create and launch the Latency Reporter Thread (runs on the helper CPUs, or the same CPU as this thread if not given).  SIGUSR1 is blocked in every
+    //thread (by main) so that it is only accepted by this thread
+    pthread_t latencyPThread;
+    latencyReporterArgs_t latencyArgs;
+    latencyHist_t* latencyHists[3];
+    int numLatencyHists = 0;
+    if(rxPipeName != NULL){
+        if(rxBlockStamps != NULL){
+            latencyHists[numLatencyHists++] = &rxLatency;
+        }
+        if(rxDataAge){
+            latencyHists[numLatencyHists++] = &rxDataAgeHist;
+        }
+    }
+    if(txBlockStamps != NULL){
+        latencyHists[numLatencyHists++] = &txLatency;
+    }
+    latencyArgs.terminateStatus = &terminateStatus;
+    latencyArgs.done = &streamingDone;
+    latencyArgs.hists = latencyHists;
+    latencyArgs.numHists = numLatencyHists;
+    threadConfig_t latencyThread = *helperThread;
+    latencyThread.name = "latencyReport";
+    int latencyStartStatus = threadConfigCreate(&latencyPThread, &latencyThread, latencyReporter, &latencyArgs);
+    if(latencyStartStatus != 0)
+    {
+        printf("Error creating latency reporter thread");
+        perror(NULL);
+        return_code = EXIT_FAILURE;
+        cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+    }
+
     //Join threads
     if(txPipeName != NULL){
         void *result;
@@ -486,6 +956,35 @@ void* mainThread(void* args_uncast){
             return_code = EXIT_FAILURE;
             cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
         }
+
+        if(transport != TRANSPORT_SHM){
+            joinStatus = pthread_join(txReaderPThread, &result);
+            if(joinStatus != 0)
+            {
+                printf("Could not join Tx pipe reader thread");
+                perror(NULL);
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+        }
+
+        //The async monitor exits once it sees that the Tx handler is done
+        txDone = true;
+        joinStatus = pthread_join(txAsyncPThread, &result);
+        if(joinStatus != 0)
+        {
+            printf("Could not join Tx async monitor thread");
+            perror(NULL);
+            return_code = EXIT_FAILURE;
+            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+        }
+
+        spscRingFree(&txRing);
+        free(txBlockStamps);
+        if(txCreditsPtr != NULL){
+            txCreditsReport(txCreditsPtr);
+            txCreditsFree(txCreditsPtr);
+        }
     }
 
     if(rxPipeName != NULL){
@@ -498,6 +997,47 @@ void* mainThread(void* args_uncast){
             return_code = EXIT_FAILURE;
             cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
         }
+
+        if(transport != TRANSPORT_SHM){
+            joinStatus = pthread_join(rxWriterPThread, &result);
+            if(joinStatus != 0)
+            {
+                printf("Could not join Rx pipe writer thread");
+                perror(NULL);
+                return_code = EXIT_FAILURE;
+                cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+            }
+        }
+
+        spscRingFree(&rxRing);
+        free(rxBlockStamps);
+    }
+
+    //Stops the telemetry server (which sends the final counts to any connected clients) and the latency reporter
+    streamingDone = true;
+    if(telemetrySocket != NULL){
+        void *result;
+        int joinStatus = pthread_join(telemetryPThread, &result);
+        if(joinStatus != 0)
+        {
+            printf("Could not join telemetry server thread");
+            perror(NULL);
+            return_code = EXIT_FAILURE;
+            cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+        }
+    }
+
+    void *latencyResult;
+    int latencyJoinStatus = pthread_join(latencyPThread, &latencyResult);
+    if(latencyJoinStatus != 0)
+    {
+        printf("Could not join latency reporter thread");
+        perror(NULL);
+        return_code = EXIT_FAILURE;
+        cleanup(device_args, usrp, rx_streamer, rx_md, tx_streamer, tx_md, verbose, return_code);
+    }
+    for(int histInd = 0; histInd<numLatencyHists; histInd++){
+        latencyHistReport(latencyHists[histInd]);
     }
 
     // Cleanup
@@ -516,23 +1056,76 @@ int main(int argc, char* argv[])
     int option = 0;
     double freq = 500e6;
     double rate = 1e6;
-    int rxCPU = -1;
-    int txCPU = -1;
-    int uhdCPU = -1;
+    threadConfig_t rxThread;
+    threadConfigInit(&rxThread, "rxHandler");
+    threadConfig_t rxWriterThread;
+    threadConfigInit(&rxWriterThread, "rxWriter");
+    threadConfig_t txThread;
+    threadConfigInit(&txThread, "txHandler");
+    threadConfig_t txReaderThread;
+    threadConfigInit(&txReaderThread, "txReader");
+    threadConfig_t txAsyncThread;
+    threadConfigInit(&txAsyncThread, "txAsync");
+    threadConfig_t uhdThread;
+    threadConfigInit(&uhdThread, "uhd");
+    threadConfig_t helperThread; //The telemetry server and latency reporter
+    threadConfigInit(&helperThread, "helper");
     double txGain = 5.0;
     double rxGain = 5.0;
     char* device_args = NULL;
-    size_t rxChannel = 0;
-    size_t txChannel = 0;
+    size_t rxChannels[MAX_CHANNELS] = {0};
+    size_t numRxChannels = 1;
+    size_t txChannels[MAX_CHANNELS] = {0};
+    size_t numTxChannels = 1;
     char* rxPipeName = NULL;
     char* txPipeName = NULL;
+    char* rxPipeNames[MAX_CHANNELS];
+    int numRxPipes = 0;
+    char* txPipeNames[MAX_CHANNELS];
+    int numTxPipes = 0;
     char* txFeedbackPipeName = NULL;
+    int txCreditWindow = 0;
+    int txCreditBatch = 0;
+    txCreditReturn_e txCreditReturn = TX_CREDIT_RETURN_SEND;
     bool verbose = false;
+    bool hugepages = false;
+    bool lockBuffers = false;
     int return_code = EXIT_SUCCESS;
     int samplesPerTransactionRx=1;
     int samplesPerTransactionTx=1;
+    int rxRingDepth = 256;
+    int txRingDepth = 256;
+    int txPrefillBlocks = 1;
+    int pipeBatchBlocks = 16;
+    int pipeBatchLatencyUs = 0;
+    bool rxZeroCopy = false;
+    transport_e transport = TRANSPORT_PIPE;
     bool forceFullTxBuffer = false;
+    bool rxFramed = false;
+    rxOverflowPolicy_e rxOverflowPolicy = RX_OVERFLOW_POLICY_ABORT;
+    bool rxOverflowPolicyGiven = false;
+    int rxMaxErrors = 0;
+    double rxMaxZeroFill = 1;
+    bool rxDataAge = false;
+    int rxDecimation = 1;
+    char* rxDecimTapsFile = NULL;
+    int rxDecimTapLen = 0;
+    rxConditionConfig_t rxCondition = {.scale = 1, .dcTimeConstant = 0, .freqShift = 0};
+    bool rxConditioning = false;
+    int txInterpolation = 1;
+    char* txInterpTapsFile = NULL;
+    int txInterpTapLen = 0;
+    bool txFramed = false;
+    bool txBurstAcks = false;
+    char* telemetrySocket = NULL;
+    int telemetryIntervalMs = 1000;
     bool txRateLimit = false;
+    int txRateBurst = 0;
+    pipeFormat_e pipeFormat = PIPE_FORMAT_PLANAR;
+    sampleFormat_e rxCpuFormat = SAMPLE_FORMAT_FC32;
+    sampleFormat_e txCpuFormat = SAMPLE_FORMAT_FC32;
+    sampleFormat_e rxOtwFormat = SAMPLE_FORMAT_SC16;
+    sampleFormat_e txOtwFormat = SAMPLE_FORMAT_SC16;
 
     // Process options
     for(int i = 1; i<argc; i++){
@@ -588,108 +1181,614 @@ int main(int argc, char* argv[])
                 exit(1);
             }
         }else if(strcmp(argv[i], "-c") == 0) {
-            //This sets both CPUs.
+            //This sets the CPUs of every streaming thread (not the helper threads)
             i++;
             if(i<argc) {
-                int cpus = atoi(argv[i]);
-                txCPU = cpus;
-                rxCPU = cpus;
-                uhdCPU = cpus;
+                if(!threadConfigSetCpus(&txThread, argv[i])){
+                    printf("Invalid CPU list: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+                rxThread.cpus = txThread.cpus;
+                rxThread.pinned = true;
+                rxWriterThread.cpus = txThread.cpus;
+                rxWriterThread.pinned = true;
+                txReaderThread.cpus = txThread.cpus;
+                txReaderThread.pinned = true;
+                txAsyncThread.cpus = txThread.cpus;
+                txAsyncThread.pinned = true;
+                uhdThread.cpus = txThread.cpus;
+                uhdThread.pinned = true;
             }else{
                 print_help();
                 exit(1);
             }
         }else if(strcmp(argv[i], "--txcpu") == 0 || strcmp(argv[i], "-txcpu") == 0 ) {
-            //This sets both CPUs.
             i++;
             if(i<argc) {
-                txCPU = atoi(argv[i]);
+                if(!threadConfigSetCpus(&txThread, argv[i])){
+                    printf("Invalid CPU list: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
             }else{
                 print_help();
                 exit(1);
             }
         }else if(strcmp(argv[i], "--rxcpu") == 0 || strcmp(argv[i], "-rxcpu") == 0 ) {
-            //This sets both CPUs.
             i++;
             if(i<argc) {
-                rxCPU = atoi(argv[i]);
+                if(!threadConfigSetCpus(&rxThread, argv[i])){
+                    printf("Invalid CPU list: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxwritercpu") == 0 || strcmp(argv[i], "-rxwritercpu") == 0 ) {
+            i++;
+            if(i<argc) {
+                if(!threadConfigSetCpus(&rxWriterThread, argv[i])){
+                    printf("Invalid CPU list: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txasynccpu") == 0 || strcmp(argv[i], "-txasynccpu") == 0 ) {
+            i++;
+            if(i<argc) {
+                if(!threadConfigSetCpus(&txAsyncThread, argv[i])){
+                    printf("Invalid CPU list: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txreadercpu") == 0 || strcmp(argv[i], "-txreadercpu") == 0 ) {
+            i++;
+            if(i<argc) {
+                if(!threadConfigSetCpus(&txReaderThread, argv[i])){
+                    printf("Invalid CPU list: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
             }else{
                 print_help();
                 exit(1);
             }
         }else if(strcmp(argv[i], "--uhdcpu") == 0 || strcmp(argv[i], "-uhdcpu") == 0 ) {
-            //This sets both CPUs.
             i++;
             if(i<argc) {
-                uhdCPU = atoi(argv[i]);
+                if(!threadConfigSetCpus(&uhdThread, argv[i])){
+                    printf("Invalid CPU list: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
             }else{
                 print_help();
                 exit(1);
             }
-        }else if(strcmp(argv[i], "--rxpipe") == 0 || strcmp(argv[i], "-rxpipe") == 0) {
+        }else if(strcmp(argv[i], "--helpercpu") == 0 || strcmp(argv[i], "-helpercpu") == 0 ) {
             i++;
             if(i<argc) {
-                rxPipeName = argv[i];
+                if(!threadConfigSetCpus(&helperThread, argv[i])){
+                    printf("Invalid CPU list: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
             }else{
                 print_help();
                 exit(1);
             }
-        }else if(strcmp(argv[i], "--txpipe") == 0 || strcmp(argv[i], "-txpipe") == 0) {
+        }else if(strcmp(argv[i], "--sched") == 0 || strcmp(argv[i], "-sched") == 0 ) {
+            //This sets the scheduling of every streaming thread (not the helper threads)
             i++;
             if(i<argc) {
-                txPipeName = argv[i];
+                if(!threadConfigSetSched(&txThread, argv[i])){
+                    printf("Invalid scheduling policy: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+                threadConfig_t* streamingThreads[] = {&rxThread, &rxWriterThread, &txReaderThread, &txAsyncThread, &uhdThread};
+                for(size_t threadInd = 0; threadInd<sizeof(streamingThreads)/sizeof(streamingThreads[0]); threadInd++){
+                    streamingThreads[threadInd]->schedGiven = true;
+                    streamingThreads[threadInd]->policy = txThread.policy;
+                    streamingThreads[threadInd]->priority = txThread.priority;
+                }
             }else{
                 print_help();
                 exit(1);
             }
-        }else if(strcmp(argv[i], "--txfeedbackpipe") == 0 || strcmp(argv[i], "-txfeedbackpipe") == 0) {
+        }else if(strcmp(argv[i], "--txsched") == 0 || strcmp(argv[i], "-txsched") == 0 ) {
             i++;
             if(i<argc) {
-                txFeedbackPipeName = argv[i];
+                if(!threadConfigSetSched(&txThread, argv[i])){
+                    printf("Invalid scheduling policy: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
             }else{
                 print_help();
                 exit(1);
             }
-        }else if(strcmp(argv[i], "--samppertransacttx") == 0 || strcmp(argv[i], "-samppertransacttx") == 0 ) {
-            //This sets both CPUs.
+        }else if(strcmp(argv[i], "--rxsched") == 0 || strcmp(argv[i], "-rxsched") == 0 ) {
             i++;
             if(i<argc) {
-                samplesPerTransactionTx = atoi(argv[i]);
+                if(!threadConfigSetSched(&rxThread, argv[i])){
+                    printf("Invalid scheduling policy: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
             }else{
                 print_help();
                 exit(1);
             }
-        }else if(strcmp(argv[i], "--samppertransactrx") == 0 || strcmp(argv[i], "-samppertransactrx") == 0 ) {
-            //This sets both CPUs.
+        }else if(strcmp(argv[i], "--rxwritersched") == 0 || strcmp(argv[i], "-rxwritersched") == 0 ) {
             i++;
             if(i<argc) {
-                samplesPerTransactionRx = atoi(argv[i]);
+                if(!threadConfigSetSched(&rxWriterThread, argv[i])){
+                    printf("Invalid scheduling policy: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
             }else{
                 print_help();
                 exit(1);
             }
-        }else if(strcmp(argv[i], "--forcefulltxbuffer") == 0 || strcmp(argv[i], "-forcefulltxbuffer") == 0 ) {
-            forceFullTxBuffer = true;
-            
-        }else if(strcmp(argv[i], "--txchan") == 0 || strcmp(argv[i], "-txchan") == 0 ) {
+        }else if(strcmp(argv[i], "--txasyncsched") == 0 || strcmp(argv[i], "-txasyncsched") == 0 ) {
             i++;
             if(i<argc) {
-                txChannel = atoi(argv[i]);
+                if(!threadConfigSetSched(&txAsyncThread, argv[i])){
+                    printf("Invalid scheduling policy: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
             }else{
                 print_help();
                 exit(1);
             }
-        }else if(strcmp(argv[i], "--rxchan") == 0 || strcmp(argv[i], "-rxchan") == 0 ) {
+        }else if(strcmp(argv[i], "--txreadersched") == 0 || strcmp(argv[i], "-txreadersched") == 0 ) {
             i++;
             if(i<argc) {
-                rxChannel = atoi(argv[i]);
+                if(!threadConfigSetSched(&txReaderThread, argv[i])){
+                    printf("Invalid scheduling policy: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
             }else{
                 print_help();
                 exit(1);
             }
-        }else if(strcmp(argv[i], "--txratelimit") == 0 || strcmp(argv[i], "-txratelimit") == 0) {
-            //No need to get the value of this argument
+        }else if(strcmp(argv[i], "--uhdsched") == 0 || strcmp(argv[i], "-uhdsched") == 0 ) {
+            i++;
+            if(i<argc) {
+                if(!threadConfigSetSched(&uhdThread, argv[i])){
+                    printf("Invalid scheduling policy: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--helpersched") == 0 || strcmp(argv[i], "-helpersched") == 0 ) {
+            i++;
+            if(i<argc) {
+                if(!threadConfigSetSched(&helperThread, argv[i])){
+                    printf("Invalid scheduling policy: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxpipe") == 0 || strcmp(argv[i], "-rxpipe") == 0) {
+            i++;
+            if(i<argc) {
+                rxPipeName = argv[i];
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txpipe") == 0 || strcmp(argv[i], "-txpipe") == 0) {
+            i++;
+            if(i<argc) {
+                txPipeName = argv[i];
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txfeedbackpipe") == 0 || strcmp(argv[i], "-txfeedbackpipe") == 0) {
+            i++;
+            if(i<argc) {
+                txFeedbackPipeName = argv[i];
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txcreditwindow") == 0 || strcmp(argv[i], "-txcreditwindow") == 0) {
+            i++;
+            if(i<argc) {
+                txCreditWindow = atoi(argv[i]);
+                if(txCreditWindow < 0){
+                    printf("Tx credit window cannot be negative\n");
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txcreditbatch") == 0 || strcmp(argv[i], "-txcreditbatch") == 0) {
+            i++;
+            if(i<argc) {
+                txCreditBatch = atoi(argv[i]);
+                if(txCreditBatch < 1){
+                    printf("Tx credit batch must be at least 1 block\n");
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txcreditreturn") == 0 || strcmp(argv[i], "-txcreditreturn") == 0) {
+            i++;
+            if(i<argc) {
+                if(strcmp(argv[i], "send") == 0){
+                    txCreditReturn = TX_CREDIT_RETURN_SEND;
+                }else if(strcmp(argv[i], "ack") == 0){
+                    txCreditReturn = TX_CREDIT_RETURN_ACK;
+                }else{
+                    printf("Unknown Tx credit return: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--samppertransacttx") == 0 || strcmp(argv[i], "-samppertransacttx") == 0 ) {
+            //This sets both CPUs.
+            i++;
+            if(i<argc) {
+                samplesPerTransactionTx = atoi(argv[i]);
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--samppertransactrx") == 0 || strcmp(argv[i], "-samppertransactrx") == 0 ) {
+            //This sets both CPUs.
+            i++;
+            if(i<argc) {
+                samplesPerTransactionRx = atoi(argv[i]);
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxringdepth") == 0 || strcmp(argv[i], "-rxringdepth") == 0 ) {
+            i++;
+            if(i<argc) {
+                rxRingDepth = atoi(argv[i]);
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxdecim") == 0 || strcmp(argv[i], "-rxdecim") == 0 ) {
+            i++;
+            if(i<argc) {
+                rxDecimation = atoi(argv[i]);
+                if(rxDecimation < 1){
+                    printf("The Rx decimation must be at least 1\n");
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxdecimtaps") == 0 || strcmp(argv[i], "-rxdecimtaps") == 0 ) {
+            i++;
+            if(i<argc) {
+                rxDecimTapsFile = argv[i];
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxdecimtaplen") == 0 || strcmp(argv[i], "-rxdecimtaplen") == 0 ) {
+            i++;
+            if(i<argc) {
+                rxDecimTapLen = atoi(argv[i]);
+                if(rxDecimTapLen < 1){
+                    printf("The Rx decimation filter must have at least 1 tap\n");
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxscale") == 0 || strcmp(argv[i], "-rxscale") == 0 ) {
+            i++;
+            if(i<argc) {
+                rxCondition.scale = strtod(argv[i], NULL);
+                rxConditioning = true;
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxdctau") == 0 || strcmp(argv[i], "-rxdctau") == 0 ) {
+            i++;
+            if(i<argc) {
+                rxCondition.dcTimeConstant = strtod(argv[i], NULL);
+                if(rxCondition.dcTimeConstant < 0){
+                    printf("The Rx DC time constant must not be negative\n");
+                    exit(1);
+                }
+                rxConditioning = true;
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxfreqshift") == 0 || strcmp(argv[i], "-rxfreqshift") == 0 ) {
+            i++;
+            if(i<argc) {
+                rxCondition.freqShift = strtod(argv[i], NULL);
+                rxConditioning = true;
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txinterp") == 0 || strcmp(argv[i], "-txinterp") == 0 ) {
+            i++;
+            if(i<argc) {
+                txInterpolation = atoi(argv[i]);
+                if(txInterpolation < 1){
+                    printf("The Tx interpolation must be at least 1\n");
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txinterptaps") == 0 || strcmp(argv[i], "-txinterptaps") == 0 ) {
+            i++;
+            if(i<argc) {
+                txInterpTapsFile = argv[i];
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txinterptaplen") == 0 || strcmp(argv[i], "-txinterptaplen") == 0 ) {
+            i++;
+            if(i<argc) {
+                txInterpTapLen = atoi(argv[i]);
+                if(txInterpTapLen < 1){
+                    printf("The Tx interpolation filter must have at least 1 tap\n");
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txringdepth") == 0 || strcmp(argv[i], "-txringdepth") == 0 ) {
+            i++;
+            if(i<argc) {
+                txRingDepth = atoi(argv[i]);
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txprefill") == 0 || strcmp(argv[i], "-txprefill") == 0 ) {
+            i++;
+            if(i<argc) {
+                txPrefillBlocks = atoi(argv[i]);
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--pipebatch") == 0 || strcmp(argv[i], "-pipebatch") == 0 ) {
+            i++;
+            if(i<argc) {
+                pipeBatchBlocks = atoi(argv[i]);
+                if(pipeBatchBlocks < 1){
+                    printf("Pipe batch must be at least 1 block\n");
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--pipebatchlatency") == 0 || strcmp(argv[i], "-pipebatchlatency") == 0 ) {
+            i++;
+            if(i<argc) {
+                pipeBatchLatencyUs = atoi(argv[i]);
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxzerocopy") == 0 || strcmp(argv[i], "-rxzerocopy") == 0 ) {
+            rxZeroCopy = true;
+        }else if(strcmp(argv[i], "--rxframed") == 0 || strcmp(argv[i], "-rxframed") == 0 ) {
+            rxFramed = true;
+        }else if(strcmp(argv[i], "--txframed") == 0 || strcmp(argv[i], "-txframed") == 0 ) {
+            txFramed = true;
+        }else if(strcmp(argv[i], "--telemetrysocket") == 0 || strcmp(argv[i], "-telemetrysocket") == 0 ) {
+            i++;
+            if(i<argc) {
+                telemetrySocket = argv[i];
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--telemetryinterval") == 0 || strcmp(argv[i], "-telemetryinterval") == 0 ) {
+            i++;
+            if(i<argc) {
+                telemetryIntervalMs = atoi(argv[i]);
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxdataage") == 0 || strcmp(argv[i], "-rxdataage") == 0 ) {
+            rxDataAge = true;
+        }else if(strcmp(argv[i], "--txburstacks") == 0 || strcmp(argv[i], "-txburstacks") == 0 ) {
+            txBurstAcks = true;
+        }else if(strcmp(argv[i], "--forcefulltxbuffer") == 0 || strcmp(argv[i], "-forcefulltxbuffer") == 0 ) {
+            forceFullTxBuffer = true;
+            
+        }else if(strcmp(argv[i], "--txchan") == 0 || strcmp(argv[i], "-txchan") == 0 ) {
+            i++;
+            if(i<argc) {
+                int numChannels = parseChannelList(argv[i], txChannels);
+                if(numChannels < 0){
+                    printf("Tx channel list must contain between 1 and %d channels\n", MAX_CHANNELS);
+                    print_help();
+                    exit(1);
+                }
+                numTxChannels = numChannels;
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxchan") == 0 || strcmp(argv[i], "-rxchan") == 0 ) {
+            i++;
+            if(i<argc) {
+                int numChannels = parseChannelList(argv[i], rxChannels);
+                if(numChannels < 0){
+                    printf("Rx channel list must contain between 1 and %d channels\n", MAX_CHANNELS);
+                    print_help();
+                    exit(1);
+                }
+                numRxChannels = numChannels;
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txratelimit") == 0 || strcmp(argv[i], "-txratelimit") == 0) {
+            //No need to get the value of this argument
             txRateLimit = true;
+        }else if(strcmp(argv[i], "--txrateburst") == 0 || strcmp(argv[i], "-txrateburst") == 0) {
+            i++;
+            if(i<argc) {
+                txRateBurst = atoi(argv[i]);
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxoverflowpolicy") == 0 || strcmp(argv[i], "-rxoverflowpolicy") == 0) {
+            i++;
+            if(i<argc) {
+                if(strcmp(argv[i], "abort") == 0){
+                    rxOverflowPolicy = RX_OVERFLOW_POLICY_ABORT;
+                }else if(strcmp(argv[i], "mark") == 0){
+                    rxOverflowPolicy = RX_OVERFLOW_POLICY_MARK;
+                }else if(strcmp(argv[i], "zerofill") == 0){
+                    rxOverflowPolicy = RX_OVERFLOW_POLICY_ZEROFILL;
+                }else{
+                    printf("Unknown Rx overflow policy: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+                rxOverflowPolicyGiven = true;
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxmaxerrors") == 0 || strcmp(argv[i], "-rxmaxerrors") == 0) {
+            i++;
+            if(i<argc) {
+                rxMaxErrors = atoi(argv[i]);
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxmaxzerofill") == 0 || strcmp(argv[i], "-rxmaxzerofill") == 0) {
+            i++;
+            if(i<argc) {
+                rxMaxZeroFill = atof(argv[i]);
+                if(rxMaxZeroFill < 0){
+                    printf("rxmaxzerofill must be at least 0\n");
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--transport") == 0 || strcmp(argv[i], "-transport") == 0) {
+            i++;
+            if(i<argc) {
+                if(strcmp(argv[i], "pipe") == 0){
+                    transport = TRANSPORT_PIPE;
+                }else if(strcmp(argv[i], "shm") == 0){
+                    transport = TRANSPORT_SHM;
+                }else{
+                    printf("Unknown transport: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--pipeformat") == 0 || strcmp(argv[i], "-pipeformat") == 0) {
+            i++;
+            if(i<argc) {
+                if(strcmp(argv[i], "planar") == 0){
+                    pipeFormat = PIPE_FORMAT_PLANAR;
+                }else if(strcmp(argv[i], "interleaved") == 0){
+                    pipeFormat = PIPE_FORMAT_INTERLEAVED;
+                }else{
+                    printf("Unknown pipe format: %s\n", argv[i]);
+                    print_help();
+                    exit(1);
+                }
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--cpuformat") == 0 || strcmp(argv[i], "-cpuformat") == 0) {
+            //This sets both formats
+            i++;
+            if(i<argc && parseSampleFormat(argv[i], &rxCpuFormat)) {
+                txCpuFormat = rxCpuFormat;
+            }else{
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxcpuformat") == 0 || strcmp(argv[i], "-rxcpuformat") == 0) {
+            i++;
+            if(!(i<argc && parseSampleFormat(argv[i], &rxCpuFormat))) {
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txcpuformat") == 0 || strcmp(argv[i], "-txcpuformat") == 0) {
+            i++;
+            if(!(i<argc && parseSampleFormat(argv[i], &txCpuFormat))) {
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--rxotwformat") == 0 || strcmp(argv[i], "-rxotwformat") == 0) {
+            i++;
+            //fc32 is not supported over the wire
+            if(!(i<argc && parseSampleFormat(argv[i], &rxOtwFormat) && rxOtwFormat != SAMPLE_FORMAT_FC32)) {
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--txotwformat") == 0 || strcmp(argv[i], "-txotwformat") == 0) {
+            i++;
+            //fc32 is not supported over the wire
+            if(!(i<argc && parseSampleFormat(argv[i], &txOtwFormat) && txOtwFormat != SAMPLE_FORMAT_FC32)) {
+                print_help();
+                exit(1);
+            }
+        }else if(strcmp(argv[i], "--hugepages") == 0 || strcmp(argv[i], "-hugepages") == 0) {
+            hugepages = true;
+        }else if(strcmp(argv[i], "--mlock") == 0 || strcmp(argv[i], "-mlock") == 0) {
+            lockBuffers = true;
         }else if(strcmp(argv[i], "-v") == 0) {
             //No need to get the value of this argument
             verbose = true;
@@ -717,54 +1816,197 @@ int main(int argc, char* argv[])
         exit(1);
     }
 
+    //Either 1 pipe for all channels or 1 pipe per channel
+    if(rxPipeName != NULL){
+        numRxPipes = parseList(rxPipeName, rxPipeNames, MAX_CHANNELS);
+        if(numRxPipes != 1 && numRxPipes != (int) numRxChannels){
+            printf("The number of Rx pipes must be 1 or the number of Rx channels (%zu)\n", numRxChannels);
+            exit(1);
+        }
+    }
+    if(txPipeName != NULL){
+        numTxPipes = parseList(txPipeName, txPipeNames, MAX_CHANNELS);
+        if(numTxPipes != 1 && numTxPipes != (int) numTxChannels){
+            printf("The number of Tx pipes must be 1 or the number of Tx channels (%zu)\n", numTxChannels);
+            exit(1);
+        }
+    }
+
+    if(rxFramed && numRxPipes > 1){
+        printf("Rx framing requires a single Rx pipe carrying all channels\n");
+        exit(1);
+    }
+
+    if(rxFramed && !rxOverflowPolicyGiven){
+        //The frame header can report the gap so there is no need to stop
+        rxOverflowPolicy = RX_OVERFLOW_POLICY_MARK;
+    }
+
+    //Without the frame header, the gap could not be seen in the output
+    if(rxOverflowPolicy == RX_OVERFLOW_POLICY_MARK && !rxFramed){
+        printf("The mark Rx overflow policy requires rxframed\n");
+        exit(1);
+    }
+
+    if(txFramed && numTxPipes > 1){
+        printf("Tx framing requires a single Tx pipe carrying all channels\n");
+        exit(1);
+    }
+
+    if(txCreditWindow > 0 && txFeedbackPipeName == NULL && transport == TRANSPORT_PIPE){
+        fprintf(stderr, "The Tx credit window is granted on the Tx feedback pipe, it is ignored without txfeedbackpipe\n");
+    }
+
+    //Only a burst ended by a frame header is ACKed
+    if(txCreditWindow > 0 && txCreditReturn == TX_CREDIT_RETURN_ACK && !txFramed){
+        printf("Returning Tx credits on burst ACK requires txframed\n");
+        exit(1);
+    }
+
+    if(transport == TRANSPORT_SHM){
+        if(numRxPipes > 1 || numTxPipes > 1){
+            printf("The shm transport carries all channels in a single shared memory ring, only 1 name can be given for each direction\n");
+            exit(1);
+        }
+        if(txFeedbackPipeName != NULL){
+            fprintf(stderr, "The Tx feedback pipe is not used with the shm transport, the free blocks in the Tx shared memory ring are the credits\n");
+            txFeedbackPipeName = NULL;
+        }
+        if(rxZeroCopy){
+            fprintf(stderr, "Rx zero copy only applies to the pipe transport\n");
+            rxZeroCopy = false;
+        }
+    }
+
+    //Select the (de)interleave kernels before any streaming thread starts
+    const char* kernelISA = interleaveKernelsInit();
+    fprintf(stderr, "Using %s (de)interleave kernels\n", kernelISA);
+    const char* firISA = firKernelsInit();
+
+    firTaps_t rxDecimTaps = {.taps = NULL, .numTaps = 0};
+    if(rxDecimation > 1 && rxPipeName != NULL){
+        if(rxDecimTapsFile != NULL){
+            if(firTapsLoad(&rxDecimTaps, rxDecimTapsFile) != 0){
+                exit(1);
+            }
+        }else if(firTapsDesign(&rxDecimTaps, rxDecimation, rxDecimTapLen) != 0){
+            printf("Could not design the Rx decimation filter\n");
+            exit(1);
+        }
+        fprintf(stderr, "Rx decimation by %d with %zu taps using %s FIR kernels\n", rxDecimation, rxDecimTaps.numTaps, firISA);
+    }else if(rxDecimTapsFile != NULL || rxDecimTapLen > 0){
+        fprintf(stderr, "The Rx decimation filter is only used when rxdecim is greater than 1\n");
+    }
+
+    if(rxConditioning && rxPipeName != NULL){
+        if(pipeFormat != PIPE_FORMAT_PLANAR){
+            printf("Rx conditioning (rxscale, rxdctau, rxfreqshift) requires the planar pipe format\n");
+            exit(1);
+        }
+        const char* conditionISA = rxConditionKernelsInit();
+        fprintf(stderr, "Rx conditioning (scale %g, DC time constant %g s, frequency shift %g Hz) using %s kernels\n",
+                rxCondition.scale, rxCondition.dcTimeConstant, rxCondition.freqShift, conditionISA);
+    }
+
+    firTaps_t txInterpTaps = {.taps = NULL, .numTaps = 0};
+    if(txInterpolation > 1 && txPipeName != NULL){
+        if(txInterpTapsFile != NULL){
+            if(firTapsLoad(&txInterpTaps, txInterpTapsFile) != 0){
+                exit(1);
+            }
+        }else if(firTapsDesign(&txInterpTaps, txInterpolation, txInterpTapLen) != 0){
+            printf("Could not design the Tx interpolation filter\n");
+            exit(1);
+        }
+        fprintf(stderr, "Tx interpolation by %d with %zu taps using %s FIR kernels\n", txInterpolation, txInterpTaps.numTaps, firISA);
+    }else if(txInterpTapsFile != NULL || txInterpTapLen > 0){
+        fprintf(stderr, "The Tx interpolation filter is only used when txinterp is greater than 1\n");
+    }
+
+    //Set how the streaming buffers are allocated before any are created
+    streamBufferConfig_t bufferConfig = {.hugepages = hugepages, .lock = lockBuffers, .verbose = verbose};
+    streamBufferConfigure(&bufferConfig);
+
     mainOptions_t mainOptions;
     mainOptions.option = option;
     mainOptions.freq = freq;
     mainOptions.rate = rate;
-    mainOptions.rxCPU = rxCPU;
-    mainOptions.txCPU = txCPU;
-    mainOptions.uhdCPU = uhdCPU;
+    mainOptions.rxThread = rxThread;
+    mainOptions.rxWriterThread = rxWriterThread;
+    mainOptions.txThread = txThread;
+    mainOptions.txReaderThread = txReaderThread;
+    mainOptions.txAsyncThread = txAsyncThread;
+    mainOptions.uhdThread = uhdThread;
+    mainOptions.helperThread = helperThread;
     mainOptions.txGain = txGain;
     mainOptions.rxGain = rxGain;
     mainOptions.device_args = device_args;
-    mainOptions.rxChannel = rxChannel;
-    mainOptions.txChannel = txChannel;
+    memcpy(mainOptions.rxChannels, rxChannels, sizeof(rxChannels));
+    mainOptions.numRxChannels = numRxChannels;
+    memcpy(mainOptions.txChannels, txChannels, sizeof(txChannels));
+    mainOptions.numTxChannels = numTxChannels;
     mainOptions.rxPipeName = rxPipeName;
     mainOptions.txPipeName = txPipeName;
+    memcpy(mainOptions.rxPipeNames, rxPipeNames, sizeof(rxPipeNames));
+    mainOptions.numRxPipes = numRxPipes;
+    memcpy(mainOptions.txPipeNames, txPipeNames, sizeof(txPipeNames));
+    mainOptions.numTxPipes = numTxPipes;
     mainOptions.txFeedbackPipeName = txFeedbackPipeName;
+    mainOptions.txCreditWindow = txCreditWindow;
+    mainOptions.txCreditBatch = txCreditBatch;
+    mainOptions.txCreditReturn = txCreditReturn;
     mainOptions.verbose = verbose;
     mainOptions.return_code = return_code;
     mainOptions.samplesPerTransactionRx = samplesPerTransactionRx;
     mainOptions.samplesPerTransactionTx = samplesPerTransactionTx;
+    mainOptions.rxRingDepth = rxRingDepth;
+    mainOptions.txRingDepth = txRingDepth;
+    mainOptions.txPrefillBlocks = txPrefillBlocks;
+    mainOptions.pipeBatchBlocks = pipeBatchBlocks;
+    mainOptions.pipeBatchLatencyUs = pipeBatchLatencyUs;
+    mainOptions.rxZeroCopy = rxZeroCopy;
+    mainOptions.transport = transport;
     mainOptions.forceFullTxBuffer = forceFullTxBuffer;
+    mainOptions.rxFramed = rxFramed;
+    mainOptions.rxOverflowPolicy = rxOverflowPolicy;
+    mainOptions.rxMaxErrors = rxMaxErrors;
+    mainOptions.rxMaxZeroFill = rxMaxZeroFill;
+    mainOptions.rxDataAge = rxDataAge;
+    mainOptions.rxDecimation = rxDecimation;
+    mainOptions.rxDecimTaps = rxDecimTaps;
+    mainOptions.rxConditioning = rxConditioning;
+    mainOptions.rxCondition = rxCondition;
+    mainOptions.txInterpolation = txInterpolation;
+    mainOptions.txInterpTaps = txInterpTaps;
+    mainOptions.txFramed = txFramed;
+    mainOptions.txBurstAcks = txBurstAcks;
+    mainOptions.telemetrySocket = telemetrySocket;
+    mainOptions.telemetryIntervalMs = telemetryIntervalMs;
     mainOptions.txRateLimit = txRateLimit;
+    mainOptions.txRateBurst = txRateBurst;
+    mainOptions.pipeFormat = pipeFormat;
+    mainOptions.rxCpuFormat = rxCpuFormat;
+    mainOptions.txCpuFormat = txCpuFormat;
+    mainOptions.rxOtwFormat = rxOtwFormat;
+    mainOptions.txOtwFormat = txOtwFormat;
 
     pthread_t mainPThread;
     txHandlerArgs_t mainArgs;
-    pthread_attr_t mainThreadAttributes;
-    cpu_set_t mainCPUSet;
 
-    //Create and launch main thread
-    //Create Thread Parameters
-    int attrStatus = pthread_attr_init(&mainThreadAttributes);
-    if(attrStatus != 0)
-    {
-        printf("Error creating main/UHD pthread attribute");
-        exit(1);
-    }
+    //Report the placement and scheduling of the threads and warn about CPUs which are not isolated
+    const threadConfig_t* threadConfigs[] = {&uhdThread, &rxThread, &rxWriterThread, &txThread, &txReaderThread,
+                                             &txAsyncThread, &helperThread};
+    threadConfigCheck(threadConfigs, sizeof(threadConfigs)/sizeof(threadConfigs[0]));
 
-    if(uhdCPU >= 0){
-        CPU_ZERO(&mainCPUSet);
-        CPU_SET(uhdCPU, &mainCPUSet);
-        int setAfinityStatus = pthread_attr_setaffinity_np(&mainThreadAttributes, sizeof(cpu_set_t), &mainCPUSet);
-        if(setAfinityStatus != 0)
-        {
-            printf("Error creating main/UHD pthread core affinity");
-            exit(1);
-        }
-    }
+    //SIGUSR1 (print the latency histograms) is accepted by the latency reporter thread.  Block it here so that every
+    //thread inherits the mask
+    sigset_t reportSignals;
+    sigemptyset(&reportSignals);
+    sigaddset(&reportSignals, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &reportSignals, NULL);
 
-    int threadStartStatus = pthread_create(&mainPThread, &mainThreadAttributes, mainThread, &mainOptions);
+    //Create and launch main thread
+    int threadStartStatus = threadConfigCreate(&mainPThread, &uhdThread, mainThread, &mainOptions);
     if(threadStartStatus != 0)
     {
         printf("Error creating main/UHD thread");
@@ -774,19 +2016,19 @@ int main(int argc, char* argv[])
 
     //Join threads
     void *result;
-    if(txPipeName != NULL){
-        int joinStatus = pthread_join(mainPThread, &result);
-        if(joinStatus != 0)
-        {
-            printf("Could not join main/UHD thread");
-            perror(NULL);
-            exit(1);
-        }
+    int joinStatus = pthread_join(mainPThread, &result);
+    if(joinStatus != 0)
+    {
+        printf("Could not join main/UHD thread");
+        perror(NULL);
+        exit(1);
     }
 
     int* resultCast = (int*) result;
     int returnCode = *resultCast;
     free(result);
+    firTapsFree(&rxDecimTaps);
+    firTapsFree(&txInterpTaps);
 
     return returnCode;
 }
\ No newline at end of file
@@ -0,0 +1,41 @@
+//
+// Optional framing of the blocks on the pipes.  When framing is enabled, each block on the pipe starts with a fixed size
+// header which is followed by the samples of the block (in the layout selected by the pipe format, for each channel in
+// turn).  Blocks are always the full size, even if the header indicates that fewer samples are valid.
+//
+
+#ifndef UHDTOPIPES_PIPEFRAME_H
+#define UHDTOPIPES_PIPEFRAME_H
+
+#include <stdint.h>
+
+//---- Tx ----
+
+#define TX_FRAME_FLAG_HAS_TIME (0x1) //Send the first sample of the block at the given device time
+#define TX_FRAME_FLAG_START_OF_BURST (0x2) //The block is the first block of a burst
+#define TX_FRAME_FLAG_END_OF_BURST (0x4) //The block is the last block of a burst
+
+//Header at the start of each block on a framed Tx pipe
+typedef struct{
+    uint32_t flags; //TX_FRAME_FLAG_*
+    uint32_t numSamples; //Number of valid samples (per channel) at the start of the block.  Allows a burst to end part way through a block
+    int64_t fullSecs; //Device time (when TX_FRAME_FLAG_HAS_TIME is set)
+    double fracSecs;
+} txFrameHeader_t;
+
+//---- Rx ----
+
+#define RX_FRAME_FLAG_HAS_TIME (0x1) //fullSecs and fracSecs give the device time of the first sample in the block
+#define RX_FRAME_FLAG_OVERFLOW (0x2) //The USRP reported an overflow (samples were dropped) before the last sample of the block
+#define RX_FRAME_FLAG_DISCONTINUITY (0x4) //The device time jumped (samples are missing) before the last sample of the block
+
+//Header at the start of each block on a framed Rx pipe
+typedef struct{
+    uint32_t flags; //RX_FRAME_FLAG_*
+    uint32_t numSamples; //Number of samples (per channel) in the block
+    uint64_t sequence; //Incremented for each block.  Starts at 0
+    int64_t fullSecs; //Device time of the first sample in the block (when RX_FRAME_FLAG_HAS_TIME is set)
+    double fracSecs;
+} rxFrameHeader_t;
+
+#endif //UHDTOPIPES_PIPEFRAME_H
@@ -0,0 +1,158 @@
+//
+// Raw file descriptor I/O for the Rx, Tx, and Tx feedback pipes.  Several blocks are transferred with a single
+// writev/readv call to reduce the number of syscalls when the blocks are small.
+//
+
+#define _GNU_SOURCE
+#include "pipeIO.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//Advances iov past len bytes.  Returns the new start of the array
+static struct iovec* pipeIOAdvance(struct iovec* iov, int* iovcnt, size_t len){
+    while(*iovcnt > 0 && len >= iov->iov_len){
+        len -= iov->iov_len;
+        iov++;
+        (*iovcnt)--;
+    }
+    if(*iovcnt > 0){
+        iov->iov_base = ((char*) iov->iov_base) + len;
+        iov->iov_len -= len;
+    }
+    return iov;
+}
+
+int pipeIOWriteBlocks(int fd, struct iovec* iov, int numBlocks, pipeIOStats_t* stats){
+    int iovcnt = numBlocks;
+    while(iovcnt > 0){
+        ssize_t written = writev(fd, iov, iovcnt);
+        stats->syscalls++;
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return -1;
+        }
+        iov = pipeIOAdvance(iov, &iovcnt, written);
+    }
+    stats->batches++;
+    stats->blocks += numBlocks;
+    return 0;
+}
+
+int pipeIOReadBlocks(int fd, struct iovec* iov, int numBlocks, pipeIOStats_t* stats){
+    size_t blockLen = iov[0].iov_len;
+    size_t totalRead = 0;
+    int iovcnt = numBlocks;
+    while(totalRead == 0 || totalRead % blockLen != 0){
+        ssize_t bytesRead = readv(fd, iov, iovcnt);
+        stats->syscalls++;
+        if(bytesRead < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return -1;
+        }else if(bytesRead == 0){
+            //EOF.  The complete blocks read before it are still returned (the next call returns 0), only a trailing
+            //partial block is discarded
+            if(totalRead < blockLen){
+                return 0;
+            }
+            break;
+        }
+        totalRead += bytesRead;
+        iov = pipeIOAdvance(iov, &iovcnt, bytesRead);
+    }
+    int blocksRead = totalRead / blockLen;
+    stats->batches++;
+    stats->blocks += blocksRead;
+    return blocksRead;
+}
+
+int pipeIOReadBlocksExact(int fd, struct iovec* iov, int numBlocks, pipeIOStats_t* stats){
+    int iovcnt = numBlocks;
+    while(iovcnt > 0){
+        ssize_t bytesRead = readv(fd, iov, iovcnt);
+        stats->syscalls++;
+        if(bytesRead < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return -1;
+        }else if(bytesRead == 0){
+            return 0; //EOF
+        }
+        iov = pipeIOAdvance(iov, &iovcnt, bytesRead);
+    }
+    stats->batches++;
+    stats->blocks += numBlocks;
+    return numBlocks;
+}
+
+int pipeIOSpliceBlocks(int fd, struct iovec* iov, int numBlocks, pipeIOStats_t* stats){
+    int iovcnt = numBlocks;
+    while(iovcnt > 0){
+        ssize_t spliced = vmsplice(fd, iov, iovcnt, SPLICE_F_GIFT);
+        stats->syscalls++;
+        if(spliced < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return -1;
+        }
+        iov = pipeIOAdvance(iov, &iovcnt, spliced);
+    }
+    stats->batches++;
+    stats->blocks += numBlocks;
+    return 0;
+}
+
+int pipeIOUnread(int fd){
+    int unread = 0;
+    if(ioctl(fd, FIONREAD, &unread) != 0){
+        return -1;
+    }
+    return unread;
+}
+
+int pipeIOSetPipeSize(int fd, size_t size){
+    return fcntl(fd, F_SETPIPE_SZ, (int) size);
+}
+
+bool pipeIOIsPipe(int fd){
+    struct stat fdStat;
+    if(fstat(fd, &fdStat) != 0){
+        return false;
+    }
+    return S_ISFIFO(fdStat.st_mode);
+}
+
+int pipeIOWriteAll(int fd, const void* buf, size_t len, pipeIOStats_t* stats){
+    struct iovec iov = {.iov_base = (void*) buf, .iov_len = len};
+    return pipeIOWriteBlocks(fd, &iov, 1, stats);
+}
+
+void pipeIOStatsInit(pipeIOStats_t* stats){
+    stats->batches = 0;
+    stats->blocks = 0;
+    stats->syscalls = 0;
+    clock_gettime(CLOCK_MONOTONIC, &stats->lastReport);
+}
+
+void pipeIOStatsReport(pipeIOStats_t* stats, const char* name){
+    struct timespec currentTime;
+    clock_gettime(CLOCK_MONOTONIC, &currentTime);
+    double elapsed = (currentTime.tv_sec - stats->lastReport.tv_sec) + (currentTime.tv_nsec - stats->lastReport.tv_nsec)*1e-9;
+    if(elapsed >= 1.0){
+        fprintf(stderr, "%s: %.0f batches/s, %.0f blocks/s, %.0f syscalls/s\n", name,
+                stats->batches/elapsed, stats->blocks/elapsed, stats->syscalls/elapsed);
+        stats->batches = 0;
+        stats->blocks = 0;
+        stats->syscalls = 0;
+        stats->lastReport = currentTime;
+    }
+}
@@ -0,0 +1,59 @@
+//
+// Raw file descriptor I/O for the Rx, Tx, and Tx feedback pipes.  Several blocks are transferred with a single
+// writev/readv call to reduce the number of syscalls when the blocks are small.
+//
+
+#ifndef UHDTOPIPES_PIPEIO_H
+#define UHDTOPIPES_PIPEIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <time.h>
+
+//Counters for the periodic statistics reported in verbose mode
+typedef struct{
+    size_t batches; //Number of batches (calls to pipeIOWriteBlocks or pipeIOReadBlocks)
+    size_t blocks;
+    size_t syscalls; //Includes additional calls needed to complete partial transfers
+    struct timespec lastReport;
+} pipeIOStats_t;
+
+//Writes all numBlocks blocks (each described by an entry in iov), handling partial writes.
+//iov is modified.  Returns 0 on success or -1 on error (errno is set)
+int pipeIOWriteBlocks(int fd, struct iovec* iov, int numBlocks, pipeIOStats_t* stats);
+
+//Reads into up to numBlocks blocks (each described by an entry in iov, all of the same length).  Returns as soon as at
+//least 1 complete block has been read and no block is partially filled.  iov is modified.
+//Returns the number of complete blocks read, 0 on EOF, or -1 on error (errno is set).  If EOF is reached after 1 or
+//more complete blocks, they are returned and the trailing partial block (if any) is discarded
+int pipeIOReadBlocks(int fd, struct iovec* iov, int numBlocks, pipeIOStats_t* stats);
+
+//Reads exactly numBlocks blocks (each described by an entry in iov).  iov is modified.
+//Returns numBlocks, 0 on EOF (any partial data is discarded), or -1 on error (errno is set)
+int pipeIOReadBlocksExact(int fd, struct iovec* iov, int numBlocks, pipeIOStats_t* stats);
+
+//Gifts all numBlocks blocks (each described by an entry in iov) to a pipe with vmsplice, handling partial transfers.
+//The pages are referenced by the pipe, not copied, so the blocks must not be modified until the reader has consumed them
+//(see pipeIOUnread).  The blocks should be page aligned and a multiple of the page size.
+//iov is modified.  Returns 0 on success or -1 on error (errno is set)
+int pipeIOSpliceBlocks(int fd, struct iovec* iov, int numBlocks, pipeIOStats_t* stats);
+
+//Returns the number of bytes written to the pipe which have not yet been read or -1 on error
+int pipeIOUnread(int fd);
+
+//Requests a pipe capacity of at least size bytes.  Returns the actual capacity or -1 on error (errno is set)
+int pipeIOSetPipeSize(int fd, size_t size);
+
+//Returns true if fd refers to a pipe or FIFO
+bool pipeIOIsPipe(int fd);
+
+//Writes a single value to a pipe (used for the Tx feedback pipe).  Returns 0 on success or -1 on error
+int pipeIOWriteAll(int fd, const void* buf, size_t len, pipeIOStats_t* stats);
+
+void pipeIOStatsInit(pipeIOStats_t* stats);
+//Prints the batch, block, and syscall rates and resets the counters if at least 1 second has passed since the last report
+void pipeIOStatsReport(pipeIOStats_t* stats, const char* name);
+
+#endif //UHDTOPIPES_PIPEIO_H
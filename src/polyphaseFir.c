@@ -0,0 +1,454 @@
+//
+// Polyphase FIR resampling of the streamed samples.
+//
+// The dot product kernels follow interleave.c: the SIMD variants are compiled with per-function target attributes and
+// selected at runtime with firKernelsInit.  The filters are padded to a multiple of FIR_TAP_MULTIPLE taps so the kernels
+// never need a tail.  Each kernel keeps 2 independent accumulators per component to hide the FMA latency.
+//
+
+#include "polyphaseFir.h"
+#include "interleave.h"
+#include "streamBuffer.h"
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+firDot_t firDot = firDotScalar;
+
+//==== Taps ====
+
+int firTapsDesign(firTaps_t* taps, int factor, size_t numTaps){
+    if(factor < 1){
+        return -1;
+    }
+    if(numTaps == 0){
+        numTaps = (size_t) FIR_DEFAULT_TAPS_PER_PHASE*factor;
+    }
+    taps->taps = malloc(numTaps*sizeof(float));
+    if(taps->taps == NULL){
+        return -1;
+    }
+    taps->numTaps = numTaps;
+
+    //Cutoff in cycles per sample at the higher rate
+    double cutoff = 0.4/factor;
+    double center = (numTaps-1)/2.0;
+    double sum = 0;
+    for(size_t tap = 0; tap<numTaps; tap++){
+        double t = tap - center;
+        double sinc = t == 0 ? 2*cutoff : sin(2*M_PI*cutoff*t)/(M_PI*t);
+        double window = numTaps > 1 ? 0.42 - 0.5*cos(2*M_PI*tap/(numTaps-1)) + 0.08*cos(4*M_PI*tap/(numTaps-1)) : 1;
+        taps->taps[tap] = (float) (sinc*window);
+        sum += sinc*window;
+    }
+    for(size_t tap = 0; tap<numTaps; tap++){
+        taps->taps[tap] = (float) (taps->taps[tap]/sum);
+    }
+    return 0;
+}
+
+int firTapsLoad(firTaps_t* taps, const char* path){
+    FILE* file = fopen(path, "r");
+    if(file == NULL){
+        printf("Unable to open taps file %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    size_t capacity = 256;
+    taps->taps = malloc(capacity*sizeof(float));
+    taps->numTaps = 0;
+    if(taps->taps == NULL){
+        fclose(file);
+        return -1;
+    }
+
+    char line[1024];
+    size_t lineNum = 0;
+    while(fgets(line, sizeof(line), file) != NULL){
+        lineNum++;
+        char* comment = strchr(line, '#');
+        if(comment != NULL){
+            *comment = '\0';
+        }
+        char* pos = line;
+        while(true){
+            while(*pos != '\0' && (isspace((unsigned char) *pos) || *pos == ',')){
+                pos++;
+            }
+            if(*pos == '\0'){
+                break;
+            }
+            char* end;
+            double tap = strtod(pos, &end);
+            if(end == pos){
+                printf("Invalid tap on line %zu of %s\n", lineNum, path);
+                fclose(file);
+                firTapsFree(taps);
+                return -1;
+            }
+            pos = end;
+            if(taps->numTaps == capacity){
+                capacity *= 2;
+                float* grown = realloc(taps->taps, capacity*sizeof(float));
+                if(grown == NULL){
+                    fclose(file);
+                    firTapsFree(taps);
+                    return -1;
+                }
+                taps->taps = grown;
+            }
+            taps->taps[taps->numTaps++] = (float) tap;
+        }
+    }
+    fclose(file);
+
+    if(taps->numTaps == 0){
+        printf("No taps in %s\n", path);
+        firTapsFree(taps);
+        return -1;
+    }
+    return 0;
+}
+
+void firTapsFree(firTaps_t* taps){
+    free(taps->taps);
+    taps->taps = NULL;
+    taps->numTaps = 0;
+}
+
+//==== Dot Product Kernels ====
+
+void firDotScalar(const float* re, const float* im, const float* taps, size_t numTaps, float* outRe, float* outIm){
+    float accRe = 0;
+    float accIm = 0;
+    for(size_t tap = 0; tap<numTaps; tap++){
+        accRe += taps[tap]*re[tap];
+        accIm += taps[tap]*im[tap];
+    }
+    *outRe = accRe;
+    *outIm = accIm;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2,fma")))
+static inline float firSum256(__m256 acc){
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+void firDotAVX2(const float* re, const float* im, const float* taps, size_t numTaps, float* outRe, float* outIm){
+    __m256 accRe0 = _mm256_setzero_ps();
+    __m256 accRe1 = _mm256_setzero_ps();
+    __m256 accIm0 = _mm256_setzero_ps();
+    __m256 accIm1 = _mm256_setzero_ps();
+    for(size_t tap = 0; tap<numTaps; tap+=16){
+        __m256 taps0 = _mm256_loadu_ps(taps+tap);
+        __m256 taps1 = _mm256_loadu_ps(taps+tap+8);
+        accRe0 = _mm256_fmadd_ps(taps0, _mm256_loadu_ps(re+tap), accRe0);
+        accRe1 = _mm256_fmadd_ps(taps1, _mm256_loadu_ps(re+tap+8), accRe1);
+        accIm0 = _mm256_fmadd_ps(taps0, _mm256_loadu_ps(im+tap), accIm0);
+        accIm1 = _mm256_fmadd_ps(taps1, _mm256_loadu_ps(im+tap+8), accIm1);
+    }
+    *outRe = firSum256(_mm256_add_ps(accRe0, accRe1));
+    *outIm = firSum256(_mm256_add_ps(accIm0, accIm1));
+}
+
+__attribute__((target("avx512f")))
+void firDotAVX512(const float* re, const float* im, const float* taps, size_t numTaps, float* outRe, float* outIm){
+    __m512 accRe0 = _mm512_setzero_ps();
+    __m512 accRe1 = _mm512_setzero_ps();
+    __m512 accIm0 = _mm512_setzero_ps();
+    __m512 accIm1 = _mm512_setzero_ps();
+    size_t tap = 0;
+    for(; tap+32<=numTaps; tap+=32){
+        __m512 taps0 = _mm512_loadu_ps(taps+tap);
+        __m512 taps1 = _mm512_loadu_ps(taps+tap+16);
+        accRe0 = _mm512_fmadd_ps(taps0, _mm512_loadu_ps(re+tap), accRe0);
+        accRe1 = _mm512_fmadd_ps(taps1, _mm512_loadu_ps(re+tap+16), accRe1);
+        accIm0 = _mm512_fmadd_ps(taps0, _mm512_loadu_ps(im+tap), accIm0);
+        accIm1 = _mm512_fmadd_ps(taps1, _mm512_loadu_ps(im+tap+16), accIm1);
+    }
+    if(tap < numTaps){
+        //numTaps is a multiple of 16 so there is at most 1 more vector
+        __m512 taps0 = _mm512_loadu_ps(taps+tap);
+        accRe0 = _mm512_fmadd_ps(taps0, _mm512_loadu_ps(re+tap), accRe0);
+        accIm0 = _mm512_fmadd_ps(taps0, _mm512_loadu_ps(im+tap), accIm0);
+    }
+    *outRe = _mm512_reduce_add_ps(_mm512_add_ps(accRe0, accRe1));
+    *outIm = _mm512_reduce_add_ps(_mm512_add_ps(accIm0, accIm1));
+}
+#endif
+
+const char* firKernelsInit(void){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        firDot = firDotAVX512;
+        return "AVX-512";
+    }else if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+        firDot = firDotAVX2;
+        return "AVX2";
+    }
+#endif
+    firDot = firDotScalar;
+    return "Scalar";
+}
+
+//==== Sample Conversion ====
+
+//Splits numSamples interleaved samples into float real and imagionary arrays
+static void firLoad(sampleFormat_e format, const void* src, float* re, float* im, size_t numSamples){
+    if(format == SAMPLE_FORMAT_SC16){
+        const int16_t* srcCast = (const int16_t*) src;
+        for(size_t i = 0; i<numSamples; i++){
+            re[i] = srcCast[2*i];
+            im[i] = srcCast[2*i+1];
+        }
+    }else if(format == SAMPLE_FORMAT_SC8){
+        const int8_t* srcCast = (const int8_t*) src;
+        for(size_t i = 0; i<numSamples; i++){
+            re[i] = srcCast[2*i];
+            im[i] = srcCast[2*i+1];
+        }
+    }else{
+        deinterleave32(src, re, im, numSamples);
+    }
+}
+
+//Splits numSamples planar samples (numSamples real components followed at im by numSamples imagionary components) into
+//float real and imagionary arrays
+static void firLoadPlanar(sampleFormat_e format, const void* srcRe, const void* srcIm, float* re, float* im, size_t numSamples){
+    if(format == SAMPLE_FORMAT_SC16){
+        const int16_t* srcReCast = (const int16_t*) srcRe;
+        const int16_t* srcImCast = (const int16_t*) srcIm;
+        for(size_t i = 0; i<numSamples; i++){
+            re[i] = srcReCast[i];
+            im[i] = srcImCast[i];
+        }
+    }else if(format == SAMPLE_FORMAT_SC8){
+        const int8_t* srcReCast = (const int8_t*) srcRe;
+        const int8_t* srcImCast = (const int8_t*) srcIm;
+        for(size_t i = 0; i<numSamples; i++){
+            re[i] = srcReCast[i];
+            im[i] = srcImCast[i];
+        }
+    }else{
+        memcpy(re, srcRe, numSamples*sizeof(float));
+        memcpy(im, srcIm, numSamples*sizeof(float));
+    }
+}
+
+static inline float firClamp(float val, float min, float max){
+    return val < min ? min : (val > max ? max : val);
+}
+
+//Writes a single output sample at index ind of the interleaved dst, rounding and saturating the integer formats
+static inline void firStore(sampleFormat_e format, void* dst, size_t ind, float re, float im){
+    if(format == SAMPLE_FORMAT_SC16){
+        int16_t* dstCast = (int16_t*) dst;
+        dstCast[2*ind] = (int16_t) lrintf(firClamp(re, INT16_MIN, INT16_MAX));
+        dstCast[2*ind+1] = (int16_t) lrintf(firClamp(im, INT16_MIN, INT16_MAX));
+    }else if(format == SAMPLE_FORMAT_SC8){
+        int8_t* dstCast = (int8_t*) dst;
+        dstCast[2*ind] = (int8_t) lrintf(firClamp(re, INT8_MIN, INT8_MAX));
+        dstCast[2*ind+1] = (int8_t) lrintf(firClamp(im, INT8_MIN, INT8_MAX));
+    }else{
+        float* dstCast = (float*) dst;
+        dstCast[2*ind] = re;
+        dstCast[2*ind+1] = im;
+    }
+}
+
+//Taps per phase (or per filter for the decimator, with factor 1) once padded to a multiple of FIR_TAP_MULTIPLE
+static size_t firPaddedTaps(size_t numTaps, int factor){
+    size_t tapsPerPhase = (numTaps+factor-1)/factor;
+    return ((tapsPerPhase+FIR_TAP_MULTIPLE-1)/FIR_TAP_MULTIPLE)*FIR_TAP_MULTIPLE;
+}
+
+//==== Decimator ====
+
+int firDecimatorInit(firDecimator_t* decimator, const firTaps_t* taps, int factor, size_t numChannels,
+                     sampleFormat_e format, size_t maxSamples){
+    decimator->factor = factor;
+    decimator->numChannels = numChannels;
+    decimator->format = format;
+    decimator->maxSamples = maxSamples;
+    decimator->nextOutput = 0;
+    decimator->numTaps = firPaddedTaps(taps->numTaps, 1);
+    decimator->taps = calloc(decimator->numTaps, sizeof(float));
+    size_t historyLen = numChannels*(decimator->numTaps-1+maxSamples)*sizeof(float);
+    decimator->historyRe = streamBufferAlloc(historyLen, -1, "Rx decimator history (real)");
+    decimator->historyIm = streamBufferAlloc(historyLen, -1, "Rx decimator history (imag)");
+    if(decimator->taps == NULL || decimator->historyRe == NULL || decimator->historyIm == NULL){
+        firDecimatorFree(decimator);
+        return -1;
+    }
+
+    //The zero padding goes at the oldest end so that the newest sample is still multiplied by taps[0]
+    size_t padding = decimator->numTaps - taps->numTaps;
+    for(size_t tap = 0; tap<taps->numTaps; tap++){
+        decimator->taps[padding+tap] = taps->taps[taps->numTaps-1-tap];
+    }
+    return 0;
+}
+
+void firDecimatorFree(firDecimator_t* decimator){
+    free(decimator->taps);
+    decimator->taps = NULL;
+    streamBufferFree(decimator->historyRe);
+    decimator->historyRe = NULL;
+    streamBufferFree(decimator->historyIm);
+    decimator->historyIm = NULL;
+}
+
+size_t firDecimatorFirstOutputOffset(const firDecimator_t* decimator){
+    return decimator->nextOutput;
+}
+
+//The number of outputs whose newest sample falls within the next numSamples input samples
+static size_t firDecimatorNumOutputs(const firDecimator_t* decimator, size_t numSamples){
+    if(decimator->nextOutput >= numSamples){
+        return 0;
+    }
+    return (numSamples - decimator->nextOutput + decimator->factor - 1)/decimator->factor;
+}
+
+size_t firDecimate(firDecimator_t* decimator, void** buffs, size_t numSamples){
+    size_t historyLen = decimator->numTaps-1;
+    size_t channelStride = historyLen + decimator->maxSamples;
+    size_t numOutputs = firDecimatorNumOutputs(decimator, numSamples);
+
+    for(size_t chan = 0; chan<decimator->numChannels; chan++){
+        float* re = decimator->historyRe + chan*channelStride;
+        float* im = decimator->historyIm + chan*channelStride;
+        //The input is copied out before any output is written so the outputs can overwrite it
+        firLoad(decimator->format, buffs[chan], re+historyLen, im+historyLen, numSamples);
+
+        //The window of the output whose newest sample is input sample ind starts at re+ind
+        size_t ind = decimator->nextOutput;
+        for(size_t output = 0; output<numOutputs; output++){
+            float outRe;
+            float outIm;
+            firDot(re+ind, im+ind, decimator->taps, decimator->numTaps, &outRe, &outIm);
+            firStore(decimator->format, buffs[chan], output, outRe, outIm);
+            ind += decimator->factor;
+        }
+
+        memmove(re, re+numSamples, historyLen*sizeof(float));
+        memmove(im, im+numSamples, historyLen*sizeof(float));
+    }
+
+    decimator->nextOutput = decimator->nextOutput + numOutputs*decimator->factor - numSamples;
+    return numOutputs;
+}
+
+size_t firDecimatorSkipZeros(firDecimator_t* decimator, size_t numSamples){
+    size_t historyLen = decimator->numTaps-1;
+    size_t channelStride = historyLen + decimator->maxSamples;
+    size_t numOutputs = firDecimatorNumOutputs(decimator, numSamples);
+
+    for(size_t chan = 0; chan<decimator->numChannels; chan++){
+        float* re = decimator->historyRe + chan*channelStride;
+        float* im = decimator->historyIm + chan*channelStride;
+        size_t numKept = numSamples < historyLen ? historyLen - numSamples : 0;
+        memmove(re, re+historyLen-numKept, numKept*sizeof(float));
+        memmove(im, im+historyLen-numKept, numKept*sizeof(float));
+        memset(re+numKept, 0, (historyLen-numKept)*sizeof(float));
+        memset(im+numKept, 0, (historyLen-numKept)*sizeof(float));
+    }
+
+    decimator->nextOutput = decimator->nextOutput + numOutputs*decimator->factor - numSamples;
+    return numOutputs;
+}
+
+//==== Interpolator ====
+
+int firInterpolatorInit(firInterpolator_t* interpolator, const firTaps_t* taps, int factor, size_t numChannels,
+                        sampleFormat_e format, size_t maxSamples){
+    interpolator->factor = factor;
+    interpolator->numChannels = numChannels;
+    interpolator->format = format;
+    interpolator->maxSamples = maxSamples;
+    interpolator->numTaps = firPaddedTaps(taps->numTaps, factor);
+    interpolator->taps = calloc(factor*interpolator->numTaps, sizeof(float));
+    size_t historyLen = numChannels*(interpolator->numTaps-1+maxSamples)*sizeof(float);
+    interpolator->historyRe = streamBufferAlloc(historyLen, -1, "Tx interpolator history (real)");
+    interpolator->historyIm = streamBufferAlloc(historyLen, -1, "Tx interpolator history (imag)");
+    if(interpolator->taps == NULL || interpolator->historyRe == NULL || interpolator->historyIm == NULL){
+        firInterpolatorFree(interpolator);
+        return -1;
+    }
+
+    //Phase p holds taps p, p+factor, p+2*factor, ... which are applied to the newest, 2nd newest, 3rd newest, ... input
+    //sample.  Each phase is reversed so that its last tap is applied to the newest sample
+    for(int phase = 0; phase<factor; phase++){
+        float* phaseTaps = interpolator->taps + phase*interpolator->numTaps;
+        for(size_t age = 0; age<interpolator->numTaps; age++){
+            size_t tap = phase + age*factor;
+            if(tap < taps->numTaps){
+                phaseTaps[interpolator->numTaps-1-age] = taps->taps[tap]*factor;
+            }
+        }
+    }
+    return 0;
+}
+
+void firInterpolatorFree(firInterpolator_t* interpolator){
+    free(interpolator->taps);
+    interpolator->taps = NULL;
+    streamBufferFree(interpolator->historyRe);
+    interpolator->historyRe = NULL;
+    streamBufferFree(interpolator->historyIm);
+    interpolator->historyIm = NULL;
+}
+
+void firInterpolatorReset(firInterpolator_t* interpolator){
+    size_t historyLen = interpolator->numTaps-1;
+    size_t channelStride = historyLen + interpolator->maxSamples;
+    for(size_t chan = 0; chan<interpolator->numChannels; chan++){
+        memset(interpolator->historyRe + chan*channelStride, 0, historyLen*sizeof(float));
+        memset(interpolator->historyIm + chan*channelStride, 0, historyLen*sizeof(float));
+    }
+}
+
+void firInterpolate(firInterpolator_t* interpolator, pipeFormat_e srcFormat, const void* const* srcs,
+                    size_t srcBlockSamples, size_t numSamples, void* const* dsts){
+    size_t historyLen = interpolator->numTaps-1;
+    size_t channelStride = historyLen + interpolator->maxSamples;
+    size_t componentSize = sampleFormatComponentSize(interpolator->format);
+
+    for(size_t chan = 0; chan<interpolator->numChannels; chan++){
+        float* re = interpolator->historyRe + chan*channelStride;
+        float* im = interpolator->historyIm + chan*channelStride;
+        if(srcFormat == PIPE_FORMAT_PLANAR){
+            const char* srcRe = (const char*) srcs[chan];
+            firLoadPlanar(interpolator->format, srcRe, srcRe+srcBlockSamples*componentSize, re+historyLen, im+historyLen, numSamples);
+        }else{
+            firLoad(interpolator->format, srcs[chan], re+historyLen, im+historyLen, numSamples);
+        }
+
+        //The window ending at input sample ind starts at re+ind
+        size_t output = 0;
+        for(size_t ind = 0; ind<numSamples; ind++){
+            for(int phase = 0; phase<interpolator->factor; phase++){
+                float outRe;
+                float outIm;
+                firDot(re+ind, im+ind, interpolator->taps + phase*interpolator->numTaps, interpolator->numTaps, &outRe, &outIm);
+                firStore(interpolator->format, dsts[chan], output++, outRe, outIm);
+            }
+        }
+
+        memmove(re, re+numSamples, historyLen*sizeof(float));
+        memmove(im, im+numSamples, historyLen*sizeof(float));
+    }
+}
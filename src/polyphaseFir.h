@@ -0,0 +1,118 @@
+//
+// Polyphase FIR resampling of the streamed samples.
+//
+// The decimator sits between uhd_rx_streamer_recv and the Rx reblocking.  Only the outputs which are kept are computed
+// (each output is the dot product of the taps with the newest numTaps input samples), so the cost is numTaps/factor
+// multiply-adds per input sample.  The previous numTaps-1 input samples of each channel and the phase of the next
+// output are kept between calls so that the filter runs continuously across recv boundaries.
+//
+// The interpolator sits between the Tx ring and the Tx reblocking.  The taps are split into factor sub-filters (phases)
+// of numTaps/factor taps.  Each input sample produces factor outputs, output p being the dot product of phase p with the
+// newest input samples, so the zeros of the upsampled signal are never multiplied.  The previous input samples of each
+// channel are kept between calls so that the filter runs continuously across blocks.
+//
+// The filter runs in single precision float.  sc16 and sc8 samples are converted (without scaling) and the outputs are
+// rounded and saturated back to the same type.
+//
+
+#ifndef UHDTOPIPES_POLYPHASEFIR_H
+#define UHDTOPIPES_POLYPHASEFIR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+//Filters are padded (with zero taps) to a multiple of this many taps so that the dot product kernels have no tail
+#define FIR_TAP_MULTIPLE (16)
+//Generated filters have this many taps per unit of the resampling factor unless a length is given
+#define FIR_DEFAULT_TAPS_PER_PHASE (24)
+
+typedef struct{
+    float* taps; //taps[0] is applied to the newest sample
+    size_t numTaps;
+} firTaps_t;
+
+//Designs a lowpass filter (Blackman windowed sinc) with unity DC gain for resampling by factor.  The cutoff is 0.4 of
+//the lower rate.  numTaps of 0 selects FIR_DEFAULT_TAPS_PER_PHASE*factor taps.  Returns 0 on success or -1 on failure
+int firTapsDesign(firTaps_t* taps, int factor, size_t numTaps);
+
+//Loads taps from a text file (separated by whitespace or commas, # starts a comment which runs to the end of the line).
+//Returns 0 on success or -1 on failure (a message is printed)
+int firTapsLoad(firTaps_t* taps, const char* path);
+
+void firTapsFree(firTaps_t* taps);
+
+//Dot product of numTaps taps with numTaps real and numTaps imagionary samples.  numTaps must be a multiple of
+//FIR_TAP_MULTIPLE.  None of the pointers need to be aligned
+typedef void (*firDot_t)(const float* re, const float* im, const float* taps, size_t numTaps, float* outRe, float* outIm);
+
+//Selected by firKernelsInit based on the instruction sets supported by the CPU
+extern firDot_t firDot;
+
+//Selects the fastest kernel supported by the CPU.  Must be called before any streaming thread is started.
+//Returns the name of the selected instruction set
+const char* firKernelsInit(void);
+
+//Individual kernel variants (exposed so that they can be compared against each other)
+void firDotScalar(const float* re, const float* im, const float* taps, size_t numTaps, float* outRe, float* outIm);
+#if defined(__x86_64__) || defined(__i386__)
+void firDotAVX2(const float* re, const float* im, const float* taps, size_t numTaps, float* outRe, float* outIm);
+void firDotAVX512(const float* re, const float* im, const float* taps, size_t numTaps, float* outRe, float* outIm);
+#endif
+
+typedef struct{
+    int factor;
+    size_t numChannels;
+    sampleFormat_e format;
+    float* taps; //Reversed (applied to the oldest sample first) and padded at the oldest end
+    size_t numTaps; //Padded to a multiple of FIR_TAP_MULTIPLE
+    size_t maxSamples; //Maximum number of input samples per call
+    float* historyRe; //For each channel in turn, the previous numTaps-1 input samples followed by room for maxSamples
+    float* historyIm;
+    size_t nextOutput; //Index (in the next input) of the newest sample in the window of the next output
+} firDecimator_t;
+
+//Allocates the history (on the node of the calling thread).  Returns 0 on success or -1 on failure
+int firDecimatorInit(firDecimator_t* decimator, const firTaps_t* taps, int factor, size_t numChannels,
+                     sampleFormat_e format, size_t maxSamples);
+void firDecimatorFree(firDecimator_t* decimator);
+
+//Number of input samples from the start of the next input to the newest sample in the window of the first output.  Used
+//to find the time of the first output
+size_t firDecimatorFirstOutputOffset(const firDecimator_t* decimator);
+
+//Decimates numSamples (at most maxSamples) interleaved samples of each channel in place.  The outputs are written
+//(interleaved, in the same format) to the start of each channel's buffer.  Returns the number of outputs per channel
+size_t firDecimate(firDecimator_t* decimator, void** buffs, size_t numSamples);
+
+//Advances the filter over numSamples zero samples (a gap being zero filled) without computing the outputs, which are
+//taken to be zero.  Returns the number of outputs the gap covers
+size_t firDecimatorSkipZeros(firDecimator_t* decimator, size_t numSamples);
+
+typedef struct{
+    int factor;
+    size_t numChannels;
+    sampleFormat_e format;
+    float* taps; //factor phases of numTaps taps, each reversed, padded at the oldest end, and scaled by factor
+    size_t numTaps; //Taps per phase, padded to a multiple of FIR_TAP_MULTIPLE
+    size_t maxSamples; //Maximum number of input samples per call
+    float* historyRe; //For each channel in turn, the previous numTaps-1 input samples followed by room for maxSamples
+    float* historyIm;
+} firInterpolator_t;
+
+//Allocates the history (on the node of the calling thread).  The taps are scaled by factor so that taps with unity DC
+//gain give unity gain through the interpolator.  Returns 0 on success or -1 on failure
+int firInterpolatorInit(firInterpolator_t* interpolator, const firTaps_t* taps, int factor, size_t numChannels,
+                        sampleFormat_e format, size_t maxSamples);
+void firInterpolatorFree(firInterpolator_t* interpolator);
+
+//Clears the history (ex. at the start of a burst which is not contiguous with the previous samples)
+void firInterpolatorReset(firInterpolator_t* interpolator);
+
+//Interpolates numSamples (at most maxSamples) samples of each channel.  Each channel's source is a pipe block in
+//srcFormat (for the planar format, the imagionary components start srcBlockSamples components after the real ones).
+//numSamples*factor samples are written to each channel's dst in the interleaved format
+void firInterpolate(firInterpolator_t* interpolator, pipeFormat_e srcFormat, const void* const* srcs,
+                    size_t srcBlockSamples, size_t numSamples, void* const* dsts);
+
+#endif //UHDTOPIPES_POLYPHASEFIR_H
@@ -0,0 +1,274 @@
+//
+// Conditioning of the Rx samples fused with the deinterleave.
+//
+// The kernels follow interleave.c: the SIMD variants are compiled with per-function target attributes and selected at
+// runtime with rxConditionKernelsInit.  Each vector lane carries its own NCO phasor (the phasors of consecutive
+// samples) which is advanced by the rotation of a full vector.  The tail which does not fill a vector is finished by
+// the scalar kernel starting from the phasor of the first lane.
+//
+
+#include "rxCondition.h"
+#include <math.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+rxConditionKernel_t rxConditionKernel = rxConditionScalar;
+
+//==== Kernels ====
+
+void rxConditionScalar(const float* src, float* dstRe, float* dstIm, size_t numSamples, rxConditionChunk_t* chunk){
+    float rotRe = chunk->rotRe;
+    float rotIm = chunk->rotIm;
+    float sumRe = 0;
+    float sumIm = 0;
+    for(size_t i = 0; i<numSamples; i++){
+        float re = src[2*i];
+        float im = src[2*i+1];
+        sumRe += re;
+        sumIm += im;
+        re -= chunk->dcRe;
+        im -= chunk->dcIm;
+        dstRe[i] = re*rotRe - im*rotIm;
+        dstIm[i] = re*rotIm + im*rotRe;
+        float nextRotRe = rotRe*chunk->stepRe - rotIm*chunk->stepIm;
+        rotIm = rotRe*chunk->stepIm + rotIm*chunk->stepRe;
+        rotRe = nextRotRe;
+    }
+    chunk->sumRe = sumRe;
+    chunk->sumIm = sumIm;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+//Fills the phasors of numLanes consecutive samples and the rotation of a full vector (computed in double precision)
+static void rxConditionLanes(const rxConditionChunk_t* chunk, int numLanes, float* laneRe, float* laneIm,
+                             float* vectorStepRe, float* vectorStepIm){
+    double rotRe = chunk->rotRe;
+    double rotIm = chunk->rotIm;
+    double stepRe = 1;
+    double stepIm = 0;
+    for(int lane = 0; lane<numLanes; lane++){
+        laneRe[lane] = (float) rotRe;
+        laneIm[lane] = (float) rotIm;
+        double nextRotRe = rotRe*chunk->stepRe - rotIm*chunk->stepIm;
+        rotIm = rotRe*chunk->stepIm + rotIm*chunk->stepRe;
+        rotRe = nextRotRe;
+        double nextStepRe = stepRe*chunk->stepRe - stepIm*chunk->stepIm;
+        stepIm = stepRe*chunk->stepIm + stepIm*chunk->stepRe;
+        stepRe = nextStepRe;
+    }
+    *vectorStepRe = (float) stepRe;
+    *vectorStepIm = (float) stepIm;
+}
+
+__attribute__((target("avx2,fma")))
+static inline float rxConditionSum256(__m256 acc){
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+void rxConditionAVX2(const float* src, float* dstRe, float* dstIm, size_t numSamples, rxConditionChunk_t* chunk){
+    float laneRe[8];
+    float laneIm[8];
+    float vectorStepRe;
+    float vectorStepIm;
+    rxConditionLanes(chunk, 8, laneRe, laneIm, &vectorStepRe, &vectorStepIm);
+    __m256 rotRe = _mm256_loadu_ps(laneRe);
+    __m256 rotIm = _mm256_loadu_ps(laneIm);
+    const __m256 stepRe = _mm256_set1_ps(vectorStepRe);
+    const __m256 stepIm = _mm256_set1_ps(vectorStepIm);
+    const __m256 dcRe = _mm256_set1_ps(chunk->dcRe);
+    const __m256 dcIm = _mm256_set1_ps(chunk->dcIm);
+    __m256 sumRe = _mm256_setzero_ps();
+    __m256 sumIm = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for(; i+8<=numSamples; i+=8){
+        __m256 a = _mm256_loadu_ps(src+2*i);   //r0 i0 r1 i1 | r2 i2 r3 i3
+        __m256 b = _mm256_loadu_ps(src+2*i+8); //r4 i4 r5 i5 | r6 i6 r7 i7
+        //As in deinterleave32AVX2: shuffle within the 128 bit lanes then fix the order of the 64 bit pairs
+        __m256 re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        re = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(re), _MM_SHUFFLE(3, 1, 2, 0)));
+        im = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(im), _MM_SHUFFLE(3, 1, 2, 0)));
+        sumRe = _mm256_add_ps(sumRe, re);
+        sumIm = _mm256_add_ps(sumIm, im);
+        re = _mm256_sub_ps(re, dcRe);
+        im = _mm256_sub_ps(im, dcIm);
+        _mm256_storeu_ps(dstRe+i, _mm256_fmsub_ps(re, rotRe, _mm256_mul_ps(im, rotIm)));
+        _mm256_storeu_ps(dstIm+i, _mm256_fmadd_ps(re, rotIm, _mm256_mul_ps(im, rotRe)));
+        __m256 nextRotRe = _mm256_fmsub_ps(rotRe, stepRe, _mm256_mul_ps(rotIm, stepIm));
+        rotIm = _mm256_fmadd_ps(rotRe, stepIm, _mm256_mul_ps(rotIm, stepRe));
+        rotRe = nextRotRe;
+    }
+
+    rxConditionChunk_t tail = *chunk;
+    tail.rotRe = _mm256_cvtss_f32(rotRe);
+    tail.rotIm = _mm256_cvtss_f32(rotIm);
+    rxConditionScalar(src+2*i, dstRe+i, dstIm+i, numSamples-i, &tail);
+    chunk->sumRe = rxConditionSum256(sumRe) + tail.sumRe;
+    chunk->sumIm = rxConditionSum256(sumIm) + tail.sumIm;
+}
+
+__attribute__((target("avx512f")))
+void rxConditionAVX512(const float* src, float* dstRe, float* dstIm, size_t numSamples, rxConditionChunk_t* chunk){
+    float laneRe[16];
+    float laneIm[16];
+    float vectorStepRe;
+    float vectorStepIm;
+    rxConditionLanes(chunk, 16, laneRe, laneIm, &vectorStepRe, &vectorStepIm);
+    __m512 rotRe = _mm512_loadu_ps(laneRe);
+    __m512 rotIm = _mm512_loadu_ps(laneIm);
+    const __m512 stepRe = _mm512_set1_ps(vectorStepRe);
+    const __m512 stepIm = _mm512_set1_ps(vectorStepIm);
+    const __m512 dcRe = _mm512_set1_ps(chunk->dcRe);
+    const __m512 dcIm = _mm512_set1_ps(chunk->dcIm);
+    const __m512i reInd = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i imInd = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    __m512 sumRe = _mm512_setzero_ps();
+    __m512 sumIm = _mm512_setzero_ps();
+
+    size_t i = 0;
+    for(; i+16<=numSamples; i+=16){
+        __m512 a = _mm512_loadu_ps(src+2*i);
+        __m512 b = _mm512_loadu_ps(src+2*i+16);
+        __m512 re = _mm512_permutex2var_ps(a, reInd, b);
+        __m512 im = _mm512_permutex2var_ps(a, imInd, b);
+        sumRe = _mm512_add_ps(sumRe, re);
+        sumIm = _mm512_add_ps(sumIm, im);
+        re = _mm512_sub_ps(re, dcRe);
+        im = _mm512_sub_ps(im, dcIm);
+        _mm512_storeu_ps(dstRe+i, _mm512_fmsub_ps(re, rotRe, _mm512_mul_ps(im, rotIm)));
+        _mm512_storeu_ps(dstIm+i, _mm512_fmadd_ps(re, rotIm, _mm512_mul_ps(im, rotRe)));
+        __m512 nextRotRe = _mm512_fmsub_ps(rotRe, stepRe, _mm512_mul_ps(rotIm, stepIm));
+        rotIm = _mm512_fmadd_ps(rotRe, stepIm, _mm512_mul_ps(rotIm, stepRe));
+        rotRe = nextRotRe;
+    }
+
+    rxConditionChunk_t tail = *chunk;
+    tail.rotRe = _mm512_cvtss_f32(rotRe);
+    tail.rotIm = _mm512_cvtss_f32(rotIm);
+    rxConditionScalar(src+2*i, dstRe+i, dstIm+i, numSamples-i, &tail);
+    chunk->sumRe = _mm512_reduce_add_ps(sumRe) + tail.sumRe;
+    chunk->sumIm = _mm512_reduce_add_ps(sumIm) + tail.sumIm;
+}
+#endif
+
+const char* rxConditionKernelsInit(void){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        rxConditionKernel = rxConditionAVX512;
+        return "AVX-512";
+    }else if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+        rxConditionKernel = rxConditionAVX2;
+        return "AVX2";
+    }
+#endif
+    rxConditionKernel = rxConditionScalar;
+    return "Scalar";
+}
+
+//==== Integer Formats ====
+
+static inline float rxConditionClamp(float val, float min, float max){
+    return val < min ? min : (val > max ? max : val);
+}
+
+//The scalar kernel for sc16 and sc8, converting to float and rounding and saturating the outputs
+static void rxConditionScalarInt(sampleFormat_e format, const void* src, void* dstRe, void* dstIm, size_t numSamples,
+                                 rxConditionChunk_t* chunk){
+    float rotRe = chunk->rotRe;
+    float rotIm = chunk->rotIm;
+    float sumRe = 0;
+    float sumIm = 0;
+    float min = format == SAMPLE_FORMAT_SC16 ? INT16_MIN : INT8_MIN;
+    float max = format == SAMPLE_FORMAT_SC16 ? INT16_MAX : INT8_MAX;
+    for(size_t i = 0; i<numSamples; i++){
+        float re;
+        float im;
+        if(format == SAMPLE_FORMAT_SC16){
+            re = ((const int16_t*) src)[2*i];
+            im = ((const int16_t*) src)[2*i+1];
+        }else{
+            re = ((const int8_t*) src)[2*i];
+            im = ((const int8_t*) src)[2*i+1];
+        }
+        sumRe += re;
+        sumIm += im;
+        re -= chunk->dcRe;
+        im -= chunk->dcIm;
+        float outRe = rxConditionClamp(re*rotRe - im*rotIm, min, max);
+        float outIm = rxConditionClamp(re*rotIm + im*rotRe, min, max);
+        if(format == SAMPLE_FORMAT_SC16){
+            ((int16_t*) dstRe)[i] = (int16_t) lrintf(outRe);
+            ((int16_t*) dstIm)[i] = (int16_t) lrintf(outIm);
+        }else{
+            ((int8_t*) dstRe)[i] = (int8_t) lrintf(outRe);
+            ((int8_t*) dstIm)[i] = (int8_t) lrintf(outIm);
+        }
+        float nextRotRe = rotRe*chunk->stepRe - rotIm*chunk->stepIm;
+        rotIm = rotRe*chunk->stepIm + rotIm*chunk->stepRe;
+        rotRe = nextRotRe;
+    }
+    chunk->sumRe = sumRe;
+    chunk->sumIm = sumIm;
+}
+
+//==== Conditioning ====
+
+void rxConditionInit(rxCondition_t* condition, const rxConditionConfig_t* config, sampleFormat_e format, double rate){
+    condition->format = format;
+    condition->scale = (float) config->scale;
+    condition->dcTimeConstant = config->dcTimeConstant*rate;
+    condition->dcRe = 0;
+    condition->dcIm = 0;
+    condition->phase = 0;
+    condition->phaseStep = 2*M_PI*config->freqShift/rate;
+    condition->stepRe = (float) cos(condition->phaseStep);
+    condition->stepIm = (float) sin(condition->phaseStep);
+}
+
+void rxConditionApply(rxCondition_t* condition, const void* src, void* dstRe, void* dstIm, size_t numSamples){
+    size_t componentSize = sampleFormatComponentSize(condition->format);
+    double sumRe = 0;
+    double sumIm = 0;
+    for(size_t ind = 0; ind<numSamples; ind+=RX_CONDITION_CHUNK_SAMPLES){
+        size_t chunkSamples = numSamples-ind < RX_CONDITION_CHUNK_SAMPLES ? numSamples-ind : RX_CONDITION_CHUNK_SAMPLES;
+        rxConditionChunk_t chunk = {
+                .dcRe = (float) condition->dcRe,
+                .dcIm = (float) condition->dcIm,
+                .rotRe = (float) (condition->scale*cos(condition->phase)),
+                .rotIm = (float) (condition->scale*sin(condition->phase)),
+                .stepRe = condition->stepRe,
+                .stepIm = condition->stepIm
+        };
+        const char* chunkSrc = (const char*) src + ind*componentSize*2;
+        char* chunkDstRe = (char*) dstRe + ind*componentSize;
+        char* chunkDstIm = (char*) dstIm + ind*componentSize;
+        if(condition->format == SAMPLE_FORMAT_FC32){
+            rxConditionKernel((const float*) chunkSrc, (float*) chunkDstRe, (float*) chunkDstIm, chunkSamples, &chunk);
+        }else{
+            rxConditionScalarInt(condition->format, chunkSrc, chunkDstRe, chunkDstIm, chunkSamples, &chunk);
+        }
+        sumRe += chunk.sumRe;
+        sumIm += chunk.sumIm;
+        rxConditionSkip(condition, chunkSamples);
+    }
+
+    //The estimate moves towards the mean of this call by the weight a single pole filter would give numSamples samples
+    if(condition->dcTimeConstant > 0 && numSamples > 0){
+        double weight = -expm1(-(double) numSamples/condition->dcTimeConstant);
+        condition->dcRe += weight*(sumRe/numSamples - condition->dcRe);
+        condition->dcIm += weight*(sumIm/numSamples - condition->dcIm);
+    }
+}
+
+void rxConditionSkip(rxCondition_t* condition, size_t numSamples){
+    condition->phase = remainder(condition->phase + numSamples*condition->phaseStep, 2*M_PI);
+}
@@ -0,0 +1,81 @@
+//
+// Conditioning of the Rx samples (DC removal, scaling, and a frequency shift) fused with the deinterleave into the
+// planar pipe blocks so that the samples are only touched once.
+//
+// Each output is scale*(x - dc)*e^(j*phase).  The DC estimate is a running mean of the input with the configured time
+// constant.  It is updated once per call from the mean of the samples in the call (so it lags by up to 1 recv) which
+// keeps the per-sample work free of a serial dependency.  The NCO phase is kept in double precision between calls so
+// that the rotation is continuous across recvs and blocks.  Within a call, the phasors are advanced by complex
+// multiplication and are re-seeded from the phase every RX_CONDITION_CHUNK_SAMPLES samples to bound the drift.
+//
+
+#ifndef UHDTOPIPES_RXCONDITION_H
+#define UHDTOPIPES_RXCONDITION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "common.h"
+
+//Number of samples processed between re-seeding the NCO phasors
+#define RX_CONDITION_CHUNK_SAMPLES (1024)
+
+typedef struct{
+    double scale; //Applied to each sample after the DC is removed
+    double dcTimeConstant; //Time constant of the running DC estimate in seconds.  0 to disable DC removal
+    double freqShift; //Frequency shift in Hz (positive moves the spectrum up)
+} rxConditionConfig_t;
+
+//The conditioning state of 1 channel
+typedef struct{
+    sampleFormat_e format;
+    float scale;
+    double dcTimeConstant; //In samples.  0 when DC removal is disabled
+    double dcRe; //Running estimate of the DC offset of the input
+    double dcIm;
+    double phase; //NCO phase of the next sample in radians
+    double phaseStep; //Radians per sample
+    float stepRe; //e^(j*phaseStep)
+    float stepIm;
+} rxCondition_t;
+
+//Parameters of one chunk passed to the kernels
+typedef struct{
+    float dcRe; //Subtracted from each input sample
+    float dcIm;
+    float rotRe; //scale*e^(j*phase) for the first sample
+    float rotIm;
+    float stepRe; //Rotation between consecutive samples
+    float stepIm;
+    float sumRe; //Set by the kernel to the sum of the input samples (used to update the DC estimate)
+    float sumIm;
+} rxConditionChunk_t;
+
+//Conditions numSamples interleaved fc32 samples into separate real and imagionary arrays.  None of the pointers need
+//to be aligned
+typedef void (*rxConditionKernel_t)(const float* src, float* dstRe, float* dstIm, size_t numSamples, rxConditionChunk_t* chunk);
+
+//Selected by rxConditionKernelsInit based on the instruction sets supported by the CPU
+extern rxConditionKernel_t rxConditionKernel;
+
+//Selects the fastest kernel supported by the CPU.  Must be called before any streaming thread is started.
+//Returns the name of the selected instruction set
+const char* rxConditionKernelsInit(void);
+
+//Individual kernel variants (exposed so that they can be compared against each other)
+void rxConditionScalar(const float* src, float* dstRe, float* dstIm, size_t numSamples, rxConditionChunk_t* chunk);
+#if defined(__x86_64__) || defined(__i386__)
+void rxConditionAVX2(const float* src, float* dstRe, float* dstIm, size_t numSamples, rxConditionChunk_t* chunk);
+void rxConditionAVX512(const float* src, float* dstRe, float* dstIm, size_t numSamples, rxConditionChunk_t* chunk);
+#endif
+
+//rate is the sample rate of the samples being conditioned (after any decimation)
+void rxConditionInit(rxCondition_t* condition, const rxConditionConfig_t* config, sampleFormat_e format, double rate);
+
+//Deinterleaves and conditions numSamples samples in the condition's format.  sc16 and sc8 outputs are rounded and
+//saturated
+void rxConditionApply(rxCondition_t* condition, const void* src, void* dstRe, void* dstIm, size_t numSamples);
+
+//Advances the NCO over numSamples samples which are not passed through the conditioning (ex. zeros filling a gap)
+void rxConditionSkip(rxCondition_t* condition, size_t numSamples);
+
+#endif //UHDTOPIPES_RXCONDITION_H
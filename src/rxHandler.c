@@ -2,16 +2,114 @@
 // Created by Christopher Yarp on 10/18/19.
 //
 
+#define _GNU_SOURCE
 #include "rxHandler.h"
 #include "common.h"
+#include "interleave.h"
+#include "pipeIO.h"
+#include "pipeFrame.h"
+#include "streamBuffer.h"
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+//Gets the next free block in the ring.  If the pipe writer has fallen behind by the full depth of the ring, this will
+//stall (and the USRP may overflow).  Returns NULL if terminated while waiting for the pipe writer
+static char* rxAcquireBlock(spscRing_t* rxRing, bool* terminateStatus, size_t* ringFullStalls, telemetryCounters_t* telemetry){
+    char* samples = spscRingTryAcquireWrite(rxRing);
+    if(samples == NULL){
+        (*ringFullStalls)++;
+        uint64_t waitStart = telemetryNowNs();
+        samples = spscRingAcquireWrite(rxRing, terminateStatus);
+        telemetryAdd(&telemetry->blockedNs, telemetryNowNs() - waitStart);
+    }
+    return samples;
+}
+
+//A device time (used for framing)
+typedef struct{
+    bool valid;
+    int64_t fullSecs;
+    double fracSecs;
+} rxTime_t;
+
+//Gets the device time of the first sample returned by the last recv
+static rxTime_t rxMetadataTime(uhd_rx_metadata_handle rx_md){
+    rxTime_t time = {.valid = false, .fullSecs = 0, .fracSecs = 0};
+    bool hasTime = false;
+    if(uhd_rx_metadata_has_time_spec(rx_md, &hasTime) == UHD_ERROR_NONE && hasTime){
+        time.valid = uhd_rx_metadata_time_spec(rx_md, &time.fullSecs, &time.fracSecs) == UHD_ERROR_NONE;
+    }
+    return time;
+}
+
+//Adds an offset (in seconds) to a device time, keeping the fractional seconds in [0, 1)
+static rxTime_t rxTimeOffset(rxTime_t time, double offsetSecs){
+    double fracSecs = time.fracSecs + offsetSecs;
+    double wholeSecs = floor(fracSecs);
+    time.fullSecs += (int64_t) wholeSecs;
+    time.fracSecs = fracSecs - wholeSecs;
+    return time;
+}
+
+//Fills in the header at the start of a framed block.  The samples follow the header in the ring block so no copy is needed
+static void rxFrameHeaderWrite(char* block, uint64_t sequence, uint32_t flags, int samplesPerTransactRx, rxTime_t time){
+    rxFrameHeader_t* header = (rxFrameHeader_t*) block;
+    header->flags = flags | (time.valid ? RX_FRAME_FLAG_HAS_TIME : 0);
+    header->numSamples = samplesPerTransactRx;
+    header->sequence = sequence;
+    header->fullSecs = time.fullSecs;
+    header->fracSecs = time.fracSecs;
+}
+
+//Deinterleaves numSamples samples of a channel into the planar block (or remainder), conditioning them if enabled
+static inline void rxDeinterleave(deinterleave_t deinterleave, rxCondition_t* condition, const char* src, char* dstRe,
+                                  char* dstIm, size_t numSamples){
+    if(condition != NULL){
+        rxConditionApply(condition, src, dstRe, dstIm, numSamples);
+    }else{
+        deinterleave(src, dstRe, dstIm, numSamples);
+    }
+}
+
+//Commits a filled block to the ring, writing its header first if framed.  The pending flags are reported in the block
+//If latency is measured, the time the recv which completed the block returned is recorded for the pipe writer
+static void rxCommitBlock(spscRing_t* rxRing, char* block, bool framed, uint64_t* blockSequence, uint32_t* pendingFlags,
+                          int samplesPerTransactRx, rxTime_t time, uint64_t* blockStamps, uint64_t recvDoneNs){
+    if(blockStamps != NULL){
+        blockStamps[spscRingSlot(rxRing, block)] = recvDoneNs;
+    }
+    if(framed){
+        rxFrameHeaderWrite(block, *blockSequence, *pendingFlags, samplesPerTransactRx, time);
+        *pendingFlags = 0;
+    }
+    (*blockSequence)++;
+    spscRingCommitWrite(rxRing);
+}
 
 void* rxHandler(void* argsUncast) {
     rxHandlerArgs_t* args = (rxHandlerArgs_t*) argsUncast;
     bool* terminateStatus = args->terminateStatus;
-    char* rxPipeName = args->rxPipeName;
+    spscRing_t* rxRing = args->rxRing;
     uhd_rx_streamer_handle rx_streamer = args->rx_streamer;
     uhd_rx_metadata_handle rx_md = args->rx_md;
     int samplesPerTransactRx = args->samplesPerTransactRx;
+    size_t numChannels = args->numChannels;
+    pipeFormat_e pipeFormat = args->pipeFormat;
+    sampleFormat_e cpuFormat = args->cpuFormat;
+    bool framed = args->framed;
+    double rate = args->rate;
+    rxOverflowPolicy_e overflowPolicy = args->overflowPolicy;
+    int maxErrors = args->maxErrors;
+    uint64_t* blockStamps = args->blockStamps;
+    latencyHist_t* dataAge = args->dataAge;
+    int decimation = args->decimation;
+    const firTaps_t* decimTaps = args->decimTaps;
+    const rxConditionConfig_t* conditionConfig = args->condition;
+    telemetryCounters_t* telemetry = args->telemetry;
     bool sendStopCmd = args->sendStopCmd;
     bool verbose = args->verbose;
     bool* wasRunning = args->wasRunning;
@@ -19,26 +117,92 @@ void* rxHandler(void* argsUncast) {
     *wasRunning = false;
 
     size_t samps_per_buff;
-    float *buff = NULL;
+    char *buff = NULL;
     void **buffs_ptr = NULL;
 
+    //The reblocking is independent of the sample type, only the size of each component matters
+    size_t componentSize = sampleFormatComponentSize(cpuFormat);
+    size_t sampleSize = componentSize*2; //Each sample consists of a real and an imagionary component
+    deinterleave_t deinterleave = deinterleaveKernel(componentSize);
+    size_t channelBlockSize = samplesPerTransactRx*sampleSize; //Size of each channel's block within a ring block
+
     uhd_error status = uhd_rx_streamer_max_num_samps(rx_streamer, &samps_per_buff);
     if(status){
         printf("Could not retrieve max number of samples ... exiting\n");
+        *terminateStatus = true;
+        spscRingProducerDone(rxRing); //Allow the pipe writer to exit
         return NULL;
     }
 
     fprintf(stderr, "Buffer size in samples (Rx): %zu\n", samps_per_buff);
-    buff = malloc(samps_per_buff * 2 * sizeof(float)); //Note, each sample consists of 2
-    buffs_ptr = (void **) &buff;
-
-    float* remainingSamplesRe = malloc(samplesPerTransactRx * sizeof(float));
-    float* remainingSamplesIm = malloc(samplesPerTransactRx * sizeof(float));
-    float* samples = malloc(samplesPerTransactRx * 2 *sizeof(float));
-    float* samplesRe = samples;
-    float* samplesIm = samplesRe+samplesPerTransactRx;
+
+    //With decimation, every format is received into buff and decimated in place.  The blocks are filled at outputRate
+    bool decimating = decimation > 1;
+    double outputRate = decimating ? rate/decimation : rate;
+
+    //The planar format is deinterleaved from buff into the ring.  The interleaved format is received directly into the
+    //ring so buff and the remainder arrays are not needed (except for buff when zero filling gaps or decimating).
+    //buff and the remainder arrays hold the samples of each channel in turn.  They are allocated by this thread so that
+    //they are placed on the node of the Rx CPU
+    char* remainingSamplesRe = NULL;
+    char* remainingSamplesIm = NULL;
+    if(pipeFormat == PIPE_FORMAT_PLANAR || overflowPolicy == RX_OVERFLOW_POLICY_ZEROFILL || decimating) {
+        buff = streamBufferAlloc(numChannels * samps_per_buff * sampleSize, -1, "Rx recv buffer");
+    }
+    if(pipeFormat == PIPE_FORMAT_PLANAR) {
+        remainingSamplesRe = streamBufferAlloc(numChannels * samplesPerTransactRx * componentSize, -1, "Rx remainder (real)");
+        remainingSamplesIm = streamBufferAlloc(numChannels * samplesPerTransactRx * componentSize, -1, "Rx remainder (imag)");
+    }
+    buffs_ptr = malloc(numChannels * sizeof(void*)); //The recv destination for each channel
+    firDecimator_t decimator = {.taps = NULL, .historyRe = NULL, .historyIm = NULL};
+    if(decimating && firDecimatorInit(&decimator, decimTaps, decimation, numChannels, cpuFormat, samps_per_buff) != 0){
+        printf("Could not create the Rx decimator ... exiting\n");
+        *terminateStatus = true;
+        spscRingProducerDone(rxRing); //Allow the pipe writer to exit
+        streamBufferFree(buff);
+        free(buffs_ptr);
+        streamBufferFree(remainingSamplesRe);
+        streamBufferFree(remainingSamplesIm);
+        return NULL;
+    }
     int numRemainingSamples = 0;
 
+    //One conditioning state per channel.  Only the planar format is conditioned (it is the only format deinterleaved)
+    rxCondition_t* conditions = NULL;
+    if(conditionConfig != NULL && pipeFormat == PIPE_FORMAT_PLANAR){
+        conditions = malloc(numChannels*sizeof(rxCondition_t));
+        for(size_t chan = 0; chan<numChannels; chan++){
+            rxConditionInit(&conditions[chan], conditionConfig, cpuFormat, outputRate);
+        }
+    }
+
+    //Used by the interleaved format, the block currently being filled and the number of samples already in it
+    char* currentBlock = NULL;
+    size_t currentBlockFill = 0;
+    size_t ringFullStalls = 0;
+    size_t maxRingOccupancy = 0;
+
+    //Used by framing.  The samples of each block start after the header
+    size_t frameHeaderSize = framed ? sizeof(rxFrameHeader_t) : 0;
+    uint64_t blockSequence = 0;
+    uint32_t pendingFlags = 0; //Flags (overflow, discontinuity) to report in the next block committed
+    rxTime_t expectedTime = {.valid = false}; //The device time the next recv should start at if no samples are dropped
+    rxTime_t currentBlockTime = {.valid = false}; //Device time of the first sample in the interleaved block being filled
+    rxTime_t remainderTime = {.valid = false}; //Device time of the first planar remaining sample
+
+    //Used to survive overflows.  The device time is tracked to find the number of samples lost in each gap
+    bool trackTime = framed || overflowPolicy != RX_OVERFLOW_POLICY_ABORT || dataAge != NULL;
+    size_t maxZeroFillSamples = (size_t) (args->maxZeroFillSecs*rate); //Longer gaps are marked rather than filled
+    size_t overflows = 0;
+    size_t timeouts = 0;
+    size_t gaps = 0;
+    uint64_t samplesLost = 0;
+    uint64_t samplesZeroFilled = 0;
+    size_t gapsOverZeroFillLimit = 0;
+
+    //Used to measure the data age.  The host and device clocks are not synchronized so the age is relative to the smallest seen
+    int64_t minDataAgeNs = INT64_MAX;
+
     uhd_stream_cmd_t rx_stream_start_cmd;
     rx_stream_start_cmd.stream_mode = UHD_STREAM_MODE_START_CONTINUOUS;
     rx_stream_start_cmd.num_samps = samps_per_buff; //Request the max number of samples per transaction
@@ -49,22 +213,17 @@ void* rxHandler(void* argsUncast) {
     rx_stream_stop_cmd.num_samps = samps_per_buff;
     rx_stream_stop_cmd.stream_now = true;
 
-    // Issue stream command
-    fprintf(stderr, "Issuing Rx stream command.\n");
-    status = uhd_rx_streamer_issue_stream_cmd(rx_streamer, &rx_stream_start_cmd);
-    *wasRunning = true;
-    if(!status) {
-        // Set up file output
-        FILE *rxPipe = fopen(rxPipeName, "wb");
-        if(rxPipe == NULL){
-            printf("Unable to Open Rx Pipe: %s\n", rxPipeName);
-            perror(NULL);
-            exit(1);
-        }
-        printf("Opened Rx Pipe: %s\n", rxPipeName);
-
-        printf("Samples Per Rx on Pipe: %d\n", samplesPerTransactRx);
+    //With the shm transport, the stream is started once the consumer has opened the ring (like opening a FIFO) so that
+    //the first blocks it reads are not stale
+    bool peerAttached = spscRingWaitForPeer(rxRing, terminateStatus);
 
+    // Issue stream command
+    if(peerAttached){
+        fprintf(stderr, "Issuing Rx stream command.\n");
+        status = uhd_rx_streamer_issue_stream_cmd(rx_streamer, &rx_stream_start_cmd);
+        *wasRunning = true;
+    }
+    if(peerAttached && !status) {
         // Actual streaming
         bool running = true;
         int terminateCheckCounter = 0;
@@ -80,8 +239,36 @@ void* rxHandler(void* argsUncast) {
                 terminateCheckCounter++;
             }
 
+            size_t samps_to_recv = samps_per_buff;
+            for(size_t chan = 0; chan<numChannels; chan++){
+                buffs_ptr[chan] = buff + chan*samps_per_buff*sampleSize;
+            }
+            if(pipeFormat == PIPE_FORMAT_INTERLEAVED && !decimating){
+                //Receive directly into the block at the current fill offset
+                if(currentBlock == NULL){
+                    currentBlock = rxAcquireBlock(rxRing, terminateStatus, &ringFullStalls, telemetry);
+                    if(currentBlock == NULL){
+                        running = false; //Terminated while waiting for the pipe writer
+                        break;
+                    }
+                    currentBlockFill = 0;
+                }
+                for(size_t chan = 0; chan<numChannels; chan++){
+                    buffs_ptr[chan] = currentBlock + frameHeaderSize + chan*channelBlockSize + currentBlockFill*sampleSize;
+                }
+                size_t samplesLeftInBlock = samplesPerTransactRx - currentBlockFill;
+                if(samplesLeftInBlock < samps_to_recv){
+                    samps_to_recv = samplesLeftInBlock;
+                }
+            }
             size_t num_rx_samps = 0;
-            status = uhd_rx_streamer_recv(rx_streamer, buffs_ptr, samps_per_buff, &rx_md, 3.0, false, &num_rx_samps);
+            uint64_t callStart = telemetryNowNs();
+            status = uhd_rx_streamer_recv(rx_streamer, buffs_ptr, samps_to_recv, &rx_md, 3.0, false, &num_rx_samps);
+            uint64_t recvDoneNs = telemetryNowNs();
+            telemetryAdd(&telemetry->callNs, recvDoneNs - callStart);
+            telemetryAdd(&telemetry->calls, 1);
+            telemetryAdd(&telemetry->samples, num_rx_samps);
+            telemetryAdd(&telemetry->bytes, num_rx_samps*sampleSize*numChannels);
             if(status){
                 running = false; //not actually needed
                 *terminateStatus = true;
@@ -97,50 +284,260 @@ void* rxHandler(void* argsUncast) {
                 printf("Error receiving Rx metadata from USRP ... exiting\n");
                 break;
             }
-            if (error_code != UHD_RX_METADATA_ERROR_CODE_NONE) {
+            if (error_code == UHD_RX_METADATA_ERROR_CODE_OVERFLOW && overflowPolicy != RX_OVERFLOW_POLICY_ABORT) {
+                //Keep streaming.  The number of samples lost is found from the device time of the next packet
+                overflows++;
+                telemetryAdd(&telemetry->errors, 1);
+                pendingFlags |= RX_FRAME_FLAG_OVERFLOW;
+            } else if (error_code == UHD_RX_METADATA_ERROR_CODE_TIMEOUT && overflowPolicy != RX_OVERFLOW_POLICY_ABORT) {
+                //No samples arrived before the timeout, try again
+                timeouts++;
+                telemetryAdd(&telemetry->errors, 1);
+            } else if (error_code != UHD_RX_METADATA_ERROR_CODE_NONE) {
                 running = false; //not actually needed
                 *terminateStatus = true;
                 fprintf(stderr, "Error code 0x%x was returned during streaming. Aborting.", error_code);
                 break;
             }
+            if (maxErrors > 0 && overflows+timeouts > (size_t) maxErrors) {
+                running = false; //not actually needed
+                *terminateStatus = true;
+                fprintf(stderr, "More than %d Rx overflows/timeouts. Aborting.\n", maxErrors);
+                break;
+            }
+
+            rxTime_t recvTime = {.valid = false};
+            size_t gapSamples = 0; //Number of zeros to insert before the samples just received
+            rxTime_t gapTime = {.valid = false}; //Device time of the first lost sample
+            if(trackTime && num_rx_samps > 0){
+                recvTime = rxMetadataTime(rx_md);
+                if(recvTime.valid){
+                    if(expectedTime.valid){
+                        double timeError = (double) (recvTime.fullSecs - expectedTime.fullSecs) + (recvTime.fracSecs - expectedTime.fracSecs);
+                        if(fabs(timeError) > 0.5/rate){
+                            gaps++;
+                            if(timeError > 0){
+                                size_t lost = (size_t) llround(timeError*rate);
+                                samplesLost += lost;
+                                if(overflowPolicy == RX_OVERFLOW_POLICY_ZEROFILL){
+                                    if(lost <= maxZeroFillSamples){
+                                        gapSamples = lost;
+                                        gapTime = expectedTime;
+                                        samplesZeroFilled += lost;
+                                    }else{
+                                        gapsOverZeroFillLimit++;
+                                    }
+                                }
+                            }
+                            if(gapSamples == 0){
+                                //The samples either side of the gap are not contiguous in the output
+                                pendingFlags |= RX_FRAME_FLAG_DISCONTINUITY;
+                                if(!framed && overflowPolicy == RX_OVERFLOW_POLICY_ZEROFILL){
+                                    //Nothing in the output would show the gap
+                                    running = false; //not actually needed
+                                    *terminateStatus = true;
+                                    fprintf(stderr, "Rx gap of %.6f s could not be zero filled (over rxmaxzerofill or the device time went backwards). Aborting.\n", timeError);
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                    expectedTime = rxTimeOffset(recvTime, num_rx_samps/rate);
+
+                    if(dataAge != NULL){
+                        struct timespec hostTime;
+                        clock_gettime(CLOCK_REALTIME, &hostTime);
+                        int64_t ageNs = (int64_t) (hostTime.tv_sec - expectedTime.fullSecs)*1000000000 + hostTime.tv_nsec - (int64_t) (expectedTime.fracSecs*1e9);
+                        if(ageNs < minDataAgeNs){
+                            minDataAgeNs = ageNs;
+                        }
+                        latencyHistRecord(dataAge, (uint64_t) (ageNs - minDataAgeNs));
+                    }
+                }
+            }
+
+            if(decimating){
+                //The zeros filling a gap go through the filter ahead of the samples just received.  The outputs while the
+                //filter runs over the gap are taken to be zero.  The time of each output is the time of the newest input
+                //sample in its window (the group delay of the filter is not removed)
+                if(gapSamples > 0){
+                    gapTime = rxTimeOffset(gapTime, firDecimatorFirstOutputOffset(&decimator)/rate);
+                    gapSamples = firDecimatorSkipZeros(&decimator, gapSamples);
+                }
+                recvTime = rxTimeOffset(recvTime, firDecimatorFirstOutputOffset(&decimator)/rate);
+                num_rx_samps = firDecimate(&decimator, buffs_ptr, num_rx_samps);
+            }
+
+            // Handle data (each sample comes in a pair of 2 components, 1 for the real component and 1 for the imag component)
+            //  The underlying C++ type is std::complex<float>, std::complex<int16_t>, or std::complex<int8_t>
 
-            // Handle data (each sample comes in a pair of 2 floats, 1 for the real component and 1 for the imag component)
-            //  The underlying C++ type is std::complex<float>
+            int numBlocks = 0;
+            int numFillBlocks = 0; //Blocks completed while zero filling a gap
+            if(pipeFormat == PIPE_FORMAT_INTERLEAVED && (gapSamples > 0 || decimating)){
+                if(!decimating){
+                    //The received samples are already in the block.  Move them aside so that the zeros come first
+                    for(size_t chan = 0; chan<numChannels; chan++){
+                        memcpy(buff + chan*samps_per_buff*sampleSize, currentBlock + frameHeaderSize + chan*channelBlockSize + currentBlockFill*sampleSize, num_rx_samps*sampleSize);
+                    }
+                }
+                //The first pass appends the zeros, the second appends the received samples
+                for(int pass = 0; pass<2 && running; pass++){
+                    size_t toAppend = pass == 0 ? gapSamples : num_rx_samps;
+                    rxTime_t appendTime = pass == 0 ? gapTime : recvTime;
+                    size_t appendInd = 0;
+                    while(appendInd < toAppend){
+                        if(currentBlock == NULL){
+                            currentBlock = rxAcquireBlock(rxRing, terminateStatus, &ringFullStalls, telemetry);
+                            if(currentBlock == NULL){
+                                running = false; //Terminated while waiting for the pipe writer
+                                break;
+                            }
+                            currentBlockFill = 0;
+                        }
+                        if(currentBlockFill == 0){
+                            currentBlockTime = rxTimeOffset(appendTime, appendInd/outputRate);
+                        }
+                        size_t numToAppend = samplesPerTransactRx - currentBlockFill;
+                        if(toAppend - appendInd < numToAppend){
+                            numToAppend = toAppend - appendInd;
+                        }
+                        for(size_t chan = 0; chan<numChannels; chan++){
+                            char* dst = currentBlock + frameHeaderSize + chan*channelBlockSize + currentBlockFill*sampleSize;
+                            if(pass == 0){
+                                memset(dst, 0, numToAppend*sampleSize);
+                            }else{
+                                memcpy(dst, buff + chan*samps_per_buff*sampleSize + appendInd*sampleSize, numToAppend*sampleSize);
+                            }
+                        }
+                        currentBlockFill += numToAppend;
+                        appendInd += numToAppend;
+                        if(currentBlockFill == (size_t) samplesPerTransactRx){
+                            rxCommitBlock(rxRing, currentBlock, framed, &blockSequence, &pendingFlags, samplesPerTransactRx, currentBlockTime, blockStamps, recvDoneNs);
+                            currentBlock = NULL;
+                            numBlocks++;
+                        }
+                    }
+                }
+                if(!running){
+                    break;
+                }
+            }else if(pipeFormat == PIPE_FORMAT_INTERLEAVED){
+                //The samples are already in place
+                if(currentBlockFill == 0){
+                    currentBlockTime = recvTime;
+                }
+                currentBlockFill += num_rx_samps;
+                if(currentBlockFill == (size_t) samplesPerTransactRx){
+                    rxCommitBlock(rxRing, currentBlock, framed, &blockSequence, &pendingFlags, samplesPerTransactRx, currentBlockTime, blockStamps, recvDoneNs);
+                    currentBlock = NULL;
+                    numBlocks = 1;
+                }
+            }else{
+                //Zero fill the gap (if any) through the remainder arrays, ahead of the samples just received
+                size_t gapInd = 0;
+                while(gapInd < gapSamples){
+                    if(numRemainingSamples == 0){
+                        remainderTime = rxTimeOffset(gapTime, gapInd/outputRate);
+                    }
+                    size_t numToFill = samplesPerTransactRx - numRemainingSamples;
+                    if(gapSamples - gapInd < numToFill){
+                        numToFill = gapSamples - gapInd;
+                    }
+                    for(size_t chan = 0; chan<numChannels; chan++) {
+                        memset(remainingSamplesRe + (chan*samplesPerTransactRx + numRemainingSamples)*componentSize, 0, numToFill*componentSize);
+                        memset(remainingSamplesIm + (chan*samplesPerTransactRx + numRemainingSamples)*componentSize, 0, numToFill*componentSize);
+                    }
+                    if(conditions != NULL){
+                        //The NCO runs through the gap so that its phase stays tied to the device time
+                        for(size_t chan = 0; chan<numChannels; chan++) {
+                            rxConditionSkip(&conditions[chan], numToFill);
+                        }
+                    }
+                    numRemainingSamples += numToFill;
+                    gapInd += numToFill;
+
+                    if(numRemainingSamples == samplesPerTransactRx){
+                        char* samples = rxAcquireBlock(rxRing, terminateStatus, &ringFullStalls, telemetry);
+                        if(samples == NULL){
+                            running = false; //Terminated while waiting for the pipe writer
+                            break;
+                        }
+                        for(size_t chan = 0; chan<numChannels; chan++) {
+                            char* samplesRe = samples + frameHeaderSize + chan*channelBlockSize;
+                            memcpy(samplesRe, remainingSamplesRe + chan*samplesPerTransactRx*componentSize, samplesPerTransactRx*componentSize);
+                            memcpy(samplesRe+samplesPerTransactRx*componentSize, remainingSamplesIm + chan*samplesPerTransactRx*componentSize, samplesPerTransactRx*componentSize);
+                        }
+                        rxCommitBlock(rxRing, samples, framed, &blockSequence, &pendingFlags, samplesPerTransactRx, remainderTime, blockStamps, recvDoneNs);
+                        numRemainingSamples = 0;
+                        numFillBlocks++;
+                    }
+                }
+                if(!running){
+                    break;
+                }
+
+                numBlocks = (num_rx_samps+numRemainingSamples)/samplesPerTransactRx;
+                int numRemaining = (num_rx_samps+numRemainingSamples)%samplesPerTransactRx;
+                int srcSampleInd = 0;
+
+                for(int block = 0; block<numBlocks; block++){
+                    //Get the next free block in the ring
+                    char* samples = rxAcquireBlock(rxRing, terminateStatus, &ringFullStalls, telemetry);
+                    if(samples == NULL){
+                        running = false; //Terminated while waiting for the pipe writer
+                        break;
+                    }
+                    int destIndOffset = numRemainingSamples;
+                    numRemainingSamples = 0;
+                    int samplesToTransferFromSrcArray = samplesPerTransactRx-destIndOffset;
+
+                    rxTime_t blockTime = destIndOffset > 0 ? remainderTime : rxTimeOffset(recvTime, srcSampleInd/outputRate);
+
+                    for(size_t chan = 0; chan<numChannels; chan++) {
+                        char* samplesRe = samples + frameHeaderSize + chan*channelBlockSize;
+                        char* samplesIm = samplesRe+samplesPerTransactRx*componentSize;
+                        char* chanBuff = buff + chan*samps_per_buff*sampleSize;
 
-            int numBlocks = (num_rx_samps+numRemainingSamples)/samplesPerTransactRx;
-            int numRemaining = (num_rx_samps+numRemainingSamples)%samplesPerTransactRx;
-            int srcSampleInd = 0;
+                        //Use remaining samples (if any)
+                        if(destIndOffset>0) {
+                            memcpy(samplesRe, remainingSamplesRe + chan*samplesPerTransactRx*componentSize, destIndOffset * componentSize);
+                            memcpy(samplesIm, remainingSamplesIm + chan*samplesPerTransactRx*componentSize, destIndOffset * componentSize);
+                        }
+                        rxDeinterleave(deinterleave, conditions != NULL ? &conditions[chan] : NULL, chanBuff+srcSampleInd*sampleSize, samplesRe+destIndOffset*componentSize, samplesIm+destIndOffset*componentSize, samplesToTransferFromSrcArray);
+                    }
+                    srcSampleInd += samplesToTransferFromSrcArray;
 
-            for(int block = 0; block<numBlocks; block++){
-                //Use remaining samples (if any)
-                if(numRemainingSamples>0) {
-                    memcpy(samplesRe, remainingSamplesRe, numRemainingSamples * sizeof(float));
-                    memcpy(samplesIm, remainingSamplesIm, numRemainingSamples * sizeof(float));
+                    //samples is samplesRe::samplesIm for each channel in turn (after the header if framed)
+                    rxCommitBlock(rxRing, samples, framed, &blockSequence, &pendingFlags, samplesPerTransactRx, blockTime, blockStamps, recvDoneNs);
                 }
-                int destIndOffset = numRemainingSamples;
-                numRemainingSamples = 0;
-                int samplesToTransferFromSrcArray = samplesPerTransactRx-destIndOffset;
-                for(int i = 0; i<samplesToTransferFromSrcArray; i++){
-                    samplesRe[destIndOffset+i] = buff[srcSampleInd+2*i];
-                    samplesIm[destIndOffset+i] = buff[srcSampleInd+2*i+1];
+                if(!running){
+                    break;
                 }
-                srcSampleInd += samplesToTransferFromSrcArray*2; //*2 because each sample has 2 components
 
-                //samples is samplesRe::samplesIm
-                fwrite(samples, sizeof(float), samplesPerTransactRx*2, rxPipe);  //Note:
-            }
-            fflush(rxPipe);
-            if (verbose) {
-                fprintf(stderr, "Wrote %d blocks (%d samples) to Rx pipe)\n", numBlocks, numBlocks*samplesPerTransactRx);
+                //Copy remaining samples
+                int numToTransfer = numRemaining-numRemainingSamples;
+                if(framed && numRemainingSamples == 0 && numToTransfer > 0){
+                    remainderTime = rxTimeOffset(recvTime, srcSampleInd/outputRate);
+                }
+                for(size_t chan = 0; chan<numChannels; chan++) {
+                    char* chanBuff = buff + chan*samps_per_buff*sampleSize;
+                    char* chanRemainingRe = remainingSamplesRe + chan*samplesPerTransactRx*componentSize;
+                    char* chanRemainingIm = remainingSamplesIm + chan*samplesPerTransactRx*componentSize;
+                    rxDeinterleave(deinterleave, conditions != NULL ? &conditions[chan] : NULL, chanBuff+srcSampleInd*sampleSize, chanRemainingRe+numRemainingSamples*componentSize, chanRemainingIm+numRemainingSamples*componentSize, numToTransfer);
+                }
+                numRemainingSamples += numToTransfer; //This is += to handle the case when the number of received samples is less than the block size
+                numBlocks += numFillBlocks;
             }
 
-            //Copy remaining samples
-            int numToTransfer = numRemaining-numRemainingSamples;
-            for(int i = 0; i < numToTransfer; i++){
-                remainingSamplesRe[numRemainingSamples+i] = buff[srcSampleInd+2*i];
-                remainingSamplesIm[numRemainingSamples+i] = buff[srcSampleInd+2*i+1];
+            telemetryAdd(&telemetry->blocks, numBlocks);
+
+            size_t ringOccupancy = spscRingOccupancy(rxRing);
+            if(ringOccupancy > maxRingOccupancy){
+                maxRingOccupancy = ringOccupancy;
+            }
+            if (verbose) {
+                fprintf(stderr, "Queued %d blocks (%d samples) for Rx pipe, %zu blocks in ring)\n", numBlocks, numBlocks*samplesPerTransactRx, ringOccupancy);
             }
-            numRemainingSamples += numToTransfer; //This is += to handle the case when the number of received samples is less than the block size
 
             if (verbose) {
                 int64_t full_secs;
@@ -153,9 +550,7 @@ void* rxHandler(void* argsUncast) {
             }
 
         }
-
-        fclose(rxPipe);
-    }else{
+    }else if(peerAttached){
         printf("Could not send streaming Rx command to USRP\n");
         *terminateStatus = true;
     }
@@ -170,10 +565,252 @@ void* rxHandler(void* argsUncast) {
         *wasRunning = true;
     }
 
-    free(buff);
-    free(remainingSamplesRe);
-    free(remainingSamplesIm);
-    free(samples);
+    //Let the pipe writer drain the ring and exit
+    spscRingProducerDone(rxRing);
+
+    fprintf(stderr, "Rx ring: max occupancy %zu/%zu blocks, %zu stalls waiting for the Rx pipe writer\n",
+            maxRingOccupancy, rxRing->numBlocks, ringFullStalls);
+    if(overflowPolicy != RX_OVERFLOW_POLICY_ABORT){
+        fprintf(stderr, "Rx errors: %zu overflows, %zu timeouts, %zu gaps, %" PRIu64 " samples lost, %" PRIu64 " samples zero filled, %zu gaps over the zero fill limit\n",
+                overflows, timeouts, gaps, samplesLost, samplesZeroFilled, gapsOverZeroFillLimit);
+    }
+
+    streamBufferFree(buff);
+    free(buffs_ptr);
+    streamBufferFree(remainingSamplesRe);
+    streamBufferFree(remainingSamplesIm);
+    if(decimating){
+        firDecimatorFree(&decimator);
+    }
+    free(conditions);
 
     return NULL;
-}
\ No newline at end of file
+}
+
+//Records the time from the recv returning to now for numBlocks blocks, starting offset blocks after the oldest in the ring
+static void rxRecordLatency(spscRing_t* rxRing, size_t offset, size_t numBlocks, uint64_t* blockStamps, latencyHist_t* latency){
+    if(latency == NULL){
+        return;
+    }
+    uint64_t now = telemetryNowNs();
+    for(size_t block = 0; block<numBlocks; block++){
+        uint64_t stamp = blockStamps[spscRingSlot(rxRing, spscRingPeekRead(rxRing, offset+block))];
+        latencyHistRecord(latency, now - stamp);
+    }
+}
+
+//Releases blocks which have been gifted to the pipe (with vmsplice) once the reader has consumed them.  Since the pipe is
+//FIFO, a block has been consumed once the number of bytes read from the pipe reaches the end of the block
+static void rxReleaseConsumedBlocks(int rxPipe, spscRing_t* rxRing, size_t blockBytes, size_t bytesSubmitted,
+                                    size_t* bytesReleased, size_t* blocksInFlight){
+    int unread = pipeIOUnread(rxPipe);
+    if(unread < 0){
+        return;
+    }
+    size_t bytesConsumed = bytesSubmitted - unread;
+    size_t blocksConsumed = (bytesConsumed - *bytesReleased)/blockBytes;
+    if(blocksConsumed > 0){
+        spscRingReleaseReadN(rxRing, blocksConsumed);
+        *bytesReleased += blocksConsumed*blockBytes;
+        *blocksInFlight -= blocksConsumed;
+    }
+}
+
+//Zero copy version of the Rx pipe writer loop.  Blocks are gifted to the pipe with vmsplice and are only returned to the
+//Rx handler once the reader has consumed them.  The ring is the pool of page aligned buffers.
+//Note: readers which splice the pages out of the pipe (rather than reading them) must be done with them before the
+//ring wraps around
+static void rxPipeWriterZeroCopy(int rxPipe, spscRing_t* rxRing, size_t blockBytes, int pipeBatchBlocks,
+                                 struct iovec* iov, bool* terminateStatus, uint64_t* blockStamps, latencyHist_t* latency,
+                                 telemetryCounters_t* telemetry, bool verbose){
+    //Size the pipe so that it can hold a fraction of the ring.  The kernel rounds this up to a power of 2 pages.  If
+    //the pipe could hold the entire ring, the Rx handler would stall waiting for blocks held by the pipe
+    size_t tgtPipeSize = (rxRing->numBlocks/4)*blockBytes;
+    if(tgtPipeSize > 0) {
+        int pipeSize = pipeIOSetPipeSize(rxPipe, tgtPipeSize);
+        if (pipeSize < 0) {
+            fprintf(stderr, "Unable to set Rx pipe size to %zu bytes, continuing with the default size\n", tgtPipeSize);
+        } else {
+            fprintf(stderr, "Rx pipe size: %d bytes (%zu blocks in ring)\n", pipeSize, rxRing->numBlocks);
+        }
+    }
+
+    pipeIOStats_t stats;
+    pipeIOStatsInit(&stats);
+
+    size_t bytesSubmitted = 0;
+    size_t bytesReleased = 0;
+    size_t blocksInFlight = 0; //Blocks in the pipe which have not been released back to the ring
+    int spinCount = 0;
+
+    while(true){
+        rxReleaseConsumedBlocks(rxPipe, rxRing, blockBytes, bytesSubmitted, &bytesReleased, &blocksInFlight);
+
+        //Wait for blocks which have not yet been submitted to the pipe.  Keep releasing consumed blocks while waiting
+        //so that the Rx handler does not stall
+        size_t available = spscRingReadAvailable(rxRing) - blocksInFlight;
+        if(available == 0){
+            if(atomic_load_explicit(&rxRing->producerDone, memory_order_acquire) &&
+               spscRingReadAvailable(rxRing) == blocksInFlight){
+                break;
+            }
+            uint64_t waitStart = telemetryNowNs();
+            spscRingBackoff(&spinCount);
+            telemetryAdd(&telemetry->blockedNs, telemetryNowNs() - waitStart);
+            continue;
+        }
+        spinCount = 0;
+
+        int numBlocks = available < (size_t) pipeBatchBlocks ? (int) available : pipeBatchBlocks;
+        for(int block = 0; block<numBlocks; block++){
+            iov[block].iov_base = spscRingPeekRead(rxRing, blocksInFlight+block);
+            iov[block].iov_len = blockBytes;
+        }
+        size_t syscallsBefore = stats.syscalls;
+        uint64_t callStart = telemetryNowNs();
+        if(pipeIOSpliceBlocks(rxPipe, iov, numBlocks, &stats) != 0){
+            printf("An error was encountered while writing the Rx pipe\n");
+            perror(NULL);
+            *terminateStatus = true; //Inform other threads to stop (Rx pipe error)
+            return;
+        }
+        telemetryAdd(&telemetry->callNs, telemetryNowNs() - callStart);
+        telemetryAdd(&telemetry->syscalls, stats.syscalls - syscallsBefore);
+        telemetryAdd(&telemetry->calls, 1);
+        telemetryAdd(&telemetry->blocks, numBlocks);
+        telemetryAdd(&telemetry->bytes, numBlocks*blockBytes);
+        rxRecordLatency(rxRing, blocksInFlight, numBlocks, blockStamps, latency); //The blocks are in the pipe
+        blocksInFlight += numBlocks;
+        bytesSubmitted += numBlocks*blockBytes;
+
+        if (verbose) {
+            pipeIOStatsReport(&stats, "Rx pipe (zero copy)");
+        }
+    }
+
+    //The pipe still references the blocks in flight.  Wait for the reader to consume them before the ring is freed
+    spinCount = SPSC_RING_SPIN_ITTERATIONS; //Sleep between polls
+    while(blocksInFlight > 0 && !*terminateStatus){
+        rxReleaseConsumedBlocks(rxPipe, rxRing, blockBytes, bytesSubmitted, &bytesReleased, &blocksInFlight);
+        spscRingBackoff(&spinCount);
+    }
+}
+
+void* rxPipeWriter(void* argsUncast) {
+    rxPipeWriterArgs_t* args = (rxPipeWriterArgs_t*) argsUncast;
+    bool* terminateStatus = args->terminateStatus;
+    char** rxPipeNames = args->rxPipeNames;
+    int numRxPipes = args->numRxPipes;
+    spscRing_t* rxRing = args->rxRing;
+    int samplesPerTransactRx = args->samplesPerTransactRx;
+    size_t numChannels = args->numChannels;
+    size_t sampleSize = sampleFormatComponentSize(args->cpuFormat)*2;
+    bool framed = args->framed;
+    int pipeBatchBlocks = args->pipeBatchBlocks;
+    int pipeBatchLatencyUs = args->pipeBatchLatencyUs;
+    bool zeroCopy = args->zeroCopy;
+    uint64_t* blockStamps = args->blockStamps;
+    latencyHist_t* latency = args->latency;
+    telemetryCounters_t* telemetry = args->telemetry;
+    bool verbose = args->verbose;
+
+    //With a single pipe, the blocks of all channels are written in turn.  Otherwise, each pipe gets its channel's block
+    //Framing is only supported with a single pipe, the header is written with the block
+    size_t channelBlockSize = samplesPerTransactRx*sampleSize;
+    size_t pipeBlockSize = numRxPipes == 1 ? numChannels*channelBlockSize : channelBlockSize;
+    if(framed){
+        pipeBlockSize += sizeof(rxFrameHeader_t);
+    }
+
+    // Set up file output
+    int rxPipes[MAX_CHANNELS];
+    for(int pipeInd = 0; pipeInd<numRxPipes; pipeInd++) {
+        rxPipes[pipeInd] = open(rxPipeNames[pipeInd], O_WRONLY);
+        if (rxPipes[pipeInd] < 0) {
+            printf("Unable to Open Rx Pipe: %s\n", rxPipeNames[pipeInd]);
+            perror(NULL);
+            exit(1);
+        }
+        printf("Opened Rx Pipe: %s\n", rxPipeNames[pipeInd]);
+    }
+
+    printf("Samples Per Rx on Pipe: %d\n", samplesPerTransactRx);
+
+    if(pipeBatchBlocks > IOV_MAX){
+        pipeBatchBlocks = IOV_MAX;
+    }
+    struct iovec* iov = malloc(pipeBatchBlocks*sizeof(struct iovec));
+
+    if(zeroCopy){
+        if(numRxPipes == 1 && pipeIOIsPipe(rxPipes[0])) {
+            rxPipeWriterZeroCopy(rxPipes[0], rxRing, pipeBlockSize, pipeBatchBlocks, iov, terminateStatus, blockStamps, latency, telemetry, verbose);
+            close(rxPipes[0]);
+            free(iov);
+            return NULL;
+        }
+        fprintf(stderr, "Rx output is not a single pipe, zero copy output disabled\n");
+    }
+
+    pipeIOStats_t stats;
+    pipeIOStatsInit(&stats);
+
+    while(true){
+        //Returns NULL once the Rx handler has stopped and the ring has been drained
+        uint64_t waitStart = telemetryNowNs();
+        if(spscRingAcquireRead(rxRing, NULL) == NULL){
+            break;
+        }
+
+        //If a full batch is not available, wait (up to the latency bound) for more blocks
+        size_t available = spscRingReadAvailable(rxRing);
+        if(available < (size_t) pipeBatchBlocks && pipeBatchLatencyUs > 0){
+            struct timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_nsec += (long) pipeBatchLatencyUs*1000;
+            deadline.tv_sec += deadline.tv_nsec/1000000000;
+            deadline.tv_nsec %= 1000000000;
+            available = spscRingWaitForOccupancyUntil(rxRing, pipeBatchBlocks, &deadline);
+        }
+        int numBlocks = available < (size_t) pipeBatchBlocks ? (int) available : pipeBatchBlocks;
+        uint64_t callStart = telemetryNowNs();
+        telemetryAdd(&telemetry->blockedNs, callStart - waitStart);
+        size_t syscallsBefore = stats.syscalls;
+
+        //Each block is samplesRe::samplesIm (planar) or complex samples (interleaved).  Either way, the block is written as is
+        int writeStatus = 0;
+        for(int pipeInd = 0; pipeInd<numRxPipes && writeStatus == 0; pipeInd++) {
+            for (int block = 0; block < numBlocks; block++) {
+                iov[block].iov_base = ((char*) spscRingPeekRead(rxRing, block)) + pipeInd*channelBlockSize;
+                iov[block].iov_len = pipeBlockSize;
+            }
+            writeStatus = pipeIOWriteBlocks(rxPipes[pipeInd], iov, numBlocks, &stats);
+        }
+        if(writeStatus == 0){
+            rxRecordLatency(rxRing, 0, numBlocks, blockStamps, latency);
+        }
+        spscRingReleaseReadN(rxRing, numBlocks);
+        telemetryAdd(&telemetry->callNs, telemetryNowNs() - callStart);
+        telemetryAdd(&telemetry->syscalls, stats.syscalls - syscallsBefore);
+        telemetryAdd(&telemetry->calls, 1);
+        telemetryAdd(&telemetry->blocks, numBlocks);
+        telemetryAdd(&telemetry->bytes, numBlocks*pipeBlockSize*numRxPipes);
+        if(writeStatus != 0){
+            printf("An error was encountered while writing the Rx pipe\n");
+            perror(NULL);
+            *terminateStatus = true; //Inform other threads to stop (Rx pipe error)
+            break;
+        }
+
+        if (verbose) {
+            pipeIOStatsReport(&stats, "Rx pipe");
+        }
+    }
+
+    for(int pipeInd = 0; pipeInd<numRxPipes; pipeInd++) {
+        close(rxPipes[pipeInd]);
+    }
+    free(iov);
+
+    return NULL;
+}
+
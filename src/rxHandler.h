@@ -9,20 +9,79 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "spscRing.h"
+#include "telemetry.h"
+#include "latencyHist.h"
+#include "polyphaseFir.h"
+#include "rxCondition.h"
+#include "common.h"
+
+//What the Rx handler does when the USRP reports an overflow (or a recv times out)
+typedef enum{
+    RX_OVERFLOW_POLICY_ABORT, //Stop streaming (and the Tx side)
+    RX_OVERFLOW_POLICY_MARK, //Keep streaming.  The gap is flagged in the frame header (requires framing)
+    RX_OVERFLOW_POLICY_ZEROFILL //Keep streaming.  The lost samples (found from the device time) are replaced with zeros.
+                                //A gap which cannot be filled is flagged when framed and stops Rx otherwise
+} rxOverflowPolicy_e;
 
 typedef struct{
     bool* terminateStatus; //Used to periodically check if thread should terminate
-    char* rxPipeName;
+    spscRing_t* rxRing; //Blocks are passed to the Rx pipe writer thread through this ring
     uhd_rx_streamer_handle rx_streamer; //This is a pointer
     uhd_rx_metadata_handle rx_md; //This is a pointer
     bool sendStopCmd;
     int samplesPerTransactRx;
+    size_t numChannels; //Each block in the ring holds a block of samplesPerTransactRx samples for each channel in turn
+    pipeFormat_e pipeFormat;
+    sampleFormat_e cpuFormat; //The type of each component in the blocks
+    bool framed; //Each block starts with a rxFrameHeader_t giving the device time, sequence number, and flags for the block
+    double rate; //Samples per second, used to find the device time of the first sample in each block and the samples lost
+    rxOverflowPolicy_e overflowPolicy;
+    int maxErrors; //Rx is stopped after this many overflows and timeouts.  0 for no limit
+    double maxZeroFillSecs; //Longest gap filled with zeros by RX_OVERFLOW_POLICY_ZEROFILL.  Longer gaps are flagged when framed and stop Rx otherwise
+    uint64_t* blockStamps; //Time (telemetryNowNs) the recv which completed each block returned, indexed by ring slot.  NULL if latency is not measured
+    latencyHist_t* dataAge; //Host time minus device time of the last sample of each recv, less the smallest seen.  NULL if not measured
+    int decimation; //The received samples are filtered with decimTaps and 1 in decimation is kept.  0 or 1 for no decimation
+    const firTaps_t* decimTaps;
+    const rxConditionConfig_t* condition; //DC removal, scaling, and frequency shift applied as the samples are deinterleaved (planar only).  NULL for none
+    telemetryCounters_t* telemetry;
     bool verbose;
 
     bool* wasRunning; //Used for feedback when exiting.  Tells if it was running
 } rxHandlerArgs_t;
 
-//The output format is a block of real samples concatinated with a block of imagionary samples
+typedef struct{
+    bool* terminateStatus; //Used to periodically check if thread should terminate
+    char** rxPipeNames; //Either 1 pipe (carrying the blocks of all channels in turn) or 1 pipe per channel
+    int numRxPipes;
+    spscRing_t* rxRing; //Blocks are received from the Rx handler thread through this ring
+    int samplesPerTransactRx;
+    size_t numChannels;
+    sampleFormat_e cpuFormat; //The type of each component in the blocks
+    bool framed; //Each block starts with a rxFrameHeader_t
+    int pipeBatchBlocks; //Maximum number of blocks written to the pipe with a single call
+    int pipeBatchLatencyUs; //Maximum time to wait for a full batch before writing a partial batch
+    pipeFormat_e pipeFormat; //Recorded in the header of the shared memory ring
+    bool zeroCopy; //Gift the blocks to the pipe with vmsplice rather than copying them (falls back to writes if the output is not a pipe or there is more than 1 pipe)
+    uint64_t* blockStamps; //Set by the Rx handler, indexed by ring slot.  NULL if latency is not measured
+    latencyHist_t* latency; //Time from the recv returning to the block being written to the pipe
+    telemetryCounters_t* telemetry;
+    bool verbose;
+} rxPipeWriterArgs_t;
+
+//Receives samples from the USRP and packs them into blocks which are placed in the Rx ring.
+//With the planar pipe format, the output format is a block of real samples concatinated with a block of imagionary samples.
+//The type of each component is given by cpuFormat (fc32, sc16, or sc8).
+//With the interleaved pipe format, samples are received directly into the block in the ring
+//With multiple channels, a single multi-channel recv fills the block for each channel
+//With framing, the header is written in place at the start of each block in the ring
+//With decimation, the samples are received into a buffer and decimated in place before being reblocked, so the blocks
+//(and the frame header times) are at the decimated rate
+//With conditioning, each channel is conditioned (after any decimation) as it is deinterleaved into the planar blocks
 void* rxHandler(void* args);
 
+//Writes blocks from the Rx ring to the Rx pipe.  Decouples the USRP from stalls in the consumer of the Rx pipe
+//With 1 pipe per channel, each channel's block is written to its own pipe
+void* rxPipeWriter(void* argsUncast);
+
 #endif //UHDTOPIPES_RXHANDLER_H
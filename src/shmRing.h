@@ -0,0 +1,378 @@
+//
+// Shared memory ring of fixed size blocks for passing samples between uhdToPipes and other processes on the same host.
+//
+// This file is header only and does not depend on the rest of uhdToPipes so that it can be included by (or copied into)
+// the applications which consume Rx samples or produce Tx samples.  Link with -lrt on older versions of glibc.
+//
+// uhdToPipes creates the ring (POSIX shared memory named by --rxpipe / --txpipe when --transport shm is used) and the
+// other application opens it by name.  Each block is samplesPerBlock samples (for each channel) in the same layout as a
+// block on the pipes.  Blocks are read and written in place so no copies are made by the kernel.  Within uhdToPipes, the
+// ring backs the Rx/Tx ring (see spscRingInitShm) so the Rx handler receives into the blocks and the Tx handler sends
+// from them directly.
+//
+// Requires _GNU_SOURCE (or _DEFAULT_SOURCE) to be defined before any system header is included.
+//
+// The read and write indexes are free running counters (the slot is the index modulo numBlocks) and are kept on separate
+// cache lines.  A side which finds the ring empty (consumer) or full (producer) spins briefly then sleeps on a futex in
+// the shared segment.  The other side only makes a syscall to wake it if it is actually sleeping.
+//
+// Tx credits: the producer of Tx samples may write up to shmRingWriteAvailable blocks at any time.  Blocks are released
+// back to the producer once the Tx handler has sent them so this replaces the Tx feedback pipe.
+//
+
+#ifndef UHDTOPIPES_SHMRING_H
+#define UHDTOPIPES_SHMRING_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHM_RING_MAGIC (0x55325053) //"U2PS"
+#define SHM_RING_VERSION (1)
+#define SHM_RING_CACHE_LINE_SIZE (64)
+//Number of times to poll before sleeping on the futex
+#define SHM_RING_SPIN_ITTERATIONS (1000)
+//Sleeping waits wake up this often to check terminateStatus
+#define SHM_RING_WAIT_TIMEOUT_NS (100000000)
+
+//Layout of the start of the shared segment.  The blocks start at blocksOffset.
+typedef struct{
+    //---- Constant after create ----
+    _Atomic uint32_t magic; //Set to SHM_RING_MAGIC once the rest of the segment has been initialized
+    uint32_t version;
+    uint64_t numBlocks;
+    uint64_t blockSize; //Number of bytes of samples in each block
+    uint64_t blockStride; //Distance in bytes between the start of adjacent blocks (blockSize padded to a cache line)
+    uint64_t blocksOffset; //Distance in bytes from the start of the segment to the first block
+    uint32_t samplesPerBlock; //Per channel
+    uint32_t numChannels; //Each block holds a block of samplesPerBlock samples for each channel in turn
+    uint32_t sampleFormat; //Type of each component: 0 = fc32, 1 = sc16, 2 = sc8
+    uint32_t pipeFormat; //0 = planar (block of real then block of imagionary components), 1 = interleaved
+
+    //---- Peer ----
+    _Atomic uint32_t peerAttached; //Set (and used as a futex) when the other application opens the ring
+
+    //---- Producer ----
+    _Alignas(SHM_RING_CACHE_LINE_SIZE) _Atomic uint64_t writeInd;
+    _Atomic uint32_t writeSeq; //Futex the consumer sleeps on.  Incremented when the producer wakes the consumer
+    _Atomic uint32_t producerWaiting; //Set while the producer is sleeping on readSeq
+    _Atomic uint32_t producerDone; //Set once the producer will not commit any more blocks
+
+    //---- Consumer ----
+    _Alignas(SHM_RING_CACHE_LINE_SIZE) _Atomic uint64_t readInd;
+    _Atomic uint32_t readSeq; //Futex the producer sleeps on.  Incremented when the consumer wakes the producer
+    _Atomic uint32_t consumerWaiting; //Set while the consumer is sleeping on writeSeq
+} shmRingHeader_t;
+
+//Per process handle to the ring
+typedef struct shmRing_s{
+    shmRingHeader_t* header;
+    char* blocks;
+    size_t mapSize;
+    uint64_t numBlocks;
+    size_t blockSize;
+    size_t blockStride;
+    uint64_t readIndCached; //Producer's copy of readInd
+    uint64_t writeIndCached; //Consumer's copy of writeInd
+    size_t syscalls; //Number of futex calls made through this handle
+} shmRing_t;
+
+static inline void shmRingFutexWait(shmRing_t* ring, _Atomic uint32_t* futex, uint32_t expected){
+    struct timespec timeout = {.tv_sec = 0, .tv_nsec = SHM_RING_WAIT_TIMEOUT_NS};
+    //Not FUTEX_WAIT_PRIVATE, the futex is shared between processes
+    syscall(SYS_futex, futex, FUTEX_WAIT, expected, &timeout, NULL, 0);
+    ring->syscalls++;
+}
+
+static inline void shmRingFutexWake(shmRing_t* ring, _Atomic uint32_t* futex){
+    atomic_fetch_add_explicit(futex, 1, memory_order_release);
+    syscall(SYS_futex, futex, FUTEX_WAKE, 1, NULL, NULL, 0);
+    ring->syscalls++;
+}
+
+static inline void shmRingInitHandle(shmRing_t* ring, void* segment, size_t mapSize){
+    ring->header = (shmRingHeader_t*) segment;
+    ring->blocks = ((char*) segment) + ring->header->blocksOffset;
+    ring->mapSize = mapSize;
+    ring->numBlocks = ring->header->numBlocks;
+    ring->blockSize = ring->header->blockSize;
+    ring->blockStride = ring->header->blockStride;
+    ring->readIndCached = atomic_load_explicit(&ring->header->readInd, memory_order_acquire);
+    ring->writeIndCached = atomic_load_explicit(&ring->header->writeInd, memory_order_acquire);
+    ring->syscalls = 0;
+}
+
+//Creates the shared memory object called name (replacing any stale object of the same name) and maps it.
+//Returns 0 on success and -1 (with errno set) on failure
+static inline int shmRingCreate(shmRing_t* ring, const char* name, size_t numBlocks, size_t blockSize,
+                                uint32_t samplesPerBlock, uint32_t numChannels, uint32_t sampleFormat, uint32_t pipeFormat){
+    if(numBlocks < 1 || blockSize < 1){
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t blockStride = ((blockSize+SHM_RING_CACHE_LINE_SIZE-1)/SHM_RING_CACHE_LINE_SIZE)*SHM_RING_CACHE_LINE_SIZE;
+    size_t blocksOffset = ((sizeof(shmRingHeader_t)+SHM_RING_CACHE_LINE_SIZE-1)/SHM_RING_CACHE_LINE_SIZE)*SHM_RING_CACHE_LINE_SIZE;
+    size_t mapSize = blocksOffset + numBlocks*blockStride;
+
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0666);
+    if(fd < 0){
+        return -1;
+    }
+    if(ftruncate(fd, mapSize) != 0){
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    //Populate the mapping now so that page faults do not occur while streaming
+    void* segment = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if(segment == MAP_FAILED){
+        shm_unlink(name);
+        return -1;
+    }
+
+    shmRingHeader_t* header = (shmRingHeader_t*) segment;
+    header->version = SHM_RING_VERSION;
+    header->numBlocks = numBlocks;
+    header->blockSize = blockSize;
+    header->blockStride = blockStride;
+    header->blocksOffset = blocksOffset;
+    header->samplesPerBlock = samplesPerBlock;
+    header->numChannels = numChannels;
+    header->sampleFormat = sampleFormat;
+    header->pipeFormat = pipeFormat;
+    //The rest of the segment is zero from ftruncate
+    atomic_store_explicit(&header->magic, SHM_RING_MAGIC, memory_order_release);
+
+    shmRingInitHandle(ring, segment, mapSize);
+    return 0;
+}
+
+//Opens a ring created by another process.  Returns 0 on success and -1 (with errno set) on failure.  errno is EAGAIN if
+//the ring exists but has not finished being initialized
+static inline int shmRingOpen(shmRing_t* ring, const char* name){
+    int fd = shm_open(name, O_RDWR, 0);
+    if(fd < 0){
+        return -1;
+    }
+    struct stat shmStat;
+    if(fstat(fd, &shmStat) != 0){
+        close(fd);
+        return -1;
+    }
+    size_t mapSize = shmStat.st_size;
+    if(mapSize < sizeof(shmRingHeader_t)){
+        close(fd);
+        errno = EAGAIN;
+        return -1;
+    }
+    void* segment = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    close(fd);
+    if(segment == MAP_FAILED){
+        return -1;
+    }
+
+    shmRingHeader_t* header = (shmRingHeader_t*) segment;
+    if(atomic_load_explicit(&header->magic, memory_order_acquire) != SHM_RING_MAGIC){
+        munmap(segment, mapSize);
+        errno = EAGAIN;
+        return -1;
+    }
+    if(header->version != SHM_RING_VERSION || header->blocksOffset + header->numBlocks*header->blockStride > mapSize){
+        munmap(segment, mapSize);
+        errno = EINVAL;
+        return -1;
+    }
+
+    shmRingInitHandle(ring, segment, mapSize);
+
+    atomic_store_explicit(&header->peerAttached, 1, memory_order_release);
+    shmRingFutexWake(ring, &header->peerAttached);
+    return 0;
+}
+
+//Waits (creator side) for the other application to open the ring.  Returns false if terminateStatus becomes true while
+//waiting.  terminateStatus may be NULL
+static inline bool shmRingWaitForPeer(shmRing_t* ring, bool* terminateStatus){
+    while(atomic_load_explicit(&ring->header->peerAttached, memory_order_acquire) == 0){
+        if(terminateStatus != NULL && *terminateStatus){
+            return false;
+        }
+        shmRingFutexWait(ring, &ring->header->peerAttached, 0);
+    }
+    return true;
+}
+
+//Unmaps the ring.  The shared memory object is only removed by shmRingUnlink
+static inline void shmRingClose(shmRing_t* ring){
+    if(ring->header != NULL){
+        munmap(ring->header, ring->mapSize);
+    }
+    ring->header = NULL;
+    ring->blocks = NULL;
+}
+
+//Removes the name of the shared memory object.  Processes which have the ring open can continue to use it
+static inline void shmRingUnlink(const char* name){
+    shm_unlink(name);
+}
+
+//==== Producer ====
+
+//Returns the number of free blocks (the producer's credits)
+static inline size_t shmRingWriteAvailable(shmRing_t* ring){
+    uint64_t writeInd = atomic_load_explicit(&ring->header->writeInd, memory_order_relaxed);
+    if(writeInd - ring->readIndCached >= ring->numBlocks){
+        ring->readIndCached = atomic_load_explicit(&ring->header->readInd, memory_order_acquire);
+    }
+    return ring->numBlocks - (writeInd - ring->readIndCached);
+}
+
+//Waits for at least one free block.  Returns the number of free blocks or 0 if terminateStatus becomes true while
+//waiting.  terminateStatus may be NULL
+static inline size_t shmRingWaitWriteAvailable(shmRing_t* ring, bool* terminateStatus){
+    shmRingHeader_t* header = ring->header;
+    int spinCount = 0;
+    size_t available;
+    while((available = shmRingWriteAvailable(ring)) == 0){
+        if(terminateStatus != NULL && *terminateStatus){
+            return 0;
+        }
+        if(spinCount < SHM_RING_SPIN_ITTERATIONS){
+            spinCount++;
+            sched_yield();
+            continue;
+        }
+        //Announce that the producer is going to sleep then re-check so that a release between the check and the sleep
+        //is not missed (the consumer increments readSeq before waking so the wait returns immediately)
+        uint32_t seq = atomic_load_explicit(&header->readSeq, memory_order_acquire);
+        atomic_store_explicit(&header->producerWaiting, 1, memory_order_seq_cst);
+        atomic_thread_fence(memory_order_seq_cst);
+        if(shmRingWriteAvailable(ring) == 0){
+            shmRingFutexWait(ring, &header->readSeq, seq);
+        }
+        atomic_store_explicit(&header->producerWaiting, 0, memory_order_relaxed);
+    }
+    return available;
+}
+
+//Returns the free block offset blocks after the next free block.  offset must be less than shmRingWriteAvailable
+static inline void* shmRingPeekWrite(shmRing_t* ring, size_t offset){
+    uint64_t writeInd = atomic_load_explicit(&ring->header->writeInd, memory_order_relaxed);
+    return ring->blocks + ((writeInd+offset) % ring->numBlocks)*ring->blockStride;
+}
+
+//Waits for a free block.  Returns NULL if terminateStatus becomes true while waiting
+static inline void* shmRingAcquireWrite(shmRing_t* ring, bool* terminateStatus){
+    if(shmRingWaitWriteAvailable(ring, terminateStatus) == 0){
+        return NULL;
+    }
+    return shmRingPeekWrite(ring, 0);
+}
+
+//Publishes the next numBlocks free blocks to the consumer
+static inline void shmRingCommitWriteN(shmRing_t* ring, size_t numBlocks){
+    shmRingHeader_t* header = ring->header;
+    uint64_t writeInd = atomic_load_explicit(&header->writeInd, memory_order_relaxed);
+    atomic_store_explicit(&header->writeInd, writeInd+numBlocks, memory_order_seq_cst);
+    if(atomic_load_explicit(&header->consumerWaiting, memory_order_seq_cst)){
+        shmRingFutexWake(ring, &header->writeSeq);
+    }
+}
+
+//Publishes the block returned by the last acquire to the consumer
+static inline void shmRingCommitWrite(shmRing_t* ring){
+    shmRingCommitWriteN(ring, 1);
+}
+
+//Tells the consumer that no more blocks will be committed
+static inline void shmRingProducerDone(shmRing_t* ring){
+    atomic_store_explicit(&ring->header->producerDone, 1, memory_order_seq_cst);
+    shmRingFutexWake(ring, &ring->header->writeSeq);
+}
+
+//==== Consumer ====
+
+//Returns the number of committed blocks
+static inline size_t shmRingReadAvailable(shmRing_t* ring){
+    uint64_t readInd = atomic_load_explicit(&ring->header->readInd, memory_order_relaxed);
+    if(ring->writeIndCached == readInd){
+        ring->writeIndCached = atomic_load_explicit(&ring->header->writeInd, memory_order_acquire);
+    }
+    return ring->writeIndCached - readInd;
+}
+
+//Waits for at least one committed block.  Returns the number of committed blocks or 0 once the ring is empty and the
+//producer is done or if terminateStatus becomes true while waiting.  terminateStatus may be NULL
+static inline size_t shmRingWaitReadAvailable(shmRing_t* ring, bool* terminateStatus){
+    shmRingHeader_t* header = ring->header;
+    int spinCount = 0;
+    size_t available;
+    while((available = shmRingReadAvailable(ring)) == 0){
+        //Check producerDone then re-check the ring in case the last blocks were committed just before it was set
+        if(atomic_load_explicit(&header->producerDone, memory_order_acquire)){
+            return shmRingReadAvailable(ring);
+        }
+        if(terminateStatus != NULL && *terminateStatus){
+            return 0;
+        }
+        if(spinCount < SHM_RING_SPIN_ITTERATIONS){
+            spinCount++;
+            sched_yield();
+            continue;
+        }
+        uint32_t seq = atomic_load_explicit(&header->writeSeq, memory_order_acquire);
+        atomic_store_explicit(&header->consumerWaiting, 1, memory_order_seq_cst);
+        atomic_thread_fence(memory_order_seq_cst);
+        if(shmRingReadAvailable(ring) == 0 && !atomic_load_explicit(&header->producerDone, memory_order_acquire)){
+            shmRingFutexWait(ring, &header->writeSeq, seq);
+        }
+        atomic_store_explicit(&header->consumerWaiting, 0, memory_order_relaxed);
+    }
+    return available;
+}
+
+//Returns the committed block offset blocks after the oldest.  offset must be less than shmRingReadAvailable
+static inline void* shmRingPeekRead(shmRing_t* ring, size_t offset){
+    uint64_t readInd = atomic_load_explicit(&ring->header->readInd, memory_order_relaxed);
+    return ring->blocks + ((readInd+offset) % ring->numBlocks)*ring->blockStride;
+}
+
+//Waits for a committed block.  Returns NULL once the ring is empty and the producer is done or if terminateStatus
+//becomes true while waiting
+static inline void* shmRingAcquireRead(shmRing_t* ring, bool* terminateStatus){
+    if(shmRingWaitReadAvailable(ring, terminateStatus) == 0){
+        return NULL;
+    }
+    return shmRingPeekRead(ring, 0);
+}
+
+//Returns the oldest numBlocks committed blocks to the producer
+static inline void shmRingReleaseReadN(shmRing_t* ring, size_t numBlocks){
+    shmRingHeader_t* header = ring->header;
+    uint64_t readInd = atomic_load_explicit(&header->readInd, memory_order_relaxed);
+    atomic_store_explicit(&header->readInd, readInd+numBlocks, memory_order_seq_cst);
+    if(atomic_load_explicit(&header->producerWaiting, memory_order_seq_cst)){
+        shmRingFutexWake(ring, &header->readSeq);
+    }
+}
+
+//Returns the block returned by the last acquire to the producer
+static inline void shmRingReleaseRead(shmRing_t* ring){
+    shmRingReleaseReadN(ring, 1);
+}
+
+#endif //UHDTOPIPES_SHMRING_H
@@ -0,0 +1,295 @@
+//
+// Single producer / single consumer ring of fixed size blocks.
+//
+
+#define _GNU_SOURCE
+#include "spscRing.h"
+#include "shmRing.h"
+#include "streamBuffer.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+
+void spscRingBackoff(int* spinCount){
+    if(*spinCount < SPSC_RING_SPIN_ITTERATIONS){
+        (*spinCount)++;
+        sched_yield();
+    }else{
+        struct timespec sleepTime = {.tv_sec = 0, .tv_nsec = SPSC_RING_SLEEP_NS};
+        nanosleep(&sleepTime, NULL);
+    }
+}
+
+int spscRingInit(spscRing_t* ring, size_t numBlocks, size_t blockSize){
+    return spscRingInitAligned(ring, numBlocks, blockSize, CACHE_LINE_SIZE);
+}
+
+int spscRingInitAligned(spscRing_t* ring, size_t numBlocks, size_t blockSize, size_t alignment){
+    return spscRingInitPlaced(ring, numBlocks, blockSize, alignment, -1, "ring");
+}
+
+int spscRingInitPlaced(spscRing_t* ring, size_t numBlocks, size_t blockSize, size_t alignment, int numaNode, const char* name){
+    if(numBlocks < 1 || blockSize < 1){
+        return -1;
+    }
+
+    //Round each block up to the alignment (at least a cache line) so that adjacent blocks do not share a line
+    size_t blockSizeAligned = ((blockSize+alignment-1)/alignment)*alignment;
+    //The buffer is page aligned (which covers any alignment up to the page size) and has been touched so that page faults
+    //do not occur while streaming
+    void* blocks = streamBufferAlloc(blockSizeAligned*numBlocks, numaNode, name);
+    if(blocks == NULL){
+        return -1;
+    }
+
+    atomic_init(&ring->writeInd, 0);
+    ring->readIndCached = 0;
+    atomic_init(&ring->producerDone, false);
+    atomic_init(&ring->readInd, 0);
+    ring->writeIndCached = 0;
+    ring->numBlocks = numBlocks;
+    ring->blockSize = blockSizeAligned;
+    ring->blocks = blocks;
+    ring->shm = NULL;
+    ring->shmName = NULL;
+
+    return 0;
+}
+
+int spscRingInitShm(spscRing_t* ring, const char* name, size_t numBlocks, size_t blockSize, uint32_t samplesPerBlock,
+                    uint32_t numChannels, uint32_t sampleFormat, uint32_t pipeFormat){
+    shmRing_t* shm = malloc(sizeof(shmRing_t));
+    if(shm == NULL){
+        errno = ENOMEM;
+        return -1;
+    }
+    if(shmRingCreate(shm, name, numBlocks, blockSize, samplesPerBlock, numChannels, sampleFormat, pipeFormat) != 0){
+        free(shm);
+        return -1;
+    }
+
+    //The indexes in the handle are not used, the shared ones are used instead
+    atomic_init(&ring->writeInd, 0);
+    ring->readIndCached = 0;
+    atomic_init(&ring->producerDone, false);
+    atomic_init(&ring->readInd, 0);
+    ring->writeIndCached = 0;
+    ring->numBlocks = shm->numBlocks;
+    ring->blockSize = shm->blockStride;
+    ring->blocks = shm->blocks;
+    ring->shm = shm;
+    ring->shmName = name;
+
+    return 0;
+}
+
+void spscRingFree(spscRing_t* ring){
+    if(ring->shm != NULL){
+        shmRingClose(ring->shm);
+        shmRingUnlink(ring->shmName);
+        free(ring->shm);
+        ring->shm = NULL;
+    }else{
+        streamBufferFree(ring->blocks);
+    }
+    ring->blocks = NULL;
+}
+
+bool spscRingWaitForPeer(spscRing_t* ring, bool* terminateStatus){
+    if(ring->shm == NULL){
+        return true;
+    }
+    return shmRingWaitForPeer(ring->shm, terminateStatus);
+}
+
+static bool spscRingIsProducerDone(spscRing_t* ring){
+    if(ring->shm != NULL){
+        return atomic_load_explicit(&ring->shm->header->producerDone, memory_order_acquire) != 0;
+    }
+    return atomic_load_explicit(&ring->producerDone, memory_order_acquire);
+}
+
+void* spscRingTryAcquireWrite(spscRing_t* ring){
+    if(ring->shm != NULL){
+        return shmRingWriteAvailable(ring->shm) > 0 ? shmRingPeekWrite(ring->shm, 0) : NULL;
+    }
+    size_t writeInd = atomic_load_explicit(&ring->writeInd, memory_order_relaxed);
+    if(writeInd - ring->readIndCached >= ring->numBlocks){
+        ring->readIndCached = atomic_load_explicit(&ring->readInd, memory_order_acquire);
+        if(writeInd - ring->readIndCached >= ring->numBlocks){
+            return NULL;
+        }
+    }
+    return ring->blocks + (writeInd % ring->numBlocks)*ring->blockSize;
+}
+
+void* spscRingAcquireWrite(spscRing_t* ring, bool* terminateStatus){
+    if(ring->shm != NULL){
+        return shmRingAcquireWrite(ring->shm, terminateStatus);
+    }
+    int spinCount = 0;
+    void* block;
+    while((block = spscRingTryAcquireWrite(ring)) == NULL){
+        if(*terminateStatus){
+            return NULL;
+        }
+        spscRingBackoff(&spinCount);
+    }
+    return block;
+}
+
+void spscRingCommitWrite(spscRing_t* ring){
+    if(ring->shm != NULL){
+        shmRingCommitWrite(ring->shm);
+        return;
+    }
+    size_t writeInd = atomic_load_explicit(&ring->writeInd, memory_order_relaxed);
+    atomic_store_explicit(&ring->writeInd, writeInd+1, memory_order_release);
+}
+
+void spscRingProducerDone(spscRing_t* ring){
+    if(ring->shm != NULL){
+        shmRingProducerDone(ring->shm);
+        return;
+    }
+    atomic_store_explicit(&ring->producerDone, true, memory_order_release);
+}
+
+size_t spscRingWriteAvailable(spscRing_t* ring){
+    if(ring->shm != NULL){
+        return shmRingWriteAvailable(ring->shm);
+    }
+    size_t writeInd = atomic_load_explicit(&ring->writeInd, memory_order_relaxed);
+    ring->readIndCached = atomic_load_explicit(&ring->readInd, memory_order_acquire);
+    return ring->numBlocks - (writeInd - ring->readIndCached);
+}
+
+void* spscRingPeekWrite(spscRing_t* ring, size_t offset){
+    if(ring->shm != NULL){
+        return shmRingPeekWrite(ring->shm, offset);
+    }
+    size_t writeInd = atomic_load_explicit(&ring->writeInd, memory_order_relaxed);
+    return ring->blocks + ((writeInd+offset) % ring->numBlocks)*ring->blockSize;
+}
+
+void spscRingCommitWriteN(spscRing_t* ring, size_t numBlocks){
+    if(ring->shm != NULL){
+        shmRingCommitWriteN(ring->shm, numBlocks);
+        return;
+    }
+    size_t writeInd = atomic_load_explicit(&ring->writeInd, memory_order_relaxed);
+    atomic_store_explicit(&ring->writeInd, writeInd+numBlocks, memory_order_release);
+}
+
+void* spscRingTryAcquireRead(spscRing_t* ring){
+    if(ring->shm != NULL){
+        return shmRingReadAvailable(ring->shm) > 0 ? shmRingPeekRead(ring->shm, 0) : NULL;
+    }
+    size_t readInd = atomic_load_explicit(&ring->readInd, memory_order_relaxed);
+    if(readInd == ring->writeIndCached){
+        ring->writeIndCached = atomic_load_explicit(&ring->writeInd, memory_order_acquire);
+        if(readInd == ring->writeIndCached){
+            return NULL;
+        }
+    }
+    return ring->blocks + (readInd % ring->numBlocks)*ring->blockSize;
+}
+
+void* spscRingAcquireRead(spscRing_t* ring, bool* terminateStatus){
+    if(ring->shm != NULL){
+        return shmRingAcquireRead(ring->shm, terminateStatus);
+    }
+    int spinCount = 0;
+    void* block;
+    while((block = spscRingTryAcquireRead(ring)) == NULL){
+        if(atomic_load_explicit(&ring->producerDone, memory_order_acquire)){
+            //The producer may have committed a block before setting done, check once more
+            return spscRingTryAcquireRead(ring);
+        }
+        if(terminateStatus != NULL && *terminateStatus){
+            return NULL;
+        }
+        spscRingBackoff(&spinCount);
+    }
+    return block;
+}
+
+void spscRingReleaseRead(spscRing_t* ring){
+    if(ring->shm != NULL){
+        shmRingReleaseRead(ring->shm);
+        return;
+    }
+    size_t readInd = atomic_load_explicit(&ring->readInd, memory_order_relaxed);
+    atomic_store_explicit(&ring->readInd, readInd+1, memory_order_release);
+}
+
+size_t spscRingReadAvailable(spscRing_t* ring){
+    if(ring->shm != NULL){
+        return shmRingReadAvailable(ring->shm);
+    }
+    size_t readInd = atomic_load_explicit(&ring->readInd, memory_order_relaxed);
+    ring->writeIndCached = atomic_load_explicit(&ring->writeInd, memory_order_acquire);
+    return ring->writeIndCached - readInd;
+}
+
+void* spscRingPeekRead(spscRing_t* ring, size_t offset){
+    if(ring->shm != NULL){
+        return shmRingPeekRead(ring->shm, offset);
+    }
+    size_t readInd = atomic_load_explicit(&ring->readInd, memory_order_relaxed);
+    return ring->blocks + ((readInd+offset) % ring->numBlocks)*ring->blockSize;
+}
+
+void spscRingReleaseReadN(spscRing_t* ring, size_t numBlocks){
+    if(ring->shm != NULL){
+        shmRingReleaseReadN(ring->shm, numBlocks);
+        return;
+    }
+    size_t readInd = atomic_load_explicit(&ring->readInd, memory_order_relaxed);
+    atomic_store_explicit(&ring->readInd, readInd+numBlocks, memory_order_release);
+}
+
+size_t spscRingOccupancy(spscRing_t* ring){
+    if(ring->shm != NULL){
+        uint64_t readInd = atomic_load_explicit(&ring->shm->header->readInd, memory_order_acquire);
+        uint64_t writeInd = atomic_load_explicit(&ring->shm->header->writeInd, memory_order_acquire);
+        return writeInd - readInd;
+    }
+    size_t readInd = atomic_load_explicit(&ring->readInd, memory_order_acquire);
+    size_t writeInd = atomic_load_explicit(&ring->writeInd, memory_order_acquire);
+    return writeInd - readInd;
+}
+
+bool spscRingWaitForOccupancy(spscRing_t* ring, size_t numBlocks, bool* terminateStatus){
+    int spinCount = 0;
+    while(spscRingOccupancy(ring) < numBlocks){
+        if(spscRingIsProducerDone(ring)){
+            return true;
+        }
+        if(*terminateStatus){
+            return false;
+        }
+        spscRingBackoff(&spinCount);
+    }
+    return true;
+}
+
+size_t spscRingWaitForOccupancyUntil(spscRing_t* ring, size_t numBlocks, const struct timespec* deadline){
+    int spinCount = 0;
+    size_t available;
+    while((available = spscRingReadAvailable(ring)) < numBlocks){
+        if(spscRingIsProducerDone(ring)){
+            return spscRingReadAvailable(ring);
+        }
+        struct timespec currentTime;
+        clock_gettime(CLOCK_MONOTONIC, &currentTime);
+        if(currentTime.tv_sec > deadline->tv_sec ||
+           (currentTime.tv_sec == deadline->tv_sec && currentTime.tv_nsec >= deadline->tv_nsec)){
+            return available;
+        }
+        spscRingBackoff(&spinCount);
+    }
+    return available;
+}
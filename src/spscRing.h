@@ -0,0 +1,112 @@
+//
+// Single producer / single consumer ring of fixed size blocks.
+//
+
+#ifndef UHDTOPIPES_SPSCRING_H
+#define UHDTOPIPES_SPSCRING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "common.h"
+
+struct shmRing_s; //See shmRing.h
+
+//Number of times to poll before starting to sleep between polls
+#define SPSC_RING_SPIN_ITTERATIONS (1000)
+#define SPSC_RING_SLEEP_NS (10000)
+
+//The blocks are pre-allocated when the ring is initialized.  The producer acquires the next free block, fills it, then
+//commits it.  The consumer acquires the oldest committed block, uses it, then releases it back to the producer.
+//
+//The read and write indexes are free running counters (the slot is the index modulo numBlocks) and are kept on separate
+//cache lines.  Each side keeps a cached copy of the other side's index so that the shared index is only re-read when the
+//ring looks full (producer) or empty (consumer).
+typedef struct{
+    //---- Producer ----
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t writeInd;
+    size_t readIndCached; //Producer's copy of readInd
+    atomic_bool producerDone; //Set by the producer once it will not commit any more blocks
+
+    //---- Consumer ----
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t readInd;
+    size_t writeIndCached; //Consumer's copy of writeInd
+
+    //---- Constant after init ----
+    _Alignas(CACHE_LINE_SIZE) size_t numBlocks;
+    size_t blockSize; //In bytes
+    char* blocks;
+    struct shmRing_s* shm; //Not NULL when the blocks and indexes are in a shared memory ring (see spscRingInitShm)
+    const char* shmName;
+} spscRing_t;
+
+//Returns 0 on success
+int spscRingInit(spscRing_t* ring, size_t numBlocks, size_t blockSize);
+//Each block starts on a multiple of alignment and is padded to a multiple of alignment (alignment must be a power of 2
+//and a multiple of sizeof(void*)).  spscRingInit uses CACHE_LINE_SIZE
+int spscRingInitAligned(spscRing_t* ring, size_t numBlocks, size_t blockSize, size_t alignment);
+//As spscRingInitAligned with the blocks placed on the given NUMA node (-1 for the node of the calling thread).  name is
+//used in the buffer placement report (see streamBuffer.h)
+int spscRingInitPlaced(spscRing_t* ring, size_t numBlocks, size_t blockSize, size_t alignment, int numaNode, const char* name);
+//Creates a shared memory ring called name (see shmRing.h) and uses it in place of the ring's own blocks and indexes so
+//that the other application reads (Rx) or writes (Tx) the blocks in place.  This side uses the ring through the
+//functions below as usual.  Returns 0 on success and -1 (with errno set) on failure
+int spscRingInitShm(spscRing_t* ring, const char* name, size_t numBlocks, size_t blockSize, uint32_t samplesPerBlock,
+                    uint32_t numChannels, uint32_t sampleFormat, uint32_t pipeFormat);
+//Also unmaps and removes the name of a shared memory ring (the other application keeps its mapping)
+void spscRingFree(spscRing_t* ring);
+//Waits for the other application to open a shared memory ring (returns true immediately for a ring which is not in
+//shared memory).  Returns false if terminateStatus becomes true while waiting
+bool spscRingWaitForPeer(spscRing_t* ring, bool* terminateStatus);
+
+//Returns the next free block or NULL if the ring is full
+void* spscRingTryAcquireWrite(spscRing_t* ring);
+//Waits for a free block.  Returns NULL if terminateStatus becomes true while waiting
+void* spscRingAcquireWrite(spscRing_t* ring, bool* terminateStatus);
+//Publishes the block returned by the last acquire to the consumer
+void spscRingCommitWrite(spscRing_t* ring);
+//Tells the consumer that no more blocks will be committed
+void spscRingProducerDone(spscRing_t* ring);
+
+//Batched producer access.  Returns the number of free blocks
+size_t spscRingWriteAvailable(spscRing_t* ring);
+//Returns the free block offset blocks after the next free block.  offset must be less than spscRingWriteAvailable
+void* spscRingPeekWrite(spscRing_t* ring, size_t offset);
+//Publishes the next numBlocks free blocks to the consumer
+void spscRingCommitWriteN(spscRing_t* ring, size_t numBlocks);
+
+//Returns the oldest committed block or NULL if the ring is empty
+void* spscRingTryAcquireRead(spscRing_t* ring);
+//Waits for a committed block.  Returns NULL once the ring is empty and the producer is done.
+//If terminateStatus is not NULL, also returns NULL if terminateStatus becomes true while waiting
+void* spscRingAcquireRead(spscRing_t* ring, bool* terminateStatus);
+//Returns the block returned by the last acquire to the producer
+void spscRingReleaseRead(spscRing_t* ring);
+
+//Batched consumer access.  Returns the number of committed blocks
+size_t spscRingReadAvailable(spscRing_t* ring);
+//Returns the committed block offset blocks after the oldest.  offset must be less than spscRingReadAvailable
+void* spscRingPeekRead(spscRing_t* ring, size_t offset);
+//Returns the oldest numBlocks committed blocks to the producer
+void spscRingReleaseReadN(spscRing_t* ring, size_t numBlocks);
+
+//Polls with sched_yield for the first calls then sleeps between polls.  spinCount should start at 0 for each wait
+void spscRingBackoff(int* spinCount);
+
+//Slot (0 to numBlocks-1) of a block returned by the ring.  Used to index per-block data kept alongside the ring
+static inline size_t spscRingSlot(spscRing_t* ring, void* block){
+    return ((char*) block - ring->blocks)/ring->blockSize;
+}
+
+//Number of committed blocks which have not yet been released (can be called from either side)
+size_t spscRingOccupancy(spscRing_t* ring);
+//Waits (consumer side) until at least numBlocks blocks are committed or the producer is done.
+//Returns false if terminateStatus becomes true while waiting
+bool spscRingWaitForOccupancy(spscRing_t* ring, size_t numBlocks, bool* terminateStatus);
+//Waits (consumer side) until at least numBlocks blocks are committed, the producer is done, or deadline
+//(CLOCK_MONOTONIC) passes.  Returns the number of committed blocks
+size_t spscRingWaitForOccupancyUntil(spscRing_t* ring, size_t numBlocks, const struct timespec* deadline);
+
+#endif //UHDTOPIPES_SPSCRING_H
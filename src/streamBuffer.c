@@ -0,0 +1,201 @@
+//
+// Allocator for the streaming buffers (the Rx/Tx rings and the handlers' UHD buffers and remainders).
+//
+
+#define _GNU_SOURCE
+#include "streamBuffer.h"
+#include <dirent.h>
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define STREAM_BUFFER_REPORT_PAGES (64) //Pages sampled when reporting the node(s) a buffer landed on
+
+typedef struct{
+    void* buf;
+    size_t mappedSize;
+} streamBufferEntry_t;
+
+static streamBufferConfig_t streamBufferConfig = {.hugepages = false, .lock = false, .verbose = false};
+static streamBufferEntry_t streamBufferEntries[STREAM_BUFFER_MAX_BUFFERS];
+static pthread_mutex_t streamBufferMutex = PTHREAD_MUTEX_INITIALIZER;
+
+void streamBufferConfigure(const streamBufferConfig_t* config){
+    streamBufferConfig = *config;
+}
+
+int streamBufferCpuNode(int cpu){
+    if(cpu < 0){
+        return -1;
+    }
+    //The CPU's directory in sysfs contains a link named after its node
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR* dir = opendir(path);
+    if(dir == NULL){
+        return -1;
+    }
+    int node = -1;
+    struct dirent* entry;
+    while((entry = readdir(dir)) != NULL){
+        if(strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9'){
+            node = atoi(entry->d_name+4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+//Prefers the given node for the pages of the mapping (the pages are not yet faulted in).  Returns 0 on success
+static int streamBufferBind(void* buf, size_t size, int numaNode){
+    unsigned long nodeMask = 0;
+    if(numaNode < 0 || numaNode >= (int) (8*sizeof(nodeMask))){
+        errno = EINVAL;
+        return -1;
+    }
+    nodeMask = 1UL << numaNode;
+    return (int) syscall(SYS_mbind, buf, size, MPOL_PREFERRED, &nodeMask, 8*sizeof(nodeMask), 0);
+}
+
+//Prints the size, page size, lock state, and the node(s) of a sample of the pages of the buffer
+static void streamBufferReport(const char* name, void* buf, size_t size, size_t pageSize, const char* pageType,
+                               bool locked, int numaNode){
+    size_t numPages = size/pageSize;
+    size_t stride = numPages > STREAM_BUFFER_REPORT_PAGES ? numPages/STREAM_BUFFER_REPORT_PAGES : 1;
+    void* pages[STREAM_BUFFER_REPORT_PAGES];
+    int status[STREAM_BUFFER_REPORT_PAGES];
+    size_t numSampled = 0;
+    for(size_t page = 0; page<numPages && numSampled<STREAM_BUFFER_REPORT_PAGES; page += stride){
+        pages[numSampled++] = ((char*) buf) + page*pageSize;
+    }
+
+    //With no target nodes, move_pages returns the node of each page
+    char nodes[128] = "unknown";
+    if(syscall(SYS_move_pages, 0, numSampled, pages, NULL, status, 0) == 0){
+        int pagesOnNode[64] = {0};
+        size_t offset = 0;
+        nodes[0] = '\0';
+        for(size_t page = 0; page<numSampled; page++){
+            if(status[page] >= 0 && status[page] < 64){
+                pagesOnNode[status[page]]++;
+            }
+        }
+        for(int node = 0; node<64 && offset<sizeof(nodes); node++){
+            if(pagesOnNode[node] > 0){
+                offset += snprintf(nodes+offset, sizeof(nodes)-offset, "%s%d (%d/%zu sampled pages)",
+                                   offset > 0 ? ", " : "", node, pagesOnNode[node], numSampled);
+            }
+        }
+        if(offset == 0){
+            snprintf(nodes, sizeof(nodes), "unknown");
+        }
+    }
+
+    char preferred[32] = "first touch";
+    if(numaNode >= 0){
+        snprintf(preferred, sizeof(preferred), "preferred node %d", numaNode);
+    }
+    fprintf(stderr, "Buffer %s: %zu bytes in %zu %s pages, %s, node %s, %s\n", name, size, numPages, pageType,
+            locked ? "locked" : "not locked", nodes, preferred);
+}
+
+void* streamBufferAlloc(size_t size, int numaNode, const char* name){
+    if(size < 1){
+        size = 1;
+    }
+
+    pthread_mutex_lock(&streamBufferMutex);
+    int entryInd = -1;
+    for(int ind = 0; ind<STREAM_BUFFER_MAX_BUFFERS; ind++){
+        if(streamBufferEntries[ind].buf == NULL){
+            entryInd = ind;
+            streamBufferEntries[ind].buf = MAP_FAILED; //Reserved until the mapping is made
+            break;
+        }
+    }
+    pthread_mutex_unlock(&streamBufferMutex);
+    if(entryInd < 0){
+        printf("Too many stream buffers allocated\n");
+        return NULL;
+    }
+
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    const char* pageType = "4kB";
+    void* buf = MAP_FAILED;
+    size_t mappedSize = 0;
+    if(streamBufferConfig.hugepages){
+        mappedSize = ((size+STREAM_BUFFER_HUGEPAGE_SIZE-1)/STREAM_BUFFER_HUGEPAGE_SIZE)*STREAM_BUFFER_HUGEPAGE_SIZE;
+        buf = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(buf != MAP_FAILED){
+            pageSize = STREAM_BUFFER_HUGEPAGE_SIZE;
+            pageType = "2MB";
+        }else{
+            fprintf(stderr, "No 2MB hugepages available for buffer %s (see /proc/sys/vm/nr_hugepages), using transparent hugepages\n", name);
+        }
+    }
+    if(buf == MAP_FAILED){
+        mappedSize = ((size+pageSize-1)/pageSize)*pageSize;
+        buf = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(buf == MAP_FAILED){
+            pthread_mutex_lock(&streamBufferMutex);
+            streamBufferEntries[entryInd].buf = NULL;
+            pthread_mutex_unlock(&streamBufferMutex);
+            return NULL;
+        }
+        if(streamBufferConfig.hugepages){
+            madvise(buf, mappedSize, MADV_HUGEPAGE);
+            pageType = "4kB (transparent hugepage)";
+        }
+    }
+
+    if(numaNode >= 0 && streamBufferBind(buf, mappedSize, numaNode) != 0 && streamBufferConfig.verbose){
+        fprintf(stderr, "Unable to place buffer %s on node %d: %s\n", name, numaNode, strerror(errno));
+    }
+
+    //Fault in the pages now (on the preferred node, or the node of this thread) so that page faults do not occur while
+    //streaming
+    memset(buf, 0, mappedSize);
+
+    bool locked = false;
+    if(streamBufferConfig.lock){
+        locked = mlock(buf, mappedSize) == 0;
+        if(!locked){
+            fprintf(stderr, "Unable to lock buffer %s in memory (%s), see ulimit -l\n", name, strerror(errno));
+        }
+    }
+
+    pthread_mutex_lock(&streamBufferMutex);
+    streamBufferEntries[entryInd].buf = buf;
+    streamBufferEntries[entryInd].mappedSize = mappedSize;
+    pthread_mutex_unlock(&streamBufferMutex);
+
+    streamBufferReport(name, buf, mappedSize, pageSize, pageType, locked, numaNode);
+    return buf;
+}
+
+void streamBufferFree(void* buf){
+    if(buf == NULL){
+        return;
+    }
+    size_t mappedSize = 0;
+    pthread_mutex_lock(&streamBufferMutex);
+    for(int ind = 0; ind<STREAM_BUFFER_MAX_BUFFERS; ind++){
+        if(streamBufferEntries[ind].buf == buf){
+            mappedSize = streamBufferEntries[ind].mappedSize;
+            streamBufferEntries[ind].buf = NULL;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&streamBufferMutex);
+    if(mappedSize > 0){
+        munmap(buf, mappedSize); //Also unlocks the pages
+    }
+}
@@ -0,0 +1,39 @@
+//
+// Allocator for the streaming buffers (the Rx/Tx rings and the handlers' UHD buffers and remainders).
+//
+// Buffers are mapped directly (so they are page aligned, which also satisfies the cache line alignment of the kernels
+// and the page alignment needed to gift blocks with vmsplice), optionally backed by 2MB hugepages and locked in memory,
+// and placed on a NUMA node.  Each buffer is zeroed by the allocating thread so that, without an explicit node, the
+// pages are placed on the node of the CPU the allocating thread is pinned to (first touch).  A line describing where
+// each buffer landed is printed when it is allocated.
+//
+
+#ifndef UHDTOPIPES_STREAMBUFFER_H
+#define UHDTOPIPES_STREAMBUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define STREAM_BUFFER_HUGEPAGE_SIZE (2*1024*1024)
+#define STREAM_BUFFER_MAX_BUFFERS (64) //Maximum number of buffers allocated at once
+
+typedef struct{
+    bool hugepages; //Back buffers with 2MB hugepages (MAP_HUGETLB, falling back to transparent hugepages if the pool is empty)
+    bool lock; //mlock each buffer so that it is never paged out
+    bool verbose;
+} streamBufferConfig_t;
+
+//Sets the options used for every buffer allocated afterwards.  Must be called before any streaming thread is started
+void streamBufferConfigure(const streamBufferConfig_t* config);
+
+//Returns the NUMA node of the given CPU or -1 if it is not known (or cpu is negative)
+int streamBufferCpuNode(int cpu);
+
+//Allocates a zeroed buffer of at least size bytes.  numaNode is the preferred node (-1 for the node of the calling
+//thread).  name is used in the placement report.  Returns NULL on failure
+void* streamBufferAlloc(size_t size, int numaNode, const char* name);
+
+//Frees a buffer returned by streamBufferAlloc.  NULL is ignored
+void streamBufferFree(void* buf);
+
+#endif //UHDTOPIPES_STREAMBUFFER_H
@@ -0,0 +1,201 @@
+//
+// Lock-free per-thread counters which are exported as JSON lines over a Unix socket.
+//
+
+#define _GNU_SOURCE
+#include "telemetry.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define TELEMETRY_MAX_CLIENTS (8)
+#define TELEMETRY_POLL_MS (100) //Bounds how long it takes to notice that streaming has stopped
+#define TELEMETRY_LINE_LEN (4096)
+
+static const char* telemetryThreadNames[TELEMETRY_NUM_THREADS] = {
+        "rxHandler",
+        "rxWriter",
+        "txReader",
+        "txHandler",
+        "txAsync"
+};
+
+void telemetryInit(telemetry_t* telemetry){
+    for(int thread = 0; thread<TELEMETRY_NUM_THREADS; thread++){
+        telemetryCounters_t* counters = &telemetry->threads[thread];
+        atomic_init(&counters->samples, 0);
+        atomic_init(&counters->blocks, 0);
+        atomic_init(&counters->bytes, 0);
+        atomic_init(&counters->calls, 0);
+        atomic_init(&counters->syscalls, 0);
+        atomic_init(&counters->callNs, 0);
+        atomic_init(&counters->blockedNs, 0);
+        atomic_init(&counters->errors, 0);
+    }
+    telemetry->rxRing = NULL;
+    telemetry->txRing = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &telemetry->startTime);
+}
+
+//Appends to buf, keeping track of the length used.  Output past the end of buf is dropped
+static void telemetryAppend(char* buf, size_t len, size_t* used, const char* format, ...) __attribute__((format(printf, 4, 5)));
+static void telemetryAppend(char* buf, size_t len, size_t* used, const char* format, ...){
+    if(*used >= len-1){
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int written = vsnprintf(buf + *used, len - *used, format, args);
+    va_end(args);
+    if(written > 0){
+        *used += (size_t) written;
+        if(*used > len-1){
+            *used = len-1;
+        }
+    }
+}
+
+//The ring indexes are read from another thread so the occupancy can briefly exceed the depth
+static size_t telemetryRingFill(spscRing_t* ring){
+    size_t occupancy = spscRingOccupancy(ring);
+    return occupancy > ring->numBlocks ? ring->numBlocks : occupancy;
+}
+
+size_t telemetrySnapshot(telemetry_t* telemetry, char* buf, size_t len){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double uptime = (now.tv_sec - telemetry->startTime.tv_sec) + (now.tv_nsec - telemetry->startTime.tv_nsec)*1e-9;
+
+    size_t used = 0;
+    telemetryAppend(buf, len, &used, "{\"uptime\":%.3f", uptime);
+    if(telemetry->rxRing != NULL){
+        telemetryAppend(buf, len, &used, ",\"rxRing\":{\"fill\":%zu,\"depth\":%zu}",
+                        telemetryRingFill(telemetry->rxRing), telemetry->rxRing->numBlocks);
+    }
+    if(telemetry->txRing != NULL){
+        telemetryAppend(buf, len, &used, ",\"txRing\":{\"fill\":%zu,\"depth\":%zu}",
+                        telemetryRingFill(telemetry->txRing), telemetry->txRing->numBlocks);
+    }
+    telemetryAppend(buf, len, &used, ",\"threads\":{");
+    for(int thread = 0; thread<TELEMETRY_NUM_THREADS; thread++){
+        telemetryCounters_t* counters = &telemetry->threads[thread];
+        telemetryAppend(buf, len, &used,
+                        "%s\"%s\":{\"samples\":%" PRIuFAST64 ",\"blocks\":%" PRIuFAST64 ",\"bytes\":%" PRIuFAST64
+                        ",\"calls\":%" PRIuFAST64 ",\"syscalls\":%" PRIuFAST64 ",\"callNs\":%" PRIuFAST64
+                        ",\"blockedNs\":%" PRIuFAST64 ",\"errors\":%" PRIuFAST64 "}",
+                        thread == 0 ? "" : ",", telemetryThreadNames[thread],
+                        atomic_load_explicit(&counters->samples, memory_order_relaxed),
+                        atomic_load_explicit(&counters->blocks, memory_order_relaxed),
+                        atomic_load_explicit(&counters->bytes, memory_order_relaxed),
+                        atomic_load_explicit(&counters->calls, memory_order_relaxed),
+                        atomic_load_explicit(&counters->syscalls, memory_order_relaxed),
+                        atomic_load_explicit(&counters->callNs, memory_order_relaxed),
+                        atomic_load_explicit(&counters->blockedNs, memory_order_relaxed),
+                        atomic_load_explicit(&counters->errors, memory_order_relaxed));
+    }
+    telemetryAppend(buf, len, &used, "}}\n");
+    return used;
+}
+
+//Sends the whole line without blocking.  A client which is not keeping up is dropped.  Returns false if the client
+//should be closed
+static bool telemetrySend(int client, const char* line, size_t len){
+    ssize_t sent = send(client, line, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+    return sent == (ssize_t) len;
+}
+
+void* telemetryServer(void* argsUncast){
+    telemetryServerArgs_t* args = (telemetryServerArgs_t*) argsUncast;
+    bool* terminateStatus = args->terminateStatus;
+    bool* done = args->done;
+    telemetry_t* telemetry = args->telemetry;
+    char* socketPath = args->socketPath;
+    int intervalMs = args->intervalMs;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(socketPath) >= sizeof(addr.sun_path)){
+        printf("Telemetry socket path is too long: %s\n", socketPath);
+        return NULL;
+    }
+    strcpy(addr.sun_path, socketPath);
+
+    int listenSocket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(listenSocket < 0){
+        printf("Unable to create telemetry socket\n");
+        perror(NULL);
+        return NULL;
+    }
+    unlink(socketPath); //Left over from a previous run
+    if(bind(listenSocket, (struct sockaddr*) &addr, sizeof(addr)) != 0 || listen(listenSocket, TELEMETRY_MAX_CLIENTS) != 0){
+        printf("Unable to listen on telemetry socket: %s\n", socketPath);
+        perror(NULL);
+        close(listenSocket);
+        return NULL;
+    }
+    printf("Telemetry on Unix socket: %s\n", socketPath);
+
+    int clients[TELEMETRY_MAX_CLIENTS];
+    int numClients = 0;
+    char line[TELEMETRY_LINE_LEN];
+    uint64_t nextReportNs = telemetryNowNs() + (uint64_t) intervalMs*1000000;
+    int pollMs = intervalMs > 0 && intervalMs < TELEMETRY_POLL_MS ? intervalMs : TELEMETRY_POLL_MS;
+
+    while(!*terminateStatus && !*done){
+        struct pollfd listenPoll = {.fd = listenSocket, .events = POLLIN, .revents = 0};
+        int pollStatus = poll(&listenPoll, 1, pollMs);
+        if(pollStatus < 0 && errno != EINTR){
+            printf("Error waiting on telemetry socket\n");
+            perror(NULL);
+            break;
+        }
+
+        if(pollStatus > 0 && (listenPoll.revents & POLLIN)){
+            int client = accept4(listenSocket, NULL, NULL, SOCK_CLOEXEC);
+            if(client >= 0){
+                size_t lineLen = telemetrySnapshot(telemetry, line, sizeof(line));
+                bool keep = telemetrySend(client, line, lineLen) && intervalMs > 0 && numClients < TELEMETRY_MAX_CLIENTS;
+                if(keep){
+                    clients[numClients++] = client;
+                }else{
+                    close(client);
+                }
+            }
+        }
+
+        uint64_t now = telemetryNowNs();
+        if(intervalMs > 0 && now >= nextReportNs){
+            nextReportNs = now + (uint64_t) intervalMs*1000000;
+            if(numClients > 0) {
+                size_t lineLen = telemetrySnapshot(telemetry, line, sizeof(line));
+                for (int clientInd = 0; clientInd < numClients;) {
+                    if (telemetrySend(clients[clientInd], line, lineLen)) {
+                        clientInd++;
+                    } else {
+                        close(clients[clientInd]);
+                        clients[clientInd] = clients[--numClients];
+                    }
+                }
+            }
+        }
+    }
+
+    //Send the final counts
+    size_t lineLen = telemetrySnapshot(telemetry, line, sizeof(line));
+    for(int clientInd = 0; clientInd < numClients; clientInd++){
+        telemetrySend(clients[clientInd], line, lineLen);
+        close(clients[clientInd]);
+    }
+    close(listenSocket);
+    unlink(socketPath);
+
+    return NULL;
+}
@@ -0,0 +1,76 @@
+//
+// Lock-free per-thread counters which are exported as JSON lines over a Unix socket.  The streaming threads only update
+// their own counters (no locks, no syscalls), all formatting and I/O is done by the telemetry server thread.
+//
+
+#ifndef UHDTOPIPES_TELEMETRY_H
+#define UHDTOPIPES_TELEMETRY_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "common.h"
+#include "spscRing.h"
+
+//Counters for one thread.  Each counter is only written by its thread so updates are relaxed load/store pairs rather
+//than locked read-modify-writes.  Each thread's counters start on their own cache line so that one thread's updates do not
+//invalidate the lines another thread is updating
+typedef struct{
+    _Alignas(CACHE_LINE_SIZE) atomic_uint_fast64_t samples; //Samples (per channel) received from or sent to the USRP
+    atomic_uint_fast64_t blocks; //Ring blocks produced or consumed
+    atomic_uint_fast64_t bytes; //Bytes moved to or from the USRP, pipe, or shared memory ring
+    atomic_uint_fast64_t calls; //UHD recv/send calls, or pipe/shared memory batches
+    atomic_uint_fast64_t syscalls; //Pipe read/write/vmsplice and futex calls
+    atomic_uint_fast64_t callNs; //Time spent in the UHD recv/send calls or pipe reads/writes (blocked on the pipe)
+    atomic_uint_fast64_t blockedNs; //Time spent waiting on the ring (full for a producer, empty for a consumer)
+    atomic_uint_fast64_t errors; //Overflows, timeouts, underflows, sequence errors, time errors
+} telemetryCounters_t;
+
+typedef enum{
+    TELEMETRY_RX_HANDLER,
+    TELEMETRY_RX_WRITER,
+    TELEMETRY_TX_READER,
+    TELEMETRY_TX_HANDLER,
+    TELEMETRY_TX_ASYNC,
+    TELEMETRY_NUM_THREADS
+} telemetryThread_e;
+
+//The counters of every thread, along with the rings (owned by mainThread) whose fill is reported
+typedef struct{
+    telemetryCounters_t threads[TELEMETRY_NUM_THREADS];
+    spscRing_t* rxRing; //NULL if Rx is not enabled
+    spscRing_t* txRing; //NULL if Tx is not enabled
+    struct timespec startTime;
+} telemetry_t;
+
+typedef struct{
+    bool* terminateStatus; //Used to periodically check if thread should terminate
+    bool* done; //Set by mainThread once the streaming threads have exited
+    telemetry_t* telemetry;
+    char* socketPath;
+    int intervalMs; //Period of the JSON lines sent to each connected client.  0 sends 1 line per connection
+} telemetryServerArgs_t;
+
+static inline uint64_t telemetryNowNs(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec*1000000000 + now.tv_nsec;
+}
+
+//Only the owning thread may call this
+static inline void telemetryAdd(atomic_uint_fast64_t* counter, uint64_t value){
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+void telemetryInit(telemetry_t* telemetry);
+
+//Formats the counters as a single JSON line (including the newline).  Returns the length (truncated to len-1)
+size_t telemetrySnapshot(telemetry_t* telemetry, char* buf, size_t len);
+
+//Listens on a Unix (SOCK_STREAM) socket.  Each client is sent a JSON line on connect and then every intervalMs until it
+//disconnects.  The socket is removed when the server exits
+void* telemetryServer(void* argsUncast);
+
+#endif //UHDTOPIPES_TELEMETRY_H
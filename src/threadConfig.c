@@ -0,0 +1,280 @@
+//
+// Placement (CPU list) and scheduling (policy and priority) of the threads created by uhdToPipes.
+//
+
+#define _GNU_SOURCE
+#include "threadConfig.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THREAD_CONFIG_DEFAULT_RT_PRIORITY (50)
+
+void threadConfigInit(threadConfig_t* config, const char* name){
+    config->name = name;
+    CPU_ZERO(&config->cpus);
+    config->pinned = false;
+    config->schedGiven = false;
+    config->policy = SCHED_OTHER;
+    config->priority = 0;
+}
+
+bool threadConfigParseCpuList(const char* list, cpu_set_t* cpus){
+    CPU_ZERO(cpus);
+    const char* pos = list;
+    while(*pos != '\0' && *pos != '\n'){
+        char* end;
+        long first = strtol(pos, &end, 10);
+        if(end == pos || first < 0 || first >= CPU_SETSIZE){
+            return false;
+        }
+        long last = first;
+        pos = end;
+        if(*pos == '-'){
+            pos++;
+            last = strtol(pos, &end, 10);
+            if(end == pos || last < first || last >= CPU_SETSIZE){
+                return false;
+            }
+            pos = end;
+        }
+        for(long cpu = first; cpu<=last; cpu++){
+            CPU_SET(cpu, cpus);
+        }
+        if(*pos == ','){
+            pos++;
+        }else if(*pos != '\0' && *pos != '\n'){
+            return false;
+        }
+    }
+    return CPU_COUNT(cpus) > 0;
+}
+
+bool threadConfigSetCpus(threadConfig_t* config, const char* list){
+    if(!threadConfigParseCpuList(list, &config->cpus)){
+        return false;
+    }
+    config->pinned = true;
+    return true;
+}
+
+bool threadConfigSetSched(threadConfig_t* config, const char* sched){
+    const char* priorityStr = strchr(sched, ':');
+    size_t policyLen = priorityStr != NULL ? (size_t) (priorityStr - sched) : strlen(sched);
+
+    int policy;
+    if(policyLen == 5 && strncmp(sched, "other", 5) == 0){
+        policy = SCHED_OTHER;
+    }else if(policyLen == 4 && strncmp(sched, "fifo", 4) == 0){
+        policy = SCHED_FIFO;
+    }else if(policyLen == 2 && strncmp(sched, "rr", 2) == 0){
+        policy = SCHED_RR;
+    }else{
+        return false;
+    }
+
+    int priority = policy == SCHED_OTHER ? 0 : THREAD_CONFIG_DEFAULT_RT_PRIORITY;
+    if(priorityStr != NULL){
+        char* end;
+        priority = (int) strtol(priorityStr+1, &end, 10);
+        if(end == priorityStr+1 || *end != '\0'){
+            return false;
+        }
+    }
+    if(priority < sched_get_priority_min(policy) || priority > sched_get_priority_max(policy)){
+        return false;
+    }
+
+    config->schedGiven = true;
+    config->policy = policy;
+    config->priority = priority;
+    return true;
+}
+
+int threadConfigFirstCpu(const threadConfig_t* config){
+    if(!config->pinned){
+        return -1;
+    }
+    for(int cpu = 0; cpu<CPU_SETSIZE; cpu++){
+        if(CPU_ISSET(cpu, &config->cpus)){
+            return cpu;
+        }
+    }
+    return -1;
+}
+
+static const char* threadConfigPolicyName(int policy){
+    switch(policy){
+        case SCHED_FIFO:
+            return "SCHED_FIFO";
+        case SCHED_RR:
+            return "SCHED_RR";
+        default:
+            return "SCHED_OTHER";
+    }
+}
+
+//Formats the CPUs as a list of ranges (ex. 2-3,8)
+static void threadConfigFormatCpus(const cpu_set_t* cpus, char* str, size_t len){
+    size_t offset = 0;
+    str[0] = '\0';
+    for(int cpu = 0; cpu<CPU_SETSIZE && offset<len; cpu++){
+        if(!CPU_ISSET(cpu, cpus)){
+            continue;
+        }
+        int last = cpu;
+        while(last+1<CPU_SETSIZE && CPU_ISSET(last+1, cpus)){
+            last++;
+        }
+        if(last > cpu){
+            offset += snprintf(str+offset, len-offset, "%s%d-%d", offset > 0 ? "," : "", cpu, last);
+        }else{
+            offset += snprintf(str+offset, len-offset, "%s%d", offset > 0 ? "," : "", cpu);
+        }
+        cpu = last;
+    }
+}
+
+int threadConfigCreate(pthread_t* thread, const threadConfig_t* config, void* (*startRoutine)(void*), void* args){
+    pthread_attr_t attributes;
+    int status = pthread_attr_init(&attributes);
+    if(status != 0){
+        errno = status;
+        return status;
+    }
+
+    if(config->pinned){
+        status = pthread_attr_setaffinity_np(&attributes, sizeof(cpu_set_t), &config->cpus);
+        if(status != 0){
+            pthread_attr_destroy(&attributes);
+            errno = status;
+            return status;
+        }
+    }
+
+    if(config->schedGiven){
+        struct sched_param param = {.sched_priority = config->priority};
+        status = pthread_attr_setinheritsched(&attributes, PTHREAD_EXPLICIT_SCHED);
+        if(status == 0){
+            status = pthread_attr_setschedpolicy(&attributes, config->policy);
+        }
+        if(status == 0){
+            status = pthread_attr_setschedparam(&attributes, &param);
+        }
+        if(status != 0){
+            pthread_attr_destroy(&attributes);
+            errno = status;
+            return status;
+        }
+    }
+
+    status = pthread_create(thread, &attributes, startRoutine, args);
+    if(status == EPERM && config->schedGiven){
+        fprintf(stderr, "Not permitted to set %s priority %d for the %s thread (requires CAP_SYS_NICE or an RLIMIT_RTPRIO allowance), using the inherited scheduling\n",
+                threadConfigPolicyName(config->policy), config->priority, config->name);
+        pthread_attr_setinheritsched(&attributes, PTHREAD_INHERIT_SCHED);
+        status = pthread_create(thread, &attributes, startRoutine, args);
+    }
+    pthread_attr_destroy(&attributes);
+
+    if(status != 0){
+        errno = status; //So that the caller can report the error with perror
+        return status;
+    }
+
+    char name[16];
+    snprintf(name, sizeof(name), "%s", config->name);
+    pthread_setname_np(*thread, name);
+    return 0;
+}
+
+//Reads a CPU list from sysfs (ex. /sys/devices/system/cpu/isolated).  The set is empty if the file does not exist or is
+//empty
+static void threadConfigReadCpuList(const char* path, cpu_set_t* cpus){
+    CPU_ZERO(cpus);
+    FILE* file = fopen(path, "r");
+    if(file == NULL){
+        return;
+    }
+    char list[1024];
+    if(fgets(list, sizeof(list), file) != NULL && !threadConfigParseCpuList(list, cpus)){
+        CPU_ZERO(cpus);
+    }
+    fclose(file);
+}
+
+//Returns the thread (other than self) pinned to cpu or NULL if there is none
+static const threadConfig_t* threadConfigCpuUser(const threadConfig_t* const* configs, int numConfigs,
+                                                 const threadConfig_t* self, int cpu){
+    for(int configInd = 0; configInd<numConfigs; configInd++){
+        const threadConfig_t* other = configs[configInd];
+        if(other != self && other->pinned && CPU_ISSET(cpu, &other->cpus)){
+            return other;
+        }
+    }
+    return NULL;
+}
+
+void threadConfigCheck(const threadConfig_t* const* configs, int numConfigs){
+    //CPUs with no other tasks scheduled (isolcpus) or with the scheduler tick stopped (nohz_full)
+    cpu_set_t isolated;
+    cpu_set_t nohzFull;
+    threadConfigReadCpuList("/sys/devices/system/cpu/isolated", &isolated);
+    threadConfigReadCpuList("/sys/devices/system/cpu/nohz_full", &nohzFull);
+    cpu_set_t quiet;
+    CPU_OR(&quiet, &isolated, &nohzFull);
+
+    for(int configInd = 0; configInd<numConfigs; configInd++){
+        const threadConfig_t* config = configs[configInd];
+        if(!config->pinned && !config->schedGiven){
+            continue;
+        }
+
+        char cpuList[256] = "any";
+        if(config->pinned){
+            threadConfigFormatCpus(&config->cpus, cpuList, sizeof(cpuList));
+        }
+        if(config->schedGiven){
+            fprintf(stderr, "Thread %s: CPUs %s, %s priority %d\n", config->name, cpuList,
+                    threadConfigPolicyName(config->policy), config->priority);
+        }else{
+            fprintf(stderr, "Thread %s: CPUs %s, inherited scheduling\n", config->name, cpuList);
+        }
+        if(!config->pinned){
+            continue;
+        }
+
+        cpu_set_t notQuiet;
+        CPU_XOR(&notQuiet, &config->cpus, &quiet);
+        CPU_AND(&notQuiet, &notQuiet, &config->cpus);
+        if(CPU_COUNT(&notQuiet) > 0){
+            threadConfigFormatCpus(&notQuiet, cpuList, sizeof(cpuList));
+            fprintf(stderr, "Warning: CPUs %s of the %s thread are not isolated (isolcpus or nohz_full), other tasks may add jitter\n",
+                    cpuList, config->name);
+        }
+
+        for(int cpu = 0; cpu<CPU_SETSIZE; cpu++){
+            if(!CPU_ISSET(cpu, &config->cpus)){
+                continue;
+            }
+            char path[96];
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+            cpu_set_t siblings;
+            threadConfigReadCpuList(path, &siblings);
+            for(int sibling = 0; sibling<CPU_SETSIZE; sibling++){
+                if(sibling == cpu || !CPU_ISSET(sibling, &siblings) || CPU_ISSET(sibling, &config->cpus)){
+                    continue;
+                }
+                const threadConfig_t* user = threadConfigCpuUser(configs, numConfigs, config, sibling);
+                if(user != NULL){
+                    fprintf(stderr, "Warning: CPU %d of the %s thread shares a core (SMT sibling) with CPU %d of the %s thread\n",
+                            cpu, config->name, sibling, user->name);
+                }else if(!CPU_ISSET(sibling, &quiet)){
+                    fprintf(stderr, "Warning: CPU %d of the %s thread shares a core (SMT sibling) with CPU %d which is not isolated\n",
+                            cpu, config->name, sibling);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,48 @@
+//
+// Placement (CPU list) and scheduling (policy and priority) of the threads created by uhdToPipes.  Every thread is
+// created with threadConfigCreate so that the configuration is applied the same way to each of them.
+//
+
+#ifndef UHDTOPIPES_THREADCONFIG_H
+#define UHDTOPIPES_THREADCONFIG_H
+
+//cpu_set_t requires _GNU_SOURCE to be defined before any system header is included
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+
+typedef struct{
+    const char* name; //Used in reports and as the name of the thread (truncated to 15 characters)
+    cpu_set_t cpus;
+    bool pinned; //When false, the thread inherits the affinity of the thread which creates it
+    bool schedGiven; //When false, the thread inherits the scheduling of the thread which creates it
+    int policy; //SCHED_OTHER, SCHED_FIFO, or SCHED_RR
+    int priority; //1 (lowest) to 99 for SCHED_FIFO and SCHED_RR, 0 for SCHED_OTHER
+} threadConfig_t;
+
+//Not pinned with inherited scheduling
+void threadConfigInit(threadConfig_t* config, const char* name);
+
+//Parses a CPU list (ex. 2 or 2,3 or 4-7,12) into cpus.  Returns false if the list is invalid
+bool threadConfigParseCpuList(const char* list, cpu_set_t* cpus);
+
+//Pins the thread to the CPUs in the list.  Returns false if the list is invalid
+bool threadConfigSetCpus(threadConfig_t* config, const char* list);
+
+//Parses a scheduling policy with an optional priority: other, fifo[:priority], or rr[:priority] (the priority defaults
+//to 50).  Returns false if the policy or priority is invalid
+bool threadConfigSetSched(threadConfig_t* config, const char* sched);
+
+//Returns the lowest numbered CPU the thread is pinned to or -1 if it is not pinned
+int threadConfigFirstCpu(const threadConfig_t* config);
+
+//Creates the thread with the configured affinity and scheduling.  If the real time policy cannot be set (the process
+//does not have CAP_SYS_NICE or an RLIMIT_RTPRIO allowance), a warning is printed and the thread is created with the
+//inherited scheduling.  Returns 0 on success or the error number (also set in errno) on failure
+int threadConfigCreate(pthread_t* thread, const threadConfig_t* config, void* (*startRoutine)(void*), void* args);
+
+//Prints the CPUs and scheduling of each configured thread and warns when a pinned CPU is not isolated (isolcpus or
+//nohz_full) or shares a core (is an SMT sibling of) a CPU which is used by another thread or is not isolated
+void threadConfigCheck(const threadConfig_t* const* configs, int numConfigs);
+
+#endif //UHDTOPIPES_THREADCONFIG_H
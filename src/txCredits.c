@@ -0,0 +1,122 @@
+//
+// Credit based flow control for the Tx feedback pipe.
+//
+
+#include "txCredits.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+int txCreditsInit(txCredits_t* credits, int window, int batch, txCreditReturn_e returnOn){
+    credits->window = window;
+    credits->batch = batch > 0 ? batch : window/8;
+    if(credits->batch < 1){
+        credits->batch = 1;
+    }
+    if(credits->batch > window){
+        credits->batch = window;
+    }
+    credits->returnOn = returnOn;
+    atomic_init(&credits->feedbackPipe, -1);
+
+    credits->pending = 0;
+    credits->blocksAcked = 0;
+    pipeIOStatsInit(&credits->stats);
+    credits->creditsReturned = 0;
+    credits->writes = 0;
+
+    credits->burstEnds = NULL;
+    credits->burstEndsLen = 0;
+    atomic_init(&credits->burstEndHead, 0);
+    atomic_init(&credits->burstEndTail, 0);
+    if(returnOn == TX_CREDIT_RETURN_ACK){
+        credits->burstEndsLen = window+1;
+        credits->burstEnds = malloc(credits->burstEndsLen*sizeof(uint64_t));
+        if(credits->burstEnds == NULL){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void txCreditsFree(txCredits_t* credits){
+    int feedbackPipe = atomic_load_explicit(&credits->feedbackPipe, memory_order_acquire);
+    if(feedbackPipe >= 0){
+        close(feedbackPipe);
+        atomic_store_explicit(&credits->feedbackPipe, -1, memory_order_relaxed);
+    }
+    free(credits->burstEnds);
+    credits->burstEnds = NULL;
+}
+
+int txCreditsGrant(txCredits_t* credits, int feedbackPipe){
+    FEEDBACK_DATATYPE fbVal = credits->window;
+    if(pipeIOWriteAll(feedbackPipe, &fbVal, sizeof(FEEDBACK_DATATYPE), &credits->stats) != 0){
+        return -1;
+    }
+    //Release so that the thread returning credits sees the grant before it can write to the pipe
+    atomic_store_explicit(&credits->feedbackPipe, feedbackPipe, memory_order_release);
+    return 0;
+}
+
+int txCreditsReturn(txCredits_t* credits, size_t numBlocks, bool flush, telemetryCounters_t* telemetry){
+    credits->pending += numBlocks;
+    if(credits->pending == 0 || (!flush && credits->pending < (size_t) credits->batch)){
+        return 0;
+    }
+
+    //Blocks can only be sent once the feedback pipe has been opened so this only holds the credits when termination is
+    //requested before the producer connects
+    int feedbackPipe = atomic_load_explicit(&credits->feedbackPipe, memory_order_acquire);
+    if(feedbackPipe < 0){
+        return 0;
+    }
+
+    FEEDBACK_DATATYPE fbVal = credits->pending;
+    size_t syscallsBefore = credits->stats.syscalls;
+    if(pipeIOWriteAll(feedbackPipe, &fbVal, sizeof(FEEDBACK_DATATYPE), &credits->stats) != 0){
+        return -1;
+    }
+    telemetryAdd(&telemetry->syscalls, credits->stats.syscalls - syscallsBefore);
+    credits->creditsReturned += credits->pending;
+    credits->writes++;
+    credits->pending = 0;
+    return 0;
+}
+
+void txCreditsBurstEnd(txCredits_t* credits, uint64_t blocksSent){
+    size_t head = atomic_load_explicit(&credits->burstEndHead, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&credits->burstEndTail, memory_order_acquire);
+    if(head - tail >= credits->burstEndsLen){
+        //Only possible if the producer overspends its credits.  The next ACK returns the credits for this burst as well
+        return;
+    }
+    credits->burstEnds[head % credits->burstEndsLen] = blocksSent;
+    atomic_store_explicit(&credits->burstEndHead, head+1, memory_order_release);
+}
+
+int txCreditsBurstAck(txCredits_t* credits, telemetryCounters_t* telemetry){
+    size_t tail = atomic_load_explicit(&credits->burstEndTail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&credits->burstEndHead, memory_order_acquire);
+    if(tail == head){
+        return 0; //An ACK for a burst which was not ended by a framed block
+    }
+    uint64_t blocksSent = credits->burstEnds[tail % credits->burstEndsLen];
+    atomic_store_explicit(&credits->burstEndTail, tail+1, memory_order_release);
+
+    //Each ACK is returned immediately, a burst is already a batch of blocks
+    size_t numBlocks = blocksSent - credits->blocksAcked;
+    credits->blocksAcked = blocksSent;
+    return txCreditsReturn(credits, numBlocks, true, telemetry);
+}
+
+bool txCreditsAwaitingAck(txCredits_t* credits){
+    return atomic_load_explicit(&credits->burstEndHead, memory_order_acquire) !=
+           atomic_load_explicit(&credits->burstEndTail, memory_order_relaxed);
+}
+
+void txCreditsReport(txCredits_t* credits){
+    fprintf(stderr, "Tx credits: window %d blocks, returned %zu credits in %zu feedback writes (%.1f blocks/write), %zu held\n",
+            credits->window, credits->creditsReturned, credits->writes,
+            credits->writes > 0 ? ((double) credits->creditsReturned)/credits->writes : 0.0, credits->pending);
+}
@@ -0,0 +1,79 @@
+//
+// Credit based flow control for the Tx feedback pipe.
+//
+// The producer of the Tx pipe is granted an initial window of credits (blocks) which is written to the feedback pipe as
+// soon as it is opened.  The producer spends 1 credit for each block it writes to the Tx pipe and must stop when it has
+// none left.  Credits are returned (as FEEDBACK_DATATYPE block counts which may be more than 1, unlike the per-read
+// feedback which is a 1 for each block) once the blocks have been handed to the USRP, or once the USRP has ACKed the end
+// of the burst containing them, and are batched so that the feedback pipe is written once per batch rather than once per
+// block.
+//
+
+#ifndef UHDTOPIPES_TXCREDITS_H
+#define UHDTOPIPES_TXCREDITS_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "pipeIO.h"
+#include "telemetry.h"
+#include "common.h"
+
+//Number of async message timeouts (0.1s each) the Tx async monitor waits for the last burst ACKs after Tx stops
+#define TX_CREDIT_ACK_DRAIN_POLLS (10)
+
+//When the credits for a block are returned to the producer
+typedef enum{
+    TX_CREDIT_RETURN_SEND, //Once all of the samples in the block have been passed to uhd_tx_streamer_send (by the Tx handler)
+    TX_CREDIT_RETURN_ACK //Once the USRP ACKs the end of the burst containing the block (by the Tx async monitor, framed Tx only)
+} txCreditReturn_e;
+
+typedef struct{
+    int window; //Credits granted to the producer when the feedback pipe is opened
+    int batch; //Credits are held until at least this many can be returned (unless flushed)
+    txCreditReturn_e returnOn;
+    _Atomic int feedbackPipe; //Set by the Tx pipe reader once the feedback pipe is open and the window has been granted (-1 before)
+
+    //---- Only accessed by the thread returning credits ----
+    size_t pending; //Credits waiting to be returned
+    uint64_t blocksAcked; //TX_CREDIT_RETURN_ACK: blocks covered by the burst ACKs received so far
+    pipeIOStats_t stats;
+    size_t creditsReturned;
+    size_t writes;
+
+    //---- TX_CREDIT_RETURN_ACK: the number of blocks sent up to the end of each burst awaiting an ACK ----
+    //The producer cannot have more than window blocks outstanding so at most window bursts are awaiting an ACK
+    uint64_t* burstEnds; //window+1 entries
+    size_t burstEndsLen;
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t burstEndHead; //Written by the Tx handler
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t burstEndTail; //Written by the Tx async monitor
+} txCredits_t;
+
+//batch of 0 selects a batch of 1/8 of the window.  Returns 0 on success or -1 if the burst end queue could not be allocated
+int txCreditsInit(txCredits_t* credits, int window, int batch, txCreditReturn_e returnOn);
+//Closes the feedback pipe (once the Tx threads have been joined)
+void txCreditsFree(txCredits_t* credits);
+
+//Called by the Tx pipe reader once the feedback pipe is open.  Writes the initial window.  Returns 0 on success or -1 on
+//error (errno is set)
+int txCreditsGrant(txCredits_t* credits, int feedbackPipe);
+
+//Adds numBlocks to the credits waiting to be returned and writes them to the feedback pipe if there are at least a batch
+//(or flush is set).  Must only be called by a single thread.  Returns 0 on success or -1 on error (errno is set)
+int txCreditsReturn(txCredits_t* credits, size_t numBlocks, bool flush, telemetryCounters_t* telemetry);
+
+//Called by the Tx handler before the sends of a block which ends a burst.  blocksSent includes the block
+void txCreditsBurstEnd(txCredits_t* credits, uint64_t blocksSent);
+
+//Called by the Tx async monitor for each burst ACK.  Returns the credits for the blocks up to the end of the oldest
+//burst awaiting an ACK.  Returns 0 on success or -1 on error (errno is set)
+int txCreditsBurstAck(txCredits_t* credits, telemetryCounters_t* telemetry);
+
+//Returns true if there are bursts which have been sent but not ACKed
+bool txCreditsAwaitingAck(txCredits_t* credits);
+
+//Prints the number of credits returned and the feedback pipe writes used
+void txCreditsReport(txCredits_t* credits);
+
+#endif //UHDTOPIPES_TXCREDITS_H
@@ -5,78 +5,273 @@
 #define _GNU_SOURCE
 #include "txHandler.h"
 #include "common.h"
+#include "interleave.h"
+#include "pipeFrame.h"
+#include "pipeIO.h"
+#include "streamBuffer.h"
+#include "txPacer.h"
+#include <fcntl.h>
+#include <limits.h>
 #include <uhd.h>
 #include <time.h>
 #include <unistd.h>
 
+//Copies numSamples samples, starting at srcSampleInd in the pipe block, to dst in the interleaved format used by UHD
+static void txPackSamples(pipeFormat_e pipeFormat, interleave_t interleave, size_t componentSize, char* pipeSamples,
+                          int samplesPerTransactTx, int srcSampleInd, char* dst, int numSamples){
+    if(pipeFormat == PIPE_FORMAT_INTERLEAVED){
+        memcpy(dst, pipeSamples+srcSampleInd*componentSize*2, numSamples*componentSize*2);
+    }else{
+        interleave(pipeSamples+srcSampleInd*componentSize, pipeSamples+(samplesPerTransactTx+srcSampleInd)*componentSize, dst, numSamples);
+    }
+}
+
+//uhd_tx_streamer_send, recording the time spent in the call
+static uhd_error txStreamerSend(uhd_tx_streamer_handle tx_streamer, const void** buffs, size_t numSamples,
+                               uhd_tx_metadata_handle* md, size_t* numSent, telemetryCounters_t* telemetry){
+    uint64_t callStart = telemetryNowNs();
+    uhd_error status = uhd_tx_streamer_send(tx_streamer, buffs, numSamples, md, 10, numSent);
+    telemetryAdd(&telemetry->callNs, telemetryNowNs() - callStart);
+    telemetryAdd(&telemetry->calls, 1);
+    telemetryAdd(&telemetry->samples, *numSent);
+    return status;
+}
+
+//Metadata used for the sends of a framed Tx pipe.  The metadata cannot be modified so the metadata for the start of a
+//burst is rebuilt from each header which starts a burst or has a time
+typedef struct{
+    uhd_tx_metadata_handle start; //Rebuilt for each block which starts a burst or has a time
+    uhd_tx_metadata_handle middle; //No time, not the start or end of a burst
+    uhd_tx_metadata_handle end; //End of burst (no time)
+} txFramedMetadata_t;
+
+//Sends the first numSamples samples of one block from a framed Tx pipe (or of the block interpolated from it).  Samples
+//are never carried over to the next block so that the time in the header applies to the first sample of the block.
+//Returns false if an error occurred
+static bool txSendFramedBlock(uhd_tx_streamer_handle tx_streamer, txFramedMetadata_t* framedMd, const txFrameHeader_t* header,
+                              char* pipeSamples, size_t numSamples, size_t numChannels, pipeFormat_e pipeFormat,
+                              interleave_t interleave, size_t componentSize, int samplesPerTransactTx, char* buff,
+                              size_t samps_per_buff, const void** sendBuffs, telemetryCounters_t* telemetry){
+    size_t sampleSize = componentSize*2;
+    size_t channelBlockSize = samplesPerTransactTx*sampleSize;
+
+    bool hasTime = header->flags & TX_FRAME_FLAG_HAS_TIME;
+    bool startOfBurst = header->flags & TX_FRAME_FLAG_START_OF_BURST;
+    bool endOfBurst = header->flags & TX_FRAME_FLAG_END_OF_BURST;
+
+    uhd_tx_metadata_handle firstMd = framedMd->middle;
+    if(hasTime || startOfBurst){
+        if(framedMd->start != NULL){
+            uhd_tx_metadata_free(&framedMd->start);
+        }
+        //If the block is sent with a single send, it is also the end of the burst
+        bool singleSend = numSamples <= samps_per_buff;
+        if(uhd_tx_metadata_make(&framedMd->start, hasTime, header->fullSecs, header->fracSecs, startOfBurst, endOfBurst && singleSend)){
+            framedMd->start = NULL;
+            printf("Error creating Tx metadata\n");
+            return false;
+        }
+        firstMd = framedMd->start;
+    }
+
+    //An end of burst with no samples is sent as an empty packet
+    size_t srcSampleInd = 0;
+    do{
+        size_t samplesToSend = numSamples - srcSampleInd;
+        if(samplesToSend > samps_per_buff){
+            samplesToSend = samps_per_buff;
+        }
+        bool lastSend = srcSampleInd + samplesToSend == numSamples;
+
+        uhd_tx_metadata_handle md = srcSampleInd == 0 ? firstMd : framedMd->middle;
+        if(lastSend && endOfBurst && md == framedMd->middle){
+            md = framedMd->end;
+        }
+
+        for(size_t chan = 0; chan<numChannels; chan++) {
+            char* chanPipeSamples = pipeSamples + chan*channelBlockSize;
+            if (pipeFormat == PIPE_FORMAT_INTERLEAVED) {
+                sendBuffs[chan] = chanPipeSamples + srcSampleInd * sampleSize;
+            } else {
+                char* chanBuff = buff + chan*samps_per_buff*sampleSize;
+                txPackSamples(pipeFormat, interleave, componentSize, chanPipeSamples, samplesPerTransactTx, srcSampleInd, chanBuff, samplesToSend);
+                sendBuffs[chan] = chanBuff;
+            }
+        }
+
+        size_t num_samps_sent = 0;
+        uhd_error status = txStreamerSend(tx_streamer, sendBuffs, samplesToSend, &md, &num_samps_sent, telemetry);
+        if(status){
+            printf("Error sending to USRP\n");
+            return false;
+        }
+        if(num_samps_sent != samplesToSend){
+            printf("Unable to send complete Tx block to the FPGA within the timeout\n");
+            return false;
+        }
+        srcSampleInd += samplesToSend;
+    }while(srcSampleInd < numSamples);
+
+    return true;
+}
+
+//Interpolates the first numSamples samples of each channel's block within the pipe block into the interpolated block
+//(which holds the interleaved samples of each channel in turn)
+static void txInterpolateBlock(firInterpolator_t* interpolator, pipeFormat_e pipeFormat, char* pipeSamples,
+                               int samplesPerTransactTx, size_t numSamples, char* interpSamples, const void** interpSrcs,
+                               void** interpDsts){
+    size_t sampleSize = sampleFormatComponentSize(interpolator->format)*2;
+    for(size_t chan = 0; chan<interpolator->numChannels; chan++){
+        interpSrcs[chan] = pipeSamples + chan*samplesPerTransactTx*sampleSize;
+        interpDsts[chan] = interpSamples + chan*samplesPerTransactTx*interpolator->factor*sampleSize;
+    }
+    firInterpolate(interpolator, pipeFormat, interpSrcs, samplesPerTransactTx, numSamples, interpDsts);
+}
+
+//Records the time each block was read from the pipe (or shared memory ring), before the blocks are committed to the ring
+static void txStampBlocks(spscRing_t* txRing, size_t numBlocks, uint64_t* blockStamps){
+    if(blockStamps == NULL){
+        return;
+    }
+    uint64_t now = telemetryNowNs();
+    for(size_t block = 0; block<numBlocks; block++){
+        blockStamps[spscRingSlot(txRing, spscRingPeekWrite(txRing, block))] = now;
+    }
+}
+
+//Records the time from the block being read to now (once all of its samples have been sent)
+static void txRecordLatency(spscRing_t* txRing, char* block, uint64_t* blockStamps, latencyHist_t* latency){
+    if(latency != NULL){
+        latencyHistRecord(latency, telemetryNowNs() - blockStamps[spscRingSlot(txRing, block)]);
+    }
+}
+
+//Returns the credits for a block once it has been sent (when credits are returned on send).  Returns false if the
+//feedback pipe could not be written
+static bool txBlockSent(txCredits_t* credits, telemetryCounters_t* telemetry){
+    if(credits == NULL || credits->returnOn != TX_CREDIT_RETURN_SEND){
+        return true;
+    }
+    if(txCreditsReturn(credits, 1, false, telemetry) != 0){
+        printf("An error was encountered while writing the Tx feedback pipe\n");
+        perror(NULL);
+        return false;
+    }
+    return true;
+}
+
 void* txHandler(void* argsUncast) {
     txHandlerArgs_t* args = (txHandlerArgs_t*) argsUncast;
     bool* terminateStatus = args->terminateStatus;
-    char* txPipeName = args->txPipeName;
-    char* txFeedbackPipeName = args->txFeedbackPipeName;
+    spscRing_t* txRing = args->txRing;
     uhd_tx_streamer_handle tx_streamer = args->tx_streamer;
     uhd_tx_metadata_handle tx_md = args->tx_md;
     int samplesPerTransactTx = args->samplesPerTransactTx;
+    size_t numChannels = args->numChannels;
+    int interpolation = args->interpolation > 1 ? args->interpolation : 1;
+    bool interpolating = interpolation > 1;
+    int txPrefillBlocks = args->txPrefillBlocks;
+    pipeFormat_e pipeFormat = args->pipeFormat;
+    sampleFormat_e cpuFormat = args->cpuFormat;
     bool forceFullTxBuffer = args->forceFullTxBuffer;
+    bool framed = args->framed;
     bool verbose = args->verbose;
     bool txRateLimit = args->txRateLimit;
-    int txRate = args->txRate;
+    double txRate = args->txRate;
+    int txRateBurst = args->txRateBurst;
+    uint64_t* blockStamps = args->blockStamps;
+    latencyHist_t* latency = args->latency;
+    txCredits_t* credits = args->credits;
+    telemetryCounters_t* telemetry = args->telemetry;
 
     size_t samps_per_buff;
     uhd_error status = uhd_tx_streamer_max_num_samps(tx_streamer, &samps_per_buff);
     if(status){
         printf("Could not retrieve max number of Tx samples ... exiting\n");
+        *terminateStatus = true; //Inform the Tx pipe reader to stop
         return NULL;
     }
 
     fprintf(stderr, "Buffer size in samples (Tx): %zu\n", samps_per_buff);
-    float *buff = calloc(sizeof(float), samps_per_buff * 2);
-    const void **buffs_ptr = (const void **) &buff;
+    //The reblocking is independent of the sample type, only the size of each component matters
+    size_t componentSize = sampleFormatComponentSize(cpuFormat);
+    size_t sampleSize = componentSize*2;
+    interleave_t interleave = interleaveKernel(componentSize);
+    size_t channelBlockSize = samplesPerTransactTx*sampleSize; //Size of each channel's block within a ring block
 
-    //Note: the samples are complex floats which have a real component followed by an imagionary component
+    //buff and samplesRemainder hold the samples of each channel in turn.  They are allocated by this thread so that they
+    //are placed on the node of the Tx CPU
+    char *buff = streamBufferAlloc(numChannels*sampleSize*samps_per_buff, -1, "Tx send buffer");
+    const void** sendBuffs = malloc(numChannels*sizeof(void*)); //The send source for each channel
 
-    // Set up pipes
-    FILE *txPipe = fopen(txPipeName, "rb");
-    if(txPipe == NULL){
-        printf("Unable to Open Tx Pipe: %s\n", txPipeName);
-        perror(NULL);
-        exit(1);
-    }
-    printf("Opened Tx Pipe: %s\n", txPipeName);
+    //Note: the samples are complex which have a real component followed by an imagionary component
 
-    FILE *txFeedbackPipe = NULL;
-    if(txFeedbackPipeName != NULL){
-        txFeedbackPipe = fopen(txFeedbackPipeName, "wb");
-        if(txFeedbackPipe == NULL){
-            printf("Unable to Open Tx Feedback Pipe: %s\n", txFeedbackPipeName);
-            perror(NULL);
-            exit(1);
+    char* samplesRemainder = streamBufferAlloc(numChannels*samps_per_buff*sampleSize, -1, "Tx remainder");
+    int numRemainingSamples = 0;
+
+    //With interpolation, each block is interpolated into interpSamples which is then reblocked in place of the pipe
+    //block.  The interpolated block is interleaved so it can be sent without being copied
+    int sendBlockSamples = samplesPerTransactTx*interpolation;
+    pipeFormat_e sendFormat = interpolating ? PIPE_FORMAT_INTERLEAVED : pipeFormat;
+    size_t sendChannelBlockSize = sendBlockSamples*sampleSize;
+    firInterpolator_t interpolator;
+    char* interpSamples = NULL;
+    const void** interpSrcs = NULL;
+    void** interpDsts = NULL;
+    if(interpolating){
+        interpSamples = streamBufferAlloc(numChannels*sendChannelBlockSize, -1, "Tx interpolated block");
+        interpSrcs = malloc(numChannels*sizeof(void*));
+        interpDsts = malloc(numChannels*sizeof(void*));
+        if(interpSamples == NULL || interpSrcs == NULL || interpDsts == NULL ||
+           firInterpolatorInit(&interpolator, args->interpTaps, interpolation, numChannels, cpuFormat, samplesPerTransactTx) != 0){
+            printf("Could not allocate the Tx interpolator ... exiting\n");
+            *terminateStatus = true; //Inform the Tx pipe reader to stop
+            streamBufferFree(buff);
+            free(sendBuffs);
+            streamBufferFree(samplesRemainder);
+            streamBufferFree(interpSamples);
+            free(interpSrcs);
+            free(interpDsts);
+            return NULL;
         }
-        printf("Opened Tx Feedback Pipe: %s\n", txFeedbackPipeName);
     }
-    
-    printf("Samples Per Tx on Pipe: %d\n", samplesPerTransactTx);
-
-    float* pipeSamples = malloc(samplesPerTransactTx*2*sizeof(float));
-    float* pipeSamplesRe = pipeSamples;
-    float* pipeSamplesIm = pipeSamples+samplesPerTransactTx;
-    float* samplesRemainder = malloc(samps_per_buff*2*sizeof(float));
-    int numRemainingSamples = 0;
 
     int terminateCheckCounter = 0;
 
-    bool running = true;
-    struct timespec startTime;
-    int timeStatus = clock_gettime(CLOCK_REALTIME, &startTime);
-    if(timeStatus == -1){
-        printf("Unable to get time");
-        perror(NULL);
-        exit(1);
+    //Ring occupancy statistics (sampled each time a block is taken from the ring)
+    size_t minRingOccupancy = txRing->numBlocks;
+    size_t ringOccupancySum = 0;
+    size_t ringOccupancySamples = 0;
+    size_t ringEmptyStalls = 0;
+
+    uint64_t blocksSent = 0; //Blocks taken from the ring whose samples have all been passed to the USRP
+
+    //Wait for the Tx pipe reader to get ahead before starting to stream.  With the shm transport, the producer must
+    //first open the ring (like opening a FIFO)
+    bool running = spscRingWaitForPeer(txRing, terminateStatus);
+    fprintf(stderr, "Waiting for %d blocks in Tx ring before streaming\n", txPrefillBlocks);
+    running = running && spscRingWaitForOccupancy(txRing, txPrefillBlocks, terminateStatus);
+
+    //With framing, the metadata comes from the frame headers rather than tx_md
+    txFramedMetadata_t framedMd = {.start = NULL, .middle = NULL, .end = NULL};
+    if(framed){
+        if(uhd_tx_metadata_make(&framedMd.middle, false, 0, 0, false, false) ||
+           uhd_tx_metadata_make(&framedMd.end, false, 0, 0, false, true)){
+            printf("Error creating Tx metadata ... exiting\n");
+            running = false;
+            *terminateStatus = true; //Inform the Tx pipe reader to stop
+        }
     }
-    double startTimeDbl = startTime.tv_sec + startTime.tv_nsec*1e-9;
 
-    int64_t samplesSent = 0;
-    double tgtRate = 1.01*txRate;
+    //The pacer runs slightly fast (1.01x the Tx rate) so that the USRP's buffer stays full.  The USRP applies the
+    //backpressure which sets the actual rate.  The pacer counts pipe samples so, with interpolation, it runs at the
+    //pipe rate
+    txPacer_t pacer;
+    if(txRateLimit){
+        double burst = txRateBurst > 0 ? txRateBurst : ((double) samps_per_buff)/interpolation;
+        txPacerInit(&pacer, 1.01*txRate/interpolation, burst);
+        fprintf(stderr, "Pacing Tx to %.0f samples/s with a burst of %.0f samples\n", pacer.rate, pacer.burst);
+    }
 
     while(running) {
         if (terminateCheckCounter > TERMINATE_CHECK_ITTERATIONS) {
@@ -89,143 +284,504 @@ void* txHandler(void* argsUncast) {
             terminateCheckCounter++;
         }
 
-        bool execute = true;
-
-        //TODO: Come up with a more elegant solution
-        if(txRateLimit){
-            struct timespec currentTime;
-            int timeStatus = clock_gettime(CLOCK_REALTIME, &currentTime);
-            if(timeStatus == -1){
-                printf("Unable to get time");
-                perror(NULL);
-                exit(1);
-            }
-            double currentTimeDbl = currentTime.tv_sec + currentTime.tv_nsec*1e-9;
-            double durationSec = currentTimeDbl - startTimeDbl;
-            double rate = samplesSent/durationSec;
-            if(rate>tgtRate){
-                execute = false;
-            }
+        size_t ringOccupancy = spscRingOccupancy(txRing);
+        if(ringOccupancy < minRingOccupancy){
+            minRingOccupancy = ringOccupancy;
         }
+        ringOccupancySum += ringOccupancy;
+        ringOccupancySamples++;
 
-        if(execute){
-            int elementsRead = fread(pipeSamples, sizeof(float), samplesPerTransactTx*2, txPipe);
-            if(feof(txPipe)){
-                running = false; //Not actually needed
-                *terminateStatus = true; //Inform other threads to stop (Tx pipe closed)
-                break;
-            }else if(elementsRead != samplesPerTransactTx*2 && ferror(txPipe)){
-                printf("An error was encountered while reading the Tx pipe\n");
+        char* pipeSamples = spscRingTryAcquireRead(txRing);
+        if(pipeSamples == NULL){
+            //The Tx pipe reader has fallen behind (the USRP may underflow)
+            ringEmptyStalls++;
+            //Return any held credits so that a producer waiting on them is not stalled by the batching
+            if(credits != NULL && credits->returnOn == TX_CREDIT_RETURN_SEND && txCreditsReturn(credits, 0, true, telemetry) != 0){
+                printf("An error was encountered while writing the Tx feedback pipe\n");
                 perror(NULL);
-                *terminateStatus = true; //Inform other threads to stop (Tx pipe error)
-                running = false; //Not actually needed
+                *terminateStatus = true; //Inform other threads to stop (Tx feedback pipe error)
                 break;
-            }else if(elementsRead != samplesPerTransactTx*2){
-                printf("An unknown error was encountered while reading the Tx pipe\n");
-                *terminateStatus = true; //Inform other threads to stop (Tx pipe error)
+            }
+            uint64_t waitStart = telemetryNowNs();
+            pipeSamples = spscRingAcquireRead(txRing, terminateStatus);
+            telemetryAdd(&telemetry->blockedNs, telemetryNowNs() - waitStart);
+            if(pipeSamples == NULL){
+                //Either the Tx pipe was closed and the ring has been drained or another thread requested termination
                 running = false; //Not actually needed
+                *terminateStatus = true; //Inform other threads to stop (Tx pipe closed)
                 break;
             }
+        }
+        if(verbose){
+            fprintf(stderr, "Tx ring occupancy: %zu blocks\n", ringOccupancy);
+        }
 
-            //Report Feedback if Pipe Exists
-            //Note: Feedback is in terms of samplesPerTransactTx not samps_per_buff
-            if(txFeedbackPipe != NULL) {
-                FEEDBACK_DATATYPE fbVal = 1; //Right now, we are reading 1 block at a time.
-                fwrite(&fbVal, sizeof(FEEDBACK_DATATYPE), 1, txFeedbackPipe);
-                fflush(txFeedbackPipe);
-                if(verbose){
-                    fprintf(stderr, "Wrote %d Feedback Pipe\n", fbVal);
+        if(framed){
+            const txFrameHeader_t* header = (const txFrameHeader_t*) pipeSamples;
+            char* framedSamples = pipeSamples + sizeof(txFrameHeader_t);
+            size_t numSamples = header->numSamples < (uint32_t) samplesPerTransactTx ? header->numSamples : (size_t) samplesPerTransactTx;
+            //Sleep until the block is due.  Only the samples actually in the block are charged (a short block at the
+            //end of a burst is due sooner)
+            if(txRateLimit){
+                txPacerWait(&pacer, numSamples);
+            }
+            //The burst end is recorded before the send as the USRP can ACK the burst before the send returns
+            bool endOfBurst = header->flags & TX_FRAME_FLAG_END_OF_BURST;
+            if(endOfBurst && credits != NULL && credits->returnOn == TX_CREDIT_RETURN_ACK){
+                txCreditsBurstEnd(credits, blocksSent+1);
+            }
+            if(interpolating){
+                //A new burst does not follow on from the samples before it (the time in the header applies to the
+                //first interpolated sample).  The filter's tail at the end of a burst is not sent
+                if(header->flags & TX_FRAME_FLAG_START_OF_BURST){
+                    firInterpolatorReset(&interpolator);
                 }
+                txInterpolateBlock(&interpolator, pipeFormat, framedSamples, samplesPerTransactTx, numSamples,
+                                   interpSamples, interpSrcs, interpDsts);
+                framedSamples = interpSamples;
+                numSamples *= interpolation;
             }
+            if(!txSendFramedBlock(tx_streamer, &framedMd, header, framedSamples, numSamples, numChannels, sendFormat,
+                                  interleave, componentSize, sendBlockSamples, buff, samps_per_buff, sendBuffs, telemetry)){
+                running = false; //not actually needed
+                *terminateStatus = true;
+                break;
+            }
+            //Done with this block, return it to the Tx pipe reader
+            txRecordLatency(txRing, pipeSamples, blockStamps, latency);
+            spscRingReleaseRead(txRing);
+            telemetryAdd(&telemetry->blocks, 1);
+            telemetryAdd(&telemetry->bytes, numChannels*channelBlockSize);
+            blocksSent++;
+            if(!txBlockSent(credits, telemetry)){
+                *terminateStatus = true; //Inform other threads to stop (Tx feedback pipe error)
+                break;
+            }
+            continue;
+        }
 
-            //Find number of tx transactions per block
-            int numTransmissions = (samplesPerTransactTx+numRemainingSamples)/samps_per_buff;
-            int sampsReamining = (samplesPerTransactTx+numRemainingSamples)%samps_per_buff;
-            int srcSampleInd = 0;
+        //Sleep until the block is due
+        if(txRateLimit){
+            txPacerWait(&pacer, samplesPerTransactTx);
+        }
+
+        //The samples are sent from sendSamples (the pipe block or, with interpolation, the interpolated block)
+        char* sendSamples = pipeSamples;
+        if(interpolating){
+            txInterpolateBlock(&interpolator, pipeFormat, pipeSamples, samplesPerTransactTx, samplesPerTransactTx,
+                               interpSamples, interpSrcs, interpDsts);
+            sendSamples = interpSamples;
+        }
+
+        //Find number of tx transactions per block
+        int numTransmissions = (sendBlockSamples+numRemainingSamples)/samps_per_buff;
+        int sampsReamining = (sendBlockSamples+numRemainingSamples)%samps_per_buff;
+        int srcSampleInd = 0;
+
+        for(int block = 0; block < numTransmissions; block++){
+            int dstIndOffset = numRemainingSamples;
+            numRemainingSamples = 0;
+            int samplesToTransferFromSrcArray = samps_per_buff-dstIndOffset;
+
+            for(size_t chan = 0; chan<numChannels; chan++) {
+                char* chanBuff = buff + chan*samps_per_buff*sampleSize;
+                char* chanPipeSamples = sendSamples + chan*sendChannelBlockSize;
 
-            for(int block = 0; block < numTransmissions; block++){
                 //Copy any remaining samples (if any)
-                if(numRemainingSamples>0) {
-                    memcpy(buff, samplesRemainder, sizeof(float)*2*numRemainingSamples);
+                if (dstIndOffset > 0) {
+                    memcpy(chanBuff, samplesRemainder + chan*samps_per_buff*sampleSize, sampleSize * dstIndOffset);
                 }
-                int dstIndOffset = numRemainingSamples;
-                numRemainingSamples = 0;
 
                 //Copy samples from pipe block
-                int samplesToTransferFromSrcArray = samps_per_buff-dstIndOffset;
-                for(int i = 0; i<samplesToTransferFromSrcArray; i++){
-                    buff[dstIndOffset*2+2*i] = pipeSamplesRe[srcSampleInd+i];
-                    buff[dstIndOffset*2+2*i+1] = pipeSamplesIm[srcSampleInd+i];
-                }
-                srcSampleInd += samplesToTransferFromSrcArray;
-
-                size_t num_samps_sent = 0;
-                uhd_error status = uhd_tx_streamer_send(tx_streamer, buffs_ptr, samps_per_buff, &tx_md, 10, &num_samps_sent);
-                samplesSent+=num_samps_sent;
-                if(status){
-                    running = false; //not actually needed
-                    *terminateStatus = true;
-                    printf("Error sending to USRP\n");
-                    break;
-                }
-                if(num_samps_sent != samps_per_buff){
-                    running = false; //not actually needed
-                    *terminateStatus = true;
-                    printf("Unable to send complete Tx block to the FPGA within the timeout\n");
-                    break;
+                //If the pipe block is already interleaved and there are no samples from the previous block, it can be
+                //sent directly
+                sendBuffs[chan] = chanBuff;
+                if (sendFormat == PIPE_FORMAT_INTERLEAVED && dstIndOffset == 0) {
+                    sendBuffs[chan] = chanPipeSamples + srcSampleInd * sampleSize;
+                } else {
+                    txPackSamples(sendFormat, interleave, componentSize, chanPipeSamples, sendBlockSamples, srcSampleInd, chanBuff + dstIndOffset * sampleSize, samplesToTransferFromSrcArray);
                 }
+            }
+            srcSampleInd += samplesToTransferFromSrcArray;
 
-                if(verbose){
-                    fprintf(stderr, "Sent %zu samples to USRP\n", num_samps_sent);
-                }
+            size_t num_samps_sent = 0;
+            uhd_error status = txStreamerSend(tx_streamer, sendBuffs, samps_per_buff, &tx_md, &num_samps_sent, telemetry);
+            if(status){
+                running = false; //not actually needed
+                *terminateStatus = true;
+                printf("Error sending to USRP\n");
+                break;
+            }
+            if(num_samps_sent != samps_per_buff){
+                running = false; //not actually needed
+                *terminateStatus = true;
+                printf("Unable to send complete Tx block to the FPGA within the timeout\n");
+                break;
             }
 
-            //TODO: Handle the remaining samples
-            //Either partially fill another buffer or place it in the remainder
-            if(forceFullTxBuffer){
-                //Copy remaining samples to remainder buffer
-                int numToTransferToRemainder = sampsReamining-numRemainingSamples;
-                for(int i = 0; i<numToTransferToRemainder; i++){
-                    samplesRemainder[numRemainingSamples*2+i*2] = pipeSamplesRe[srcSampleInd+i];
-                    samplesRemainder[numRemainingSamples*2+i*2+1] = pipeSamplesIm[srcSampleInd+i];
-                }
-                numRemainingSamples += numToTransferToRemainder; //This is += to handle the case when the number of received samples is less than the block size
-            }else{
-                //Partially fill a buffer and send it
-                //Remainder cannot exist in this case because no remainder will ever be stored
-                for(int i = 0; i<sampsReamining; i++){
-                    buff[2*i] = pipeSamplesRe[srcSampleInd+i];
-                    buff[2*i+1] = pipeSamplesIm[srcSampleInd+i];
-                }
-                //Do not need to incremnet srcSampleInd since this is the last transmission for this block and it will be reset on the next iteration
-                size_t num_samps_sent = 0;
-                uhd_error status = uhd_tx_streamer_send(tx_streamer, buffs_ptr, sampsReamining, &tx_md, 10, &num_samps_sent);
-                samplesSent+=num_samps_sent;
-                if(status){
-                    running = false; //not actually needed
-                    *terminateStatus = true;
-                    printf("Error sending to USRP\n");
-                    break;
+            if(verbose){
+                fprintf(stderr, "Sent %zu samples to USRP\n", num_samps_sent);
+            }
+        }
+
+        //TODO: Handle the remaining samples
+        //Either partially fill another buffer or place it in the remainder
+        if(forceFullTxBuffer){
+            //Copy remaining samples to remainder buffer
+            int numToTransferToRemainder = sampsReamining-numRemainingSamples;
+            for(size_t chan = 0; chan<numChannels; chan++) {
+                char* chanRemainder = samplesRemainder + chan*samps_per_buff*sampleSize;
+                txPackSamples(sendFormat, interleave, componentSize, sendSamples + chan*sendChannelBlockSize, sendBlockSamples, srcSampleInd, chanRemainder+numRemainingSamples*sampleSize, numToTransferToRemainder);
+            }
+            numRemainingSamples += numToTransferToRemainder; //This is += to handle the case when the number of received samples is less than the block size
+        }else{
+            //Partially fill a buffer and send it
+            //Remainder cannot exist in this case because no remainder will ever be stored
+            for(size_t chan = 0; chan<numChannels; chan++) {
+                char* chanBuff = buff + chan*samps_per_buff*sampleSize;
+                char* chanPipeSamples = sendSamples + chan*sendChannelBlockSize;
+                sendBuffs[chan] = chanBuff;
+                if (sendFormat == PIPE_FORMAT_INTERLEAVED) {
+                    sendBuffs[chan] = chanPipeSamples + srcSampleInd * sampleSize;
+                } else {
+                    txPackSamples(sendFormat, interleave, componentSize, chanPipeSamples, sendBlockSamples, srcSampleInd, chanBuff, sampsReamining);
                 }
-                if(num_samps_sent != sampsReamining){
-                    running = false; //not actually needed
-                    *terminateStatus = true;
-                    printf("Unable to send complete Tx block to the FPGA within the timeout\n");
-                    break;
+            }
+            //Do not need to incremnet srcSampleInd since this is the last transmission for this block and it will be reset on the next iteration
+            size_t num_samps_sent = 0;
+            uhd_error status = txStreamerSend(tx_streamer, sendBuffs, sampsReamining, &tx_md, &num_samps_sent, telemetry);
+            if(status){
+                running = false; //not actually needed
+                *terminateStatus = true;
+                printf("Error sending to USRP\n");
+                break;
+            }
+            if(num_samps_sent != (size_t) sampsReamining){
+                running = false; //not actually needed
+                *terminateStatus = true;
+                printf("Unable to send complete Tx block to the FPGA within the timeout\n");
+                break;
+            }
+
+            if(verbose){
+                fprintf(stderr, "Sent %zu samples\n", num_samps_sent);
+            }
+
+            //Not needed since this is not used elsewhere
+            numTransmissions++; //Increment numTransmissions for reporting on the feedback pipe
+        }
+
+        //Done with this block, return it to the Tx pipe reader
+        txRecordLatency(txRing, pipeSamples, blockStamps, latency);
+        spscRingReleaseRead(txRing);
+        telemetryAdd(&telemetry->blocks, 1);
+        telemetryAdd(&telemetry->bytes, numChannels*channelBlockSize);
+        blocksSent++;
+        if(!txBlockSent(credits, telemetry)){
+            *terminateStatus = true; //Inform other threads to stop (Tx feedback pipe error)
+            break;
+        }
+    }
+
+    //Return the credits held for the last partial batch
+    if(credits != NULL && credits->returnOn == TX_CREDIT_RETURN_SEND){
+        txCreditsReturn(credits, 0, true, telemetry);
+    }
+
+    if(txRateLimit){
+        txPacerReport(&pacer);
+    }
+
+    fprintf(stderr, "Tx ring: min occupancy %zu/%zu blocks, avg occupancy %.1f blocks, %zu stalls waiting for the Tx pipe reader\n",
+            ringOccupancySamples > 0 ? minRingOccupancy : 0, txRing->numBlocks,
+            ringOccupancySamples > 0 ? ((double) ringOccupancySum)/ringOccupancySamples : 0.0, ringEmptyStalls);
+
+    if(framedMd.start != NULL){
+        uhd_tx_metadata_free(&framedMd.start);
+    }
+    if(framedMd.middle != NULL){
+        uhd_tx_metadata_free(&framedMd.middle);
+    }
+    if(framedMd.end != NULL){
+        uhd_tx_metadata_free(&framedMd.end);
+    }
+
+    streamBufferFree(buff);
+    free(sendBuffs);
+    streamBufferFree(samplesRemainder);
+    if(interpolating){
+        firInterpolatorFree(&interpolator);
+        streamBufferFree(interpSamples);
+        free(interpSrcs);
+        free(interpDsts);
+    }
+
+    return NULL;
+}
+
+void* txPipeReader(void* argsUncast) {
+    txPipeReaderArgs_t* args = (txPipeReaderArgs_t*) argsUncast;
+    bool* terminateStatus = args->terminateStatus;
+    char** txPipeNames = args->txPipeNames;
+    int numTxPipes = args->numTxPipes;
+    char* txFeedbackPipeName = args->txFeedbackPipeName;
+    spscRing_t* txRing = args->txRing;
+    int samplesPerTransactTx = args->samplesPerTransactTx;
+    size_t numChannels = args->numChannels;
+    size_t sampleSize = sampleFormatComponentSize(args->cpuFormat)*2;
+    int pipeBatchBlocks = args->pipeBatchBlocks;
+    uint64_t* blockStamps = args->blockStamps;
+    txCredits_t* credits = args->credits;
+    telemetryCounters_t* telemetry = args->telemetry;
+    bool verbose = args->verbose;
+
+    //With a single pipe, the blocks of all channels are read in turn.  Otherwise, each pipe supplies its channel's block
+    size_t channelBlockSize = samplesPerTransactTx*sampleSize;
+    //With framing (only supported with a single pipe), the header is read as part of the block
+    size_t pipeBlockSize = numTxPipes == 1 ? numChannels*channelBlockSize : channelBlockSize;
+    if(args->framed){
+        pipeBlockSize += sizeof(txFrameHeader_t);
+    }
+
+    // Set up pipes
+    int txPipes[MAX_CHANNELS];
+    for(int pipeInd = 0; pipeInd<numTxPipes; pipeInd++) {
+        txPipes[pipeInd] = open(txPipeNames[pipeInd], O_RDONLY);
+        if (txPipes[pipeInd] < 0) {
+            printf("Unable to Open Tx Pipe: %s\n", txPipeNames[pipeInd]);
+            perror(NULL);
+            exit(1);
+        }
+        printf("Opened Tx Pipe: %s\n", txPipeNames[pipeInd]);
+    }
+
+    int txFeedbackPipe = -1;
+    if(txFeedbackPipeName != NULL){
+        txFeedbackPipe = open(txFeedbackPipeName, O_WRONLY);
+        if(txFeedbackPipe < 0){
+            printf("Unable to Open Tx Feedback Pipe: %s\n", txFeedbackPipeName);
+            perror(NULL);
+            exit(1);
+        }
+        printf("Opened Tx Feedback Pipe: %s\n", txFeedbackPipeName);
+
+        //With a credit window, the feedback pipe is owned by the thread returning the credits from here on
+        if(credits != NULL){
+            if(txCreditsGrant(credits, txFeedbackPipe) != 0){
+                printf("An error was encountered while writing the Tx feedback pipe\n");
+                perror(NULL);
+                exit(1);
+            }
+            printf("Granted %d Tx credits\n", credits->window);
+            txFeedbackPipe = -1;
+        }
+    }
+
+    printf("Samples Per Tx on Pipe: %d\n", samplesPerTransactTx);
+
+    if(pipeBatchBlocks > IOV_MAX){
+        pipeBatchBlocks = IOV_MAX;
+    }
+    struct iovec* iov = malloc(pipeBatchBlocks*sizeof(struct iovec));
+    //The per-read feedback is a 1 for each block read (as when blocks were read 1 at a time) so that producers which
+    //count the values on the feedback pipe are not affected by the batching.  A batch is written with 1 call
+    FEEDBACK_DATATYPE* feedbackOnes = malloc(pipeBatchBlocks*sizeof(FEEDBACK_DATATYPE));
+    for(int block = 0; block<pipeBatchBlocks; block++){
+        feedbackOnes[block] = 1;
+    }
+    pipeIOStats_t stats;
+    pipeIOStatsInit(&stats);
+    pipeIOStats_t feedbackStats;
+    pipeIOStatsInit(&feedbackStats);
+
+    while(true){
+        //Waits for the Tx handler to free a block.  Returns NULL if termination was requested
+        uint64_t waitStart = telemetryNowNs();
+        if(spscRingAcquireWrite(txRing, terminateStatus) == NULL){
+            break;
+        }
+        uint64_t callStart = telemetryNowNs();
+        telemetryAdd(&telemetry->blockedNs, callStart - waitStart);
+        size_t syscallsBefore = stats.syscalls;
+
+        //Read into as many free blocks as are available (up to the batch size).  The read returns once whatever is in
+        //the pipe has been read, as long as it ends on a block boundary, so batching does not add latency
+        size_t available = spscRingWriteAvailable(txRing);
+        int numBlocks = available < (size_t) pipeBatchBlocks ? (int) available : pipeBatchBlocks;
+        for(int block = 0; block<numBlocks; block++){
+            iov[block].iov_base = spscRingPeekWrite(txRing, block);
+            iov[block].iov_len = pipeBlockSize;
+        }
+
+        int blocksRead = pipeIOReadBlocks(txPipes[0], iov, numBlocks, &stats);
+
+        //Read the same number of blocks for the other channels
+        for(int pipeInd = 1; pipeInd<numTxPipes && blocksRead > 0; pipeInd++) {
+            for (int block = 0; block < blocksRead; block++) {
+                iov[block].iov_base = ((char*) spscRingPeekWrite(txRing, block)) + pipeInd*channelBlockSize;
+                iov[block].iov_len = pipeBlockSize;
+            }
+            blocksRead = pipeIOReadBlocksExact(txPipes[pipeInd], iov, blocksRead, &stats);
+        }
+        telemetryAdd(&telemetry->callNs, telemetryNowNs() - callStart);
+        telemetryAdd(&telemetry->syscalls, stats.syscalls - syscallsBefore);
+        telemetryAdd(&telemetry->calls, 1);
+
+        if(blocksRead == 0){
+            //EOF, the Tx handler will stop once it has sent the blocks already in the ring
+            break;
+        }else if(blocksRead < 0){
+            printf("An error was encountered while reading the Tx pipe\n");
+            perror(NULL);
+            *terminateStatus = true; //Inform other threads to stop (Tx pipe error)
+            break;
+        }
+
+        txStampBlocks(txRing, blocksRead, blockStamps);
+        spscRingCommitWriteN(txRing, blocksRead);
+        telemetryAdd(&telemetry->blocks, blocksRead);
+        telemetryAdd(&telemetry->bytes, blocksRead*pipeBlockSize*numTxPipes);
+
+        //Report Feedback if Pipe Exists (and credits are not returned by the Tx handler or Tx async monitor)
+        //Note: Feedback is in terms of samplesPerTransactTx not samps_per_buff
+        if(txFeedbackPipe >= 0) {
+            size_t feedbackSyscallsBefore = feedbackStats.syscalls;
+            if(pipeIOWriteAll(txFeedbackPipe, feedbackOnes, blocksRead*sizeof(FEEDBACK_DATATYPE), &feedbackStats) != 0){
+                printf("An error was encountered while writing the Tx feedback pipe\n");
+                perror(NULL);
+                *terminateStatus = true; //Inform other threads to stop (Tx feedback pipe error)
+                break;
+            }
+            telemetryAdd(&telemetry->syscalls, feedbackStats.syscalls - feedbackSyscallsBefore);
+            if(verbose){
+                fprintf(stderr, "Wrote %d x 1 Feedback Pipe\n", blocksRead);
+            }
+        }
+
+        if(verbose){
+            pipeIOStatsReport(&stats, "Tx pipe");
+        }
+    }
+
+    spscRingProducerDone(txRing);
+
+    for(int pipeInd = 0; pipeInd<numTxPipes; pipeInd++) {
+        close(txPipes[pipeInd]);
+    }
+    if(txFeedbackPipe >= 0){
+        close(txFeedbackPipe);
+    }
+    free(iov);
+    free(feedbackOnes);
+
+    return NULL;
+}
+
+//Gets the device time of an async message for reporting (0 if it does not have one)
+static double txAsyncTime(uhd_async_metadata_handle async_md){
+    bool hasTime = false;
+    int64_t fullSecs = 0;
+    double fracSecs = 0;
+    if(uhd_async_metadata_has_time_spec(async_md, &hasTime) == UHD_ERROR_NONE && hasTime){
+        uhd_async_metadata_time_spec(async_md, &fullSecs, &fracSecs);
+    }
+    return fullSecs + fracSecs;
+}
+
+void* txAsyncMonitor(void* argsUncast) {
+    txAsyncMonitorArgs_t* args = (txAsyncMonitorArgs_t*) argsUncast;
+    bool* terminateStatus = args->terminateStatus;
+    bool* txDone = args->txDone;
+    uhd_tx_streamer_handle tx_streamer = args->tx_streamer;
+    txAsyncCounters_t* counters = args->counters;
+    bool reportBurstAcks = args->reportBurstAcks;
+    txCredits_t* credits = args->credits;
+    bool returnCredits = credits != NULL && credits->returnOn == TX_CREDIT_RETURN_ACK;
+    telemetryCounters_t* telemetry = args->telemetry;
+    bool verbose = args->verbose;
+
+    uhd_async_metadata_handle async_md;
+    if(uhd_async_metadata_make(&async_md)){
+        printf("Error Creating Tx Async Metadata\n");
+        return NULL;
+    }
+
+    struct timespec lastReport;
+    clock_gettime(CLOCK_MONOTONIC, &lastReport);
+
+    //The timeout bounds how long it takes to notice that Tx has stopped.  When credits are returned on ACK, the ACKs for
+    //the last bursts can arrive after Tx has stopped so they are waited for (for up to TX_CREDIT_ACK_DRAIN_POLLS timeouts)
+    int drainPolls = 0;
+    while((!*terminateStatus && !*txDone) ||
+          (returnCredits && txCreditsAwaitingAck(credits) && drainPolls++ < TX_CREDIT_ACK_DRAIN_POLLS)){
+        bool valid = false;
+        uhd_error status = uhd_tx_streamer_recv_async_msg(tx_streamer, &async_md, 0.1, &valid);
+        if(status){
+            printf("Error receiving Tx async message from USRP\n");
+            break;
+        }
+
+        if(valid){
+            telemetryAdd(&telemetry->calls, 1);
+            uhd_async_metadata_event_code_t event_code;
+            if(uhd_async_metadata_event_code(async_md, &event_code) == UHD_ERROR_NONE) {
+                switch (event_code) {
+                    case UHD_ASYNC_METADATA_EVENT_CODE_UNDERFLOW:
+                    case UHD_ASYNC_METADATA_EVENT_CODE_UNDERFLOW_IN_PACKET:
+                        atomic_fetch_add_explicit(&counters->underflows, 1, memory_order_relaxed);
+                        telemetryAdd(&telemetry->errors, 1);
+                        break;
+                    case UHD_ASYNC_METADATA_EVENT_CODE_SEQ_ERROR:
+                    case UHD_ASYNC_METADATA_EVENT_CODE_SEQ_ERROR_IN_BURST:
+                        atomic_fetch_add_explicit(&counters->seqErrors, 1, memory_order_relaxed);
+                        telemetryAdd(&telemetry->errors, 1);
+                        break;
+                    case UHD_ASYNC_METADATA_EVENT_CODE_TIME_ERROR:
+                        atomic_fetch_add_explicit(&counters->timeErrors, 1, memory_order_relaxed);
+                        telemetryAdd(&telemetry->errors, 1);
+                        break;
+                    case UHD_ASYNC_METADATA_EVENT_CODE_BURST_ACK:
+                        atomic_fetch_add_explicit(&counters->burstAcks, 1, memory_order_relaxed);
+                        if(returnCredits && txCreditsBurstAck(credits, telemetry) != 0){
+                            printf("An error was encountered while writing the Tx feedback pipe\n");
+                            perror(NULL);
+                            *terminateStatus = true; //Inform other threads to stop (Tx feedback pipe error)
+                        }
+                        break;
+                    default:
+                        break;
                 }
 
-                if(verbose){
-                    fprintf(stderr, "Sent %zu samples\n", num_samps_sent);
+                bool isAck = event_code == UHD_ASYNC_METADATA_EVENT_CODE_BURST_ACK;
+                if ((isAck && reportBurstAcks) || (!isAck && verbose)) {
+                    size_t channel = 0;
+                    uhd_async_metadata_channel(async_md, &channel);
+                    fprintf(stderr, "Tx async message: event 0x%x on channel %zu at %f secs\n", event_code, channel, txAsyncTime(async_md));
                 }
+            }
+        }
 
-                //Not needed since this is not used elsewhere
-                numTransmissions++; //Increment numTransmissions for reporting on the feedback pipe
+        if(verbose){
+            struct timespec currentTime;
+            clock_gettime(CLOCK_MONOTONIC, &currentTime);
+            if(currentTime.tv_sec - lastReport.tv_sec >= 1){
+                fprintf(stderr, "Tx async: %zu underflows, %zu seq errors, %zu time errors, %zu burst ACKs\n",
+                        atomic_load_explicit(&counters->underflows, memory_order_relaxed),
+                        atomic_load_explicit(&counters->seqErrors, memory_order_relaxed),
+                        atomic_load_explicit(&counters->timeErrors, memory_order_relaxed),
+                        atomic_load_explicit(&counters->burstAcks, memory_order_relaxed));
+                lastReport = currentTime;
             }
         }
     }
 
-    free(buff);
-    free(samplesRemainder);
+    fprintf(stderr, "Tx async: %zu underflows, %zu seq errors, %zu time errors, %zu burst ACKs\n",
+            atomic_load_explicit(&counters->underflows, memory_order_relaxed),
+            atomic_load_explicit(&counters->seqErrors, memory_order_relaxed),
+            atomic_load_explicit(&counters->timeErrors, memory_order_relaxed),
+            atomic_load_explicit(&counters->burstAcks, memory_order_relaxed));
+
+    uhd_async_metadata_free(&async_md);
 
     return NULL;
-}
\ No newline at end of file
+}
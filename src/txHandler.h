@@ -9,22 +9,95 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "spscRing.h"
+#include "telemetry.h"
+#include "latencyHist.h"
+#include "txCredits.h"
+#include "polyphaseFir.h"
+#include "common.h"
 
 typedef struct{
     bool* terminateStatus; //Used to periodically check if thread should terminate
-    char* txPipeName;
-    char* txFeedbackPipeName;
+    spscRing_t* txRing; //Blocks are received from the Tx pipe reader thread through this ring
     uhd_tx_streamer_handle tx_streamer; //This is a pointer
     uhd_tx_metadata_handle tx_md; //This is a pointer
     int samplesPerTransactTx;
+    size_t numChannels; //Each block in the ring holds a block of samplesPerTransactTx samples for each channel in turn
+    int interpolation; //Each pipe sample is interpolated to this many samples before being sent (0 or 1 for none)
+    const firTaps_t* interpTaps; //Used when interpolating
+    int txPrefillBlocks; //Number of blocks which must be in the ring before streaming starts
+    pipeFormat_e pipeFormat;
+    sampleFormat_e cpuFormat; //The type of each component in the blocks
     bool forceFullTxBuffer;
-    bool txRateLimit;
-    int txRate;
+    bool framed; //Each block starts with a txFrameHeader_t giving the burst flags and the device time to send the block
+    bool txRateLimit; //Pace the blocks sent to the USRP with a token bucket
+    double txRate; //Samples per second (sent to the USRP, after interpolation)
+    int txRateBurst; //Size of the token bucket in pipe samples (0 for 1 Tx buffer)
+    uint64_t* blockStamps; //Set by the Tx pipe reader, indexed by ring slot.  NULL if latency is not measured
+    latencyHist_t* latency; //Time from the block being read from the pipe to its last send returning
+    txCredits_t* credits; //Credits are returned (or burst ends recorded) as blocks are sent.  NULL without a credit window
 
+    telemetryCounters_t* telemetry;
     bool verbose;
 } txHandlerArgs_t;
 
-//The input is a block of real samples concatinated with a block of imagionary samples
+typedef struct{
+    bool* terminateStatus; //Used to periodically check if thread should terminate
+    char** txPipeNames; //Either 1 pipe (carrying the blocks of all channels in turn) or 1 pipe per channel
+    int numTxPipes;
+    char* txFeedbackPipeName; //Not used with the shm transport (the free blocks in the shared memory ring are the credits)
+    spscRing_t* txRing; //Blocks are passed to the Tx handler thread through this ring
+    int samplesPerTransactTx;
+    size_t numChannels;
+    sampleFormat_e cpuFormat; //The type of each component in the blocks
+    int pipeBatchBlocks; //Maximum number of blocks read from the pipe with a single call
+    bool framed; //Each block starts with a txFrameHeader_t
+    pipeFormat_e pipeFormat; //Recorded in the header of the shared memory ring
+    uint64_t* blockStamps; //Time (telemetryNowNs) each block was read, indexed by ring slot.  NULL if latency is not measured
+    txCredits_t* credits; //The window is granted once the feedback pipe is opened.  NULL for the per-read feedback
+
+    telemetryCounters_t* telemetry;
+    bool verbose;
+} txPipeReaderArgs_t;
+
+//Counts of the async messages returned by the USRP for the Tx stream.  Updated by the Tx async monitor and can be read
+//from any thread
+typedef struct{
+    atomic_size_t underflows; //Includes underflows within a packet
+    atomic_size_t seqErrors; //Includes sequence errors within a burst
+    atomic_size_t timeErrors; //Packets which arrived after their send time
+    atomic_size_t burstAcks;
+} txAsyncCounters_t;
+
+typedef struct{
+    bool* terminateStatus; //Used to periodically check if thread should terminate
+    bool* txDone; //Set once the Tx handler has exited
+    uhd_tx_streamer_handle tx_streamer; //This is a pointer
+    txAsyncCounters_t* counters;
+    bool reportBurstAcks; //Print each burst ACK
+    txCredits_t* credits; //Credits are returned for each burst ACK when returned on ACK.  May be NULL
+
+    telemetryCounters_t* telemetry;
+    bool verbose;
+} txAsyncMonitorArgs_t;
+
+//Takes blocks from the Tx ring and sends them to the USRP
+//With the planar pipe format, the input is a block of real samples concatinated with a block of imagionary samples.
+//The type of each component is given by cpuFormat (fc32, sc16, or sc8).
+//With the interleaved pipe format, blocks are passed to the USRP without being copied (except to fill out a buffer with
+//samples from the previous block when forceFullTxBuffer is set)
+//With multiple channels, the block for each channel is sent with a single multi-channel send
+//With framing, the metadata for each send is built from the frame header so that bursts can be scheduled at a device time
+//With interpolation, each block is interpolated (into the interleaved format) before being reblocked.  The pacing and the
+//feedback are in pipe blocks and samples (before interpolation)
 void* txHandler(void* argsUncast);
 
+//Reads blocks from the Tx pipe into the Tx ring ahead of the Tx handler so that the Tx handler does not wait on the pipe
+//With 1 pipe per channel, the same number of blocks is read from each pipe so that the channels stay aligned
+void* txPipeReader(void* argsUncast);
+
+//Drains the async messages (underflow, sequence error, time error, burst ACK) returned by the USRP for the Tx stream and
+//counts them.  Runs alongside the Tx handler until it exits
+void* txAsyncMonitor(void* argsUncast);
+
 #endif //UHDTOPIPES_TXHANDLER_H
@@ -0,0 +1,74 @@
+//
+// Token bucket pacer used to limit the rate at which samples are sent to the USRP.
+//
+
+#define _GNU_SOURCE
+#include "txPacer.h"
+#include <errno.h>
+#include <stdio.h>
+
+static double txPacerElapsedNs(const struct timespec* from, const struct timespec* to){
+    return (to->tv_sec - from->tv_sec)*1e9 + (to->tv_nsec - from->tv_nsec);
+}
+
+static void txPacerRefill(txPacer_t* pacer, const struct timespec* now){
+    pacer->tokens += txPacerElapsedNs(&pacer->lastRefill, now)*1e-9*pacer->rate;
+    if(pacer->tokens > pacer->burst){
+        pacer->tokens = pacer->burst;
+    }
+    pacer->lastRefill = *now;
+}
+
+void txPacerInit(txPacer_t* pacer, double rate, double burst){
+    pacer->rate = rate;
+    pacer->burst = burst;
+    pacer->tokens = burst;
+    clock_gettime(CLOCK_MONOTONIC, &pacer->lastRefill);
+
+    pacer->startTime = pacer->lastRefill;
+    pacer->samplesPaced = 0;
+    pacer->sleeps = 0;
+    pacer->lateSumNs = 0;
+    pacer->lateMaxNs = 0;
+}
+
+void txPacerWait(txPacer_t* pacer, size_t numSamples){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    txPacerRefill(pacer, &now);
+
+    //A block larger than the bucket is sent once the bucket is full
+    double required = numSamples < pacer->burst ? numSamples : pacer->burst;
+    if(pacer->tokens < required){
+        //Sleep until enough tokens have accumulated
+        double waitNs = (required - pacer->tokens)/pacer->rate*1e9;
+        struct timespec deadline = now;
+        int64_t deadlineNs = deadline.tv_nsec + (int64_t) waitNs;
+        deadline.tv_sec += deadlineNs/1000000000;
+        deadline.tv_nsec = deadlineNs%1000000000;
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR){
+            //Interrupted by a signal, resume sleeping until the deadline
+        }
+        pacer->sleeps++;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double lateNs = txPacerElapsedNs(&deadline, &now);
+        pacer->lateSumNs += lateNs;
+        if(lateNs > pacer->lateMaxNs){
+            pacer->lateMaxNs = lateNs;
+        }
+        txPacerRefill(pacer, &now);
+    }
+
+    pacer->tokens -= numSamples;
+    pacer->samplesPaced += numSamples;
+}
+
+void txPacerReport(txPacer_t* pacer){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = txPacerElapsedNs(&pacer->startTime, &now)*1e-9;
+    fprintf(stderr, "Tx pacer: target %.0f samples/s, achieved %.0f samples/s, %zu sleeps, wake up late by avg %.1f us (max %.1f us)\n",
+            pacer->rate, elapsed > 0 ? pacer->samplesPaced/elapsed : 0.0, pacer->sleeps,
+            pacer->sleeps > 0 ? pacer->lateSumNs/pacer->sleeps*1e-3 : 0.0, pacer->lateMaxNs*1e-3);
+}
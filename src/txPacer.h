@@ -0,0 +1,40 @@
+//
+// Token bucket pacer used to limit the rate at which samples are sent to the USRP.
+//
+
+#ifndef UHDTOPIPES_TXPACER_H
+#define UHDTOPIPES_TXPACER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+//Tokens (samples) accumulate at rate up to a maximum of burst.  Sending a block consumes one token per sample.  When
+//there are not enough tokens for the next block, the pacer sleeps (clock_nanosleep with an absolute CLOCK_MONOTONIC
+//deadline) until the block is due rather than polling.
+typedef struct{
+    double rate; //Samples per second
+    double burst; //Maximum number of tokens (samples) which can accumulate while the sender is stalled
+    double tokens;
+    struct timespec lastRefill;
+
+    //---- Statistics ----
+    struct timespec startTime;
+    int64_t samplesPaced;
+    size_t sleeps;
+    double lateSumNs; //Sum of the time the pacer woke up after the deadline
+    double lateMaxNs;
+} txPacer_t;
+
+//The bucket starts full.  burst is in samples
+void txPacerInit(txPacer_t* pacer, double rate, double burst);
+
+//Waits until numSamples tokens are available then consumes them.  If numSamples is larger than the burst size, waits
+//until the bucket is full then consumes numSamples (leaving a deficit which must be repaid before the next block)
+void txPacerWait(txPacer_t* pacer, size_t numSamples);
+
+//Prints the achieved rate and the pacing error (how late the pacer woke up relative to the deadline)
+void txPacerReport(txPacer_t* pacer);
+
+#endif //UHDTOPIPES_TXPACER_H
@@ -0,0 +1,233 @@
+//
+// Checks each (de)interleave kernel variant supported by the CPU bit for bit against the scalar variant.
+//
+// Every component size is run for each length from 0 to TEST_MAX_SHORT_LEN (covering the vector bodies and every tail
+// length) and for a few large lengths, with the sources and destinations offset from the vector alignment (so the
+// unaligned heads and tails are exercised).  The
+// destinations are checked for writes past the end of the samples with guard bytes.
+//
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "interleave.h"
+
+#define TEST_MAX_SHORT_LEN (200)
+#define TEST_MAX_OFFSET (3) //In components, applied to the source and destinations
+#define TEST_GUARD_BYTES (64)
+#define TEST_GUARD (0xA5)
+
+static const size_t testLongLens[] = {1000, 4096, 65536, 65536+13};
+#define TEST_NUM_LONG_LENS (sizeof(testLongLens)/sizeof(testLongLens[0]))
+
+typedef enum{
+    TEST_ISA_SCALAR,
+    TEST_ISA_SSE2,
+    TEST_ISA_AVX2,
+    TEST_ISA_AVX512
+} testIsa_e;
+
+//A set of kernels, one for each component size (4, 2, and 1 bytes).  A NULL kernel has no variant for the ISA
+typedef struct{
+    const char* name;
+    testIsa_e isa;
+    deinterleave_t deinterleave[3];
+    interleave_t interleave[3];
+} testVariant_t;
+
+static const size_t testComponentSizes[] = {4, 2, 1};
+
+static const testVariant_t testVariants[] = {
+#if defined(__x86_64__) || defined(__i386__)
+        {"sse2", TEST_ISA_SSE2,
+         {deinterleave32SSE2, deinterleave16SSE2, deinterleave8SSE2},
+         {interleave32SSE2, interleave16SSE2, interleave8SSE2}},
+        {"avx2", TEST_ISA_AVX2,
+         {deinterleave32AVX2, deinterleave16AVX2, deinterleave8AVX2},
+         {interleave32AVX2, interleave16AVX2, interleave8AVX2}},
+        {"avx512", TEST_ISA_AVX512,
+         {deinterleave32AVX512, NULL, NULL},
+         {interleave32AVX512, NULL, NULL}},
+#endif
+};
+#define TEST_NUM_VARIANTS (sizeof(testVariants)/sizeof(testVariants[0]))
+
+static const deinterleave_t testScalarDeinterleave[3] = {deinterleave32Scalar, deinterleave16Scalar, deinterleave8Scalar};
+static const interleave_t testScalarInterleave[3] = {interleave32Scalar, interleave16Scalar, interleave8Scalar};
+
+static bool testIsaSupported(testIsa_e isa){
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    switch(isa){
+        case TEST_ISA_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case TEST_ISA_AVX2:
+            return __builtin_cpu_supports("avx2");
+        case TEST_ISA_AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2");
+        default:
+            return true;
+    }
+#else
+    return isa == TEST_ISA_SCALAR;
+#endif
+}
+
+//Fills len bytes with a pattern which differs in every byte (so that swapped or shifted components are caught)
+static void testFill(uint8_t* buff, size_t len, uint32_t seed){
+    uint32_t state = seed*2654435761u + 1;
+    for(size_t i = 0; i<len; i++){
+        state = state*1664525u + 1013904223u;
+        buff[i] = (uint8_t) (state >> 24);
+    }
+}
+
+static bool testGuardIntact(const uint8_t* guard){
+    for(size_t i = 0; i<TEST_GUARD_BYTES; i++){
+        if(guard[i] != TEST_GUARD){
+            return false;
+        }
+    }
+    return true;
+}
+
+//Runs a deinterleave variant and the scalar variant over the same input and compares the outputs.  Returns false on a
+//mismatch (which is printed)
+static bool testDeinterleave(const char* name, deinterleave_t kernel, deinterleave_t scalar, size_t componentSize,
+                             size_t numSamples, size_t srcOffset, size_t dstOffset){
+    size_t planeBytes = numSamples*componentSize;
+    size_t dstBytes = dstOffset*componentSize + planeBytes + TEST_GUARD_BYTES;
+    uint8_t* src = malloc(srcOffset*componentSize + 2*planeBytes + 1);
+    uint8_t* dstRe = malloc(dstBytes);
+    uint8_t* dstIm = malloc(dstBytes);
+    uint8_t* expectedRe = malloc(planeBytes + 1);
+    uint8_t* expectedIm = malloc(planeBytes + 1);
+    if(src == NULL || dstRe == NULL || dstIm == NULL || expectedRe == NULL || expectedIm == NULL){
+        printf("Unable to allocate the test buffers\n");
+        exit(1);
+    }
+
+    uint8_t* srcStart = src + srcOffset*componentSize;
+    testFill(srcStart, 2*planeBytes, (uint32_t) (numSamples*7 + componentSize));
+    memset(dstRe, TEST_GUARD, dstBytes);
+    memset(dstIm, TEST_GUARD, dstBytes);
+    uint8_t* dstReStart = dstRe + dstOffset*componentSize;
+    uint8_t* dstImStart = dstIm + dstOffset*componentSize;
+
+    scalar(srcStart, expectedRe, expectedIm, numSamples);
+    kernel(srcStart, dstReStart, dstImStart, numSamples);
+
+    bool pass = memcmp(dstReStart, expectedRe, planeBytes) == 0 && memcmp(dstImStart, expectedIm, planeBytes) == 0 &&
+                testGuardIntact(dstReStart + planeBytes) && testGuardIntact(dstImStart + planeBytes);
+    if(!pass){
+        printf("FAIL: deinterleave %s, %zu byte components, %zu samples, src offset %zu, dst offset %zu\n",
+               name, componentSize, numSamples, srcOffset, dstOffset);
+    }
+
+    free(src);
+    free(dstRe);
+    free(dstIm);
+    free(expectedRe);
+    free(expectedIm);
+    return pass;
+}
+
+//Runs an interleave variant and the scalar variant over the same input and compares the outputs.  Returns false on a
+//mismatch (which is printed)
+static bool testInterleave(const char* name, interleave_t kernel, interleave_t scalar, size_t componentSize,
+                           size_t numSamples, size_t srcOffset, size_t dstOffset){
+    size_t planeBytes = numSamples*componentSize;
+    size_t dstBytes = dstOffset*componentSize + 2*planeBytes + TEST_GUARD_BYTES;
+    uint8_t* srcRe = malloc(srcOffset*componentSize + planeBytes + 1);
+    uint8_t* srcIm = malloc(srcOffset*componentSize + planeBytes + 1);
+    uint8_t* dst = malloc(dstBytes);
+    uint8_t* expected = malloc(2*planeBytes + 1);
+    if(srcRe == NULL || srcIm == NULL || dst == NULL || expected == NULL){
+        printf("Unable to allocate the test buffers\n");
+        exit(1);
+    }
+
+    uint8_t* srcReStart = srcRe + srcOffset*componentSize;
+    uint8_t* srcImStart = srcIm + srcOffset*componentSize;
+    testFill(srcReStart, planeBytes, (uint32_t) (numSamples*7 + componentSize));
+    testFill(srcImStart, planeBytes, (uint32_t) (numSamples*11 + componentSize));
+    memset(dst, TEST_GUARD, dstBytes);
+    uint8_t* dstStart = dst + dstOffset*componentSize;
+
+    scalar(srcReStart, srcImStart, expected, numSamples);
+    kernel(srcReStart, srcImStart, dstStart, numSamples);
+
+    bool pass = memcmp(dstStart, expected, 2*planeBytes) == 0 && testGuardIntact(dstStart + 2*planeBytes);
+    if(!pass){
+        printf("FAIL: interleave %s, %zu byte components, %zu samples, src offset %zu, dst offset %zu\n",
+               name, componentSize, numSamples, srcOffset, dstOffset);
+    }
+
+    free(srcRe);
+    free(srcIm);
+    free(dst);
+    free(expected);
+    return pass;
+}
+
+//Runs every length and offset for a variant's kernel of one component size.  Returns the number of failures
+static int testVariantSize(const testVariant_t* variant, int sizeInd){
+    size_t componentSize = testComponentSizes[sizeInd];
+    int failures = 0;
+    for(size_t srcOffset = 0; srcOffset<=TEST_MAX_OFFSET; srcOffset++){
+        for(size_t dstOffset = 0; dstOffset<=TEST_MAX_OFFSET; dstOffset++){
+            for(size_t lenInd = 0; lenInd<=TEST_MAX_SHORT_LEN+TEST_NUM_LONG_LENS; lenInd++){
+                size_t len = lenInd<=TEST_MAX_SHORT_LEN ? lenInd : testLongLens[lenInd-TEST_MAX_SHORT_LEN-1];
+                if(variant->deinterleave[sizeInd] != NULL &&
+                   !testDeinterleave(variant->name, variant->deinterleave[sizeInd], testScalarDeinterleave[sizeInd],
+                                     componentSize, len, srcOffset, dstOffset)){
+                    failures++;
+                }
+                if(variant->interleave[sizeInd] != NULL &&
+                   !testInterleave(variant->name, variant->interleave[sizeInd], testScalarInterleave[sizeInd],
+                                   componentSize, len, srcOffset, dstOffset)){
+                    failures++;
+                }
+            }
+        }
+    }
+    return failures;
+}
+
+int main(void){
+    int failures = 0;
+    for(size_t variantInd = 0; variantInd<TEST_NUM_VARIANTS; variantInd++){
+        const testVariant_t* variant = &testVariants[variantInd];
+        if(!testIsaSupported(variant->isa)){
+            printf("Skipping %s (not supported by this CPU)\n", variant->name);
+            continue;
+        }
+        for(int sizeInd = 0; sizeInd<3; sizeInd++){
+            if(variant->deinterleave[sizeInd] == NULL && variant->interleave[sizeInd] == NULL){
+                continue;
+            }
+            int variantFailures = testVariantSize(variant, sizeInd);
+            printf("%s: %s %zu byte components\n", variantFailures == 0 ? "PASS" : "FAIL", variant->name,
+                   testComponentSizes[sizeInd]);
+            failures += variantFailures;
+        }
+    }
+
+    //The selected kernels must also match (they are the ones used by the handlers)
+    printf("Selected %s kernels\n", interleaveKernelsInit());
+    testVariant_t selected = {"selected", TEST_ISA_SCALAR,
+                              {deinterleaveKernel(4), deinterleaveKernel(2), deinterleaveKernel(1)},
+                              {interleaveKernel(4), interleaveKernel(2), interleaveKernel(1)}};
+    for(int sizeInd = 0; sizeInd<3; sizeInd++){
+        failures += testVariantSize(&selected, sizeInd);
+    }
+
+    if(failures > 0){
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("All kernels match the scalar kernels\n");
+    return 0;
+}